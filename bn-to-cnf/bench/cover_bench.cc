@@ -0,0 +1,125 @@
+// Times the cover operations of the QM prime covering (qm::reduce) for every
+// instruction set the CPU supports, on covers of increasing numbers of models.
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <algorithm>
+#include "cover_list.h"
+#include "cover_simd.h"
+#include "threadpool.h"
+
+using namespace std;
+
+enum op_t { COPY, AND, OR, XOR, AND_TO, NONE, COUNT, OPS };
+static const char *op_names[OPS] = { "copy", "and", "or", "xor", "and_to", "none", "count" };
+
+void help(){
+    fprintf(stderr, "\nUsage:\n   ./cover-bench [option] [...]\n\n");
+    fprintf(stderr, "   Options:\n");
+    fprintf(stderr, "         -m <models>: Largest number of models (default 65536)\n");
+    fprintf(stderr, "         -n <operations>: Operations per measurement on the smallest covers (default 4000000)\n");
+    fprintf(stderr, "         -h: Help\n");
+}
+
+// keeps the results of none and count alive
+static volatile size_t sink;
+
+static double measure(op_t op, cover_list<uint64_t> &covers, unsigned int N, unsigned int operations){
+    const unsigned int SIZE = covers.size();
+    uint64_t start = threadpool::now();
+    for(unsigned int i = 0; i < operations; i++){
+        cover<uint64_t,0> &dst = covers[i % SIZE];
+        cover<uint64_t,0> &a = covers[(i+1) % SIZE];
+        cover<uint64_t,0> &b = covers[(i+2) % SIZE];
+        switch(op){
+            case COPY:
+                dst.assign(a, N);
+                break;
+            case AND:
+                dst.and_assign(a, N);
+                break;
+            case OR:
+                dst.or_assign(a, N);
+                break;
+            case XOR:
+                dst.xor_assign(a, N);
+                break;
+            case AND_TO:
+                sink += dst.assign_and(a, b, N);
+                break;
+            case NONE:
+                sink += a.none(N);
+                break;
+            default:
+                sink += a.count(N);
+                break;
+        }
+    }
+    return (double) (threadpool::now() - start)/operations;
+}
+
+int main(int argc, char **argv){
+    int c;
+    unsigned int max_models = 65536, operations = 4000000;
+    while ((c = getopt(argc, argv, "m:n:h")) != -1){
+        switch (c){
+            case 'm':
+                max_models = atoi(optarg);
+                if(max_models < 64){
+                    fprintf(stderr, "Argument to option -m (%s) is less than 64\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'n':
+                operations = atoi(optarg);
+                if(operations == 0){
+                    fprintf(stderr, "Argument to option -n (%s) is not a positive number\n", optarg);
+                    return 1;
+                }
+                break;
+            default:
+                help();
+                return 1;
+        }
+    }
+
+    const cover_isa_t isas[] = { COVER_SCALAR, COVER_SSE2, COVER_AVX2 };
+    const cover_isa_t initial = cover_get_isa();
+    printf("%-8s %8s", "isa", "models");
+    for(unsigned int op = 0; op < OPS; op++)
+        printf(" %9s", op_names[op]);
+    printf("   (ns/op)\n");
+
+    for(unsigned int i = 0; i < sizeof(isas)/sizeof(isas[0]); i++){
+        if(!cover_set_isa(isas[i]))
+            continue;
+        for(unsigned int models = 64; models <= max_models; models *= 4){
+            // a handful of covers, so that they stay in cache as in the covering search
+            const unsigned int SIZE = 8;
+            const unsigned int N = cover<uint64_t,0>::cover_size(models);
+            void *memory = NULL;
+            if(posix_memalign(&memory, COVER_ALIGN, cover_list<uint64_t>::bytes(models, SIZE)) != 0){
+                fprintf(stderr, "Failed to allocate covers of %u models\n", models);
+                return 1;
+            }
+            cover_list<uint64_t> &covers = cover_list<uint64_t>::cast(memory);
+            covers.set_size(SIZE);
+            covers.set_cover_size(N);
+            covers.init(0);
+            srand(models);
+            for(unsigned int j = 0; j < SIZE; j++)
+                for(unsigned int m = 0; m < models; m++)
+                    if(rand() % 2)
+                        covers[j].set(m);
+
+            printf("%-8s %8u", cover_isa_name(isas[i]), models);
+            for(unsigned int op = 0; op < OPS; op++)
+                printf(" %9.1f", measure((op_t) op, covers, N, max(1000U, operations*4/N)));
+            printf("\n");
+            free(memory);
+        }
+    }
+
+    cover_set_isa(initial);
+    return 0;
+}
@@ -0,0 +1,248 @@
+// Generates a synthetic Bayesian network (HUGIN .net) and a matching BNC-style
+// classifier (.odd) over some of its variables, for the pipeline benchmark.
+//
+// Nodes are generated in topological order and the parents of a node are
+// drawn from the (at most) <treewidth> nodes before it, so every edge of the
+// moral graph joins nodes less than <treewidth> apart and its treewidth is at
+// most <treewidth>.
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+#include <random>
+#include <algorithm>
+
+using namespace std;
+
+struct options_t {
+    unsigned int nodes = 50;
+    unsigned int cardinality = 2;
+    unsigned int degree = 3;        // in-degree
+    unsigned int treewidth = 5;
+    double determinism = 0;         // fraction of deterministic CPT rows
+    unsigned int features = 8;      // variables of the classifier
+    unsigned int width = 4;         // nodes per level of the classifier
+    unsigned int seed = 1;
+    string prefix;
+};
+
+void help(){
+    fprintf(stderr, "\nUsage:\n   ./network-gen -o <prefix> [option] [...]\n\n");
+    fprintf(stderr, "   Writes <prefix>.net and <prefix>.odd\n\n");
+    fprintf(stderr, "   Options:\n");
+    fprintf(stderr, "         -n <nodes>: Nodes of the network (default 50)\n");
+    fprintf(stderr, "         -k <cardinality>: States per node (default 2)\n");
+    fprintf(stderr, "         -p <parents>: Largest in-degree (default 3)\n");
+    fprintf(stderr, "         -t <treewidth>: Bound on the treewidth of the moral graph (default 5)\n");
+    fprintf(stderr, "         -d <ratio>: Fraction of deterministic CPT rows (default 0)\n");
+    fprintf(stderr, "         -f <features>: Variables of the classifier (default 8)\n");
+    fprintf(stderr, "         -l <width>: Nodes per level of the classifier (default 4)\n");
+    fprintf(stderr, "         -s <seed>: Random seed (default 1)\n");
+    fprintf(stderr, "         -h: Help\n");
+}
+
+static bool count(const char *s, unsigned int &n){
+    char *end;
+    long v = strtol(s, &end, 10);
+    if(*s == '\0' || *end != '\0' || v <= 0)
+        return false;
+    n = v;
+    return true;
+}
+
+// the rows of a CPT nested per parent, the values of the node the innermost
+static void write_cpt(FILE *file, const vector<unsigned int> &dims, unsigned int d, const double *&p, unsigned int k){
+    fputc('(', file);
+    if(d == dims.size()){
+        for(unsigned int v = 0; v < k; v++)
+            fprintf(file, v ? " %.8f" : "%.8f", *p++);
+    } else {
+        for(unsigned int i = 0; i < dims[d]; i++)
+            write_cpt(file, dims, d+1, p, k);
+    }
+    fputc(')', file);
+}
+
+int write_network(const options_t &o, mt19937 &rng){
+    string name = o.prefix + ".net";
+    FILE *file = fopen(name.c_str(), "w");
+    if(file == NULL){
+        fprintf(stderr, "Could not write to: %s\n", name.c_str());
+        return 1;
+    }
+
+    const unsigned int N = o.nodes, K = o.cardinality;
+    fprintf(file, "net \n{ \n}\n");
+    for(unsigned int i = 0; i < N; i++){
+        fprintf(file, "node X%u \n{\n  states = (", i);
+        for(unsigned int v = 0; v < K; v++)
+            fprintf(file, " \"s%u\"", v);
+        fprintf(file, " );\n}\n");
+    }
+
+    uniform_real_distribution<double> uniform(0, 1);
+    vector<unsigned int> window, parents;
+    vector<double> cpt;
+    for(unsigned int i = 0; i < N; i++){
+        unsigned int first = i > o.treewidth ? i - o.treewidth : 0;
+        window.clear();
+        for(unsigned int j = first; j < i; j++)
+            window.push_back(j);
+        shuffle(window.begin(), window.end(), rng);
+        // one parent at least keeps the network connected, bn-to-cnf only
+        // encodes the largest connected component
+        unsigned int degree = min<size_t>(o.degree, window.size());
+        if(degree > 1)
+            degree = uniform_int_distribution<unsigned int>(1, degree)(rng);
+        parents.assign(window.begin(), window.begin()+degree);
+        sort(parents.begin(), parents.end());
+
+        fprintf(file, "potential ( X%u", i);
+        if(!parents.empty()){
+            fprintf(file, " |");
+            for(unsigned int j = 0; j < parents.size(); j++)
+                fprintf(file, " X%u", parents[j]);
+        }
+        fprintf(file, " ) \n{\n  data = ");
+
+        size_t rows = 1;
+        for(unsigned int j = 0; j < parents.size(); j++)
+            rows *= K;
+        cpt.assign(rows*K, 0);
+        for(size_t r = 0; r < rows; r++){
+            double *row = &cpt[r*K];
+            if(uniform(rng) < o.determinism){
+                row[uniform_int_distribution<unsigned int>(0, K-1)(rng)] = 1;
+                continue;
+            }
+            double sum = 0;
+            for(unsigned int v = 0; v < K; v++)
+                sum += (row[v] = 0.01 + uniform(rng));
+            for(unsigned int v = 0; v < K; v++)
+                row[v] /= sum;
+        }
+
+        vector<unsigned int> dims(parents.size(), K);
+        const double *p = cpt.data();
+        write_cpt(file, dims, 0, p, K);
+        fprintf(file, " ;\n}\n");
+    }
+    fclose(file);
+    return 0;
+}
+
+// A layered decision diagram: level j tests feature j and points to nodes of
+// level j+1, the last level to the sinks S0 and S1. Every node is reachable
+// from the root (id 0), the nodes are written children first.
+int write_classifier(const options_t &o, mt19937 &rng){
+    string name = o.prefix + ".odd";
+    FILE *file = fopen(name.c_str(), "w");
+    if(file == NULL){
+        fprintf(stderr, "Could not write to: %s\n", name.c_str());
+        return 1;
+    }
+
+    const unsigned int K = o.cardinality;
+    vector<unsigned int> features(o.nodes);
+    for(unsigned int i = 0; i < o.nodes; i++)
+        features[i] = i;
+    shuffle(features.begin(), features.end(), rng);
+    features.resize(min(o.features, o.nodes));
+    sort(features.begin(), features.end());
+    const unsigned int F = features.size();
+
+    fprintf(file, "[");
+    for(unsigned int j = 0; j < F; j++)
+        fprintf(file, j ? ", X%u" : "X%u", features[j]);
+    fprintf(file, "]\n");
+
+    // ids per level, top-down
+    vector< vector<unsigned int> > levels(F);
+    unsigned int id = 0;
+    for(unsigned int j = 0; j < F; j++){
+        size_t size = j == 0 ? 1 : min<size_t>(o.width, levels[j-1].size()*K);
+        for(size_t n = 0; n < size; n++)
+            levels[j].push_back(id++);
+    }
+
+    vector<string> children;
+    for(unsigned int j = F; j-- > 0;){
+        const bool last = j+1 == F;
+        const size_t below = last ? 2 : levels[j+1].size();
+        const size_t edges = levels[j].size()*K;
+
+        // every node below is pointed to at least once
+        children.assign(edges, string());
+        vector<size_t> targets(edges);
+        for(size_t e = 0; e < edges; e++)
+            targets[e] = e < below ? e : uniform_int_distribution<size_t>(0, below-1)(rng);
+        shuffle(targets.begin(), targets.end(), rng);
+        for(size_t e = 0; e < edges; e++)
+            children[e] = last ? "S" + to_string(targets[e]) : to_string(levels[j+1][targets[e]]);
+
+        for(size_t n = 0; n < levels[j].size(); n++){
+            fprintf(file, "%u %u", levels[j][n], j);
+            for(unsigned int v = 0; v < K; v++)
+                fprintf(file, " %s", children[n*K+v].c_str());
+            fprintf(file, "\n");
+        }
+    }
+    fclose(file);
+    return 0;
+}
+
+int main(int argc, char **argv){
+    options_t o;
+    int c;
+    while ((c = getopt(argc, argv, "o:n:k:p:t:d:f:l:s:h")) != -1){
+        bool valid = true;
+        switch (c){
+            case 'o':
+                o.prefix = optarg;
+                break;
+            case 'n':
+                valid = count(optarg, o.nodes);
+                break;
+            case 'k':
+                valid = count(optarg, o.cardinality) && o.cardinality >= 2;
+                break;
+            case 'p':
+                valid = count(optarg, o.degree);
+                break;
+            case 't':
+                valid = count(optarg, o.treewidth);
+                break;
+            case 'd':
+                o.determinism = atof(optarg);
+                valid = o.determinism >= 0 && o.determinism <= 1;
+                break;
+            case 'f':
+                valid = count(optarg, o.features);
+                break;
+            case 'l':
+                valid = count(optarg, o.width);
+                break;
+            case 's':
+                valid = count(optarg, o.seed);
+                break;
+            default:
+                help();
+                return 1;
+        }
+        if(!valid){
+            fprintf(stderr, "Invalid argument to option -%c (%s)\n", c, optarg);
+            return 1;
+        }
+    }
+    if(o.prefix.empty()){
+        help();
+        fprintf(stderr, "Specify the output with -o <prefix>\n");
+        return 1;
+    }
+
+    mt19937 rng(o.seed);
+    if(write_network(o, rng) != 0 || write_classifier(o, rng) != 0)
+        return 1;
+    return 0;
+}
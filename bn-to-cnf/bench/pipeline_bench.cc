@@ -0,0 +1,302 @@
+// Times the pipeline (bn-to-cnf, constrained_ordering, bw_obdd_to_cnf and
+// combine_cnf) on a sweep of synthetic networks of network-gen. Every stage
+// runs as a child process, its wall time, peak RSS and output sizes are
+// printed as a table and written as JSON. A stage without its binary, or
+// without the outputs of the stages it reads, is skipped, a stage over the
+// CPU time limit has status 152 (SIGXCPU).
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#include <string>
+#include <vector>
+#include <sstream>
+
+using namespace std;
+
+enum { BN_TO_CNF, CONSTRAINED_ORDERING, BW_OBDD_TO_CNF, COMBINE_CNF, STAGES };
+static const char *stage_names[STAGES] = { "bn-to-cnf", "constrained_ordering", "bw_obdd_to_cnf", "combine_cnf" };
+// relative to the root of the repository, where build.sh builds them
+static const char *stage_paths[STAGES] = {
+    "bn-to-cnf/cmake-build/bn-to-cnf",
+    "constrained-ordering/cmake-build/constrained_ordering",
+    "bw-obdd-to-cnf/cmake-build/bw_obdd_to_cnf",
+    "combine_cnf/cmake-build/combine_cnf"
+};
+
+struct result_t {
+    unsigned int nodes;
+    int stage;
+    int status;                     // exit status, -1 when skipped
+    double seconds;
+    long rss;                       // peak, in KB
+    vector< pair<string,off_t> > outputs;
+};
+
+void help(){
+    fprintf(stderr, "\nUsage:\n   ./pipeline-bench [option] [...]\n\n");
+    fprintf(stderr, "   Options:\n");
+    fprintf(stderr, "         -g <filename>: network-gen binary (default: next to pipeline-bench)\n");
+    fprintf(stderr, "         -R <directory>: Root of the repository the stages are found in (default ..)\n");
+    fprintf(stderr, "         -b <filename>: bn-to-cnf binary\n");
+    fprintf(stderr, "         -c <filename>: constrained_ordering binary\n");
+    fprintf(stderr, "         -d <filename>: bw_obdd_to_cnf binary\n");
+    fprintf(stderr, "         -m <filename>: combine_cnf binary\n");
+    fprintf(stderr, "         -e <options>: Options of bn-to-cnf, e.g. \"-e -a\"\n");
+    fprintf(stderr, "         -n <nodes,...>: Sweep of network sizes (default 25,50,100)\n");
+    fprintf(stderr, "         -T <seconds>: CPU time limit per stage (default 300)\n");
+    fprintf(stderr, "         -a <options>: Options of network-gen for every network, e.g. \"-k 3 -p 4\"\n");
+    fprintf(stderr, "         -w <directory>: Directory of the networks and outputs (default pipeline-benchmark)\n");
+    fprintf(stderr, "         -o <filename>: JSON results (default <directory>/results.json)\n");
+    fprintf(stderr, "         -h: Help\n");
+}
+
+static vector<string> split(const string &s, char delimiter = ' '){
+    vector<string> words;
+    stringstream ss(s);
+    string word;
+    while(getline(ss, word, delimiter))
+        if(!word.empty())
+            words.push_back(word);
+    return words;
+}
+
+static double now(){
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec/1e9;
+}
+
+// runs args with its output to log, the peak RSS is that of the child alone.
+// A child over the limit (CPU seconds) is killed by SIGXCPU.
+static int run(const vector<string> &args, const string &log, double &seconds, long &rss, unsigned int limit = 0){
+    vector<char*> argv;
+    for(size_t i = 0; i < args.size(); i++)
+        argv.push_back((char*) args[i].c_str());
+    argv.push_back(NULL);
+
+    double start = now();
+    pid_t pid = fork();
+    if(pid < 0)
+        return -1;
+    if(pid == 0){
+        int fd = open(log.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if(fd >= 0){
+            dup2(fd, 1);
+            dup2(fd, 2);
+            close(fd);
+        }
+        if(limit){
+            struct rlimit cpu = { limit, limit+1 };
+            setrlimit(RLIMIT_CPU, &cpu);
+        }
+        execv(argv[0], argv.data());
+        _exit(127);
+    }
+
+    int status;
+    struct rusage usage;
+    if(wait4(pid, &status, 0, &usage) != pid)
+        return -1;
+    seconds = now() - start;
+    rss = usage.ru_maxrss;
+    return WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+}
+
+static off_t file_size(const string &name){
+    struct stat st;
+    return stat(name.c_str(), &st) == 0 ? st.st_size : -1;
+}
+
+static bool executable(const string &name){
+    return access(name.c_str(), X_OK) == 0;
+}
+
+int write_results(const string &name, const vector<result_t> &results){
+    FILE *file = fopen(name.c_str(), "w");
+    if(file == NULL)
+        return 1;
+    fprintf(file, "{\n  \"results\": [\n");
+    for(size_t i = 0; i < results.size(); i++){
+        const result_t &r = results[i];
+        fprintf(file, "    {\"nodes\": %u, \"stage\": \"%s\", \"status\": %d, \"seconds\": %.6f, \"peak_rss_kb\": %ld, \"outputs\": {",
+            r.nodes, stage_names[r.stage], r.status, r.seconds, r.rss);
+        for(size_t j = 0; j < r.outputs.size(); j++)
+            fprintf(file, "%s\"%s\": %lld", j ? ", " : "", r.outputs[j].first.c_str(), (long long) r.outputs[j].second);
+        fprintf(file, "}}%s\n", i+1 < results.size() ? "," : "");
+    }
+    fprintf(file, "  ]\n}\n");
+    fclose(file);
+    return 0;
+}
+
+int main(int argc, char **argv){
+    string generator, root = "..", directory = "pipeline-benchmark", output;
+    string tools[STAGES];
+    vector<string> encode_options, generate_options;
+    vector<unsigned int> sweep = {25, 50, 100};
+    unsigned int limit = 300;
+
+    int c;
+    while ((c = getopt(argc, argv, "g:R:b:c:d:m:e:n:T:a:w:o:h")) != -1){
+        switch (c){
+            case 'g':
+                generator = optarg;
+                break;
+            case 'R':
+                root = optarg;
+                break;
+            case 'b':
+                tools[BN_TO_CNF] = optarg;
+                break;
+            case 'c':
+                tools[CONSTRAINED_ORDERING] = optarg;
+                break;
+            case 'd':
+                tools[BW_OBDD_TO_CNF] = optarg;
+                break;
+            case 'm':
+                tools[COMBINE_CNF] = optarg;
+                break;
+            case 'e':
+                encode_options = split(optarg);
+                break;
+            case 'a':
+                generate_options = split(optarg);
+                break;
+            case 'n':
+                sweep.clear();
+                for(const string &n : split(optarg, ',')){
+                    if(atoi(n.c_str()) <= 0){
+                        fprintf(stderr, "Argument to option -n (%s) is not a list of positive integers\n", optarg);
+                        return 1;
+                    }
+                    sweep.push_back(atoi(n.c_str()));
+                }
+                break;
+            case 'T':
+                if(atoi(optarg) <= 0){
+                    fprintf(stderr, "Argument to option -T (%s) is not a positive integer\n", optarg);
+                    return 1;
+                }
+                limit = atoi(optarg);
+                break;
+            case 'w':
+                directory = optarg;
+                break;
+            case 'o':
+                output = optarg;
+                break;
+            default:
+                help();
+                return 1;
+        }
+    }
+
+    if(generator.empty()){
+        string self = argv[0];
+        size_t slash = self.find_last_of('/');
+        generator = (slash == string::npos ? string(".") : self.substr(0, slash)) + "/network-gen";
+    }
+    if(!executable(generator)){
+        fprintf(stderr, "Could not find network-gen (%s), specify it with -g <filename>\n", generator.c_str());
+        return 1;
+    }
+    for(int s = 0; s < STAGES; s++){
+        if(tools[s].empty())
+            tools[s] = root + "/" + stage_paths[s];
+        if(!executable(tools[s]))
+            printf("%s not found (%s), the stage is skipped\n", stage_names[s], tools[s].c_str());
+    }
+    mkdir(directory.c_str(), 0755);
+    if(output.empty())
+        output = directory + "/results.json";
+
+    vector<result_t> results;
+    printf("\n%8s %-22s %8s %12s %14s  %s\n", "nodes", "stage", "status", "seconds", "peak RSS (KB)", "outputs (bytes)");
+    for(unsigned int nodes : sweep){
+        string prefix = directory + "/n" + to_string(nodes);
+        vector<string> generate = {generator, "-o", prefix, "-n", to_string(nodes)};
+        generate.insert(generate.end(), generate_options.begin(), generate_options.end());
+        double seconds;
+        long rss;
+        if(run(generate, prefix + ".gen.log", seconds, rss) != 0){
+            fprintf(stderr, "network-gen failed, see %s.gen.log\n", prefix.c_str());
+            return 1;
+        }
+
+        string net = prefix + ".net", odd = prefix + ".odd";
+        string bn_cnf = prefix + ".bn.cnf", df_cnf = prefix + ".df.cnf";
+        string ordering = prefix + ".ordering.txt", constraints = prefix + ".modconstraints.txt";
+        string combined = prefix + ".combined";
+        for(int s = 0; s < STAGES; s++){
+            result_t r;
+            r.nodes = nodes;
+            r.stage = s;
+            r.status = -1;
+            r.seconds = 0;
+            r.rss = 0;
+
+            vector<string> args = {tools[s]};
+            vector<string> inputs, outputs;
+            switch(s){
+                case BN_TO_CNF:
+                    args.insert(args.end(), {"-i", net});
+                    args.insert(args.end(), encode_options.begin(), encode_options.end());
+                    args.insert(args.end(), {"-w", bn_cnf});
+                    outputs = {bn_cnf};
+                    break;
+                case CONSTRAINED_ORDERING:
+                    args.insert(args.end(), {"-i", net, "-o", ordering, "-m", constraints});
+                    outputs = {ordering, constraints};
+                    break;
+                case BW_OBDD_TO_CNF:
+                    args.insert(args.end(), {"-i", odd, "-o", df_cnf});
+                    outputs = {df_cnf};
+                    break;
+                default:
+                    args.insert(args.end(), {"-c", bn_cnf, "-d", df_cnf, "-m", constraints, "-o", combined});
+                    inputs = {bn_cnf, df_cnf, constraints};
+                    outputs = {combined + ".cnf", combined + ".lmap"};
+                    break;
+            }
+
+            // outputs of an earlier sweep are not mistaken for new ones
+            for(const string &name : outputs)
+                unlink(name.c_str());
+            bool ready = executable(tools[s]);
+            for(const string &name : inputs)
+                ready = ready && file_size(name) >= 0;
+            if(ready){
+                r.status = run(args, prefix + "." + stage_names[s] + ".log", r.seconds, r.rss, limit);
+                for(const string &name : outputs)
+                    r.outputs.push_back(make_pair(name.substr(name.find_last_of('/')+1), file_size(name)));
+            }
+            results.push_back(r);
+
+            printf("%8u %-22s ", nodes, stage_names[s]);
+            if(r.status < 0)
+                printf("%8s\n", "skipped");
+            else {
+                printf("%8d %12.3f %14ld ", r.status, r.seconds, r.rss);
+                for(size_t j = 0; j < r.outputs.size(); j++)
+                    printf(" %lld", (long long) r.outputs[j].second);
+                printf("\n");
+            }
+            fflush(stdout);
+        }
+    }
+
+    if(write_results(output, results) != 0){
+        fprintf(stderr, "Could not write to: %s\n", output.c_str());
+        return 1;
+    }
+    printf("\nResults written to: %s\n", output.c_str());
+    return 0;
+}
@@ -0,0 +1,246 @@
+// Compares the pairwise and the hash based Quine-McCluskey merge on the
+// clause groups (equal variable and weight) of the CPTs of HUGIN networks.
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <ctype.h>
+#include <vector>
+#include "parser.h"
+#include "bayesnet.h"
+#include "cnf.h"
+#include "misc.h"
+#include "qm.h"
+#include "threadpool.h"
+
+using namespace std;
+
+struct group_t {
+    vector<unsigned int> literals;          // literal of every index
+    vector< cube<uint32_t> > models;        // constraints first, then the clauses
+};
+
+struct result_t {
+    uint64_t time;
+    unsigned int primes;
+    vector< vector<int32_t> > clauses;
+};
+
+void help(){
+    fprintf(stderr, "\nUsage:\n   ./qm-bench [option] [...] <filename> [...]\n\n");
+    fprintf(stderr, "   Options:\n");
+    fprintf(stderr, "         -l <limit>: Largest clause group in literals (default 12, at most 32)\n");
+    fprintf(stderr, "         -r <repeat>: Repeat every group (default 1)\n");
+    fprintf(stderr, "         -j <threads>: Run merge rounds on a pool of threads\n");
+    fprintf(stderr, "         -w <clusters>: Also solve groups of 256 and 512 literals made of this many clusters of models\n");
+    fprintf(stderr, "         -h: Help\n");
+}
+
+// the QM problems cnf::encode_prime solves for its clause groups
+static void get_groups(const cnf &f, unsigned int limit, vector<group_t> &groups){
+    vector<qm_group_t> qm_groups;
+    f.get_qm_groups(qm_groups);
+    for(unsigned int g = 0; g < qm_groups.size(); g++){
+        const qm_group_t &qm_group = qm_groups[g];
+        if(qm_group.clauses.size() <= 1 || qm_group.l_to_i.size() > limit)
+            continue;
+
+        groups.resize(groups.size()+1);
+        group_t &group = groups.back();
+        group.literals.resize(qm_group.l_to_i.size());
+        for(auto lit = qm_group.l_to_i.begin(); lit != qm_group.l_to_i.end(); lit++)
+            group.literals[lit->second] = lit->first;
+
+        // constraints first, then the clauses
+        vector< cube<uint32_t> > models;
+        f.get_qm_models(qm_group, group.models, models);
+        group.models.insert(group.models.end(), models.begin(), models.end());
+    }
+}
+
+static void run(group_t &group, qm<uint32_t>::merge_t merge, threadpool *pool, unsigned int repeat, result_t &result){
+    result.time = 0;
+    for(unsigned int r = 0; r < repeat; r++){
+        qm<uint32_t> q;
+        for(unsigned int i = 0; i < group.literals.size(); i++)
+            q.add_variable(group.literals[i], i);
+        for(unsigned int i = 0; i < group.models.size(); i++)
+            q.add_model(group.models[i]);
+        q.set_pool(pool);
+        q.set_merge(merge);
+
+        uint64_t start = threadpool::now();
+        q.canonical_primes(false);
+        result.time += threadpool::now() - start;
+
+        if(r == 0){
+            result.primes = q.get_primes_size();
+            result.clauses.resize(result.primes);
+            for(unsigned int i = 0; i < result.primes; i++){
+                result.clauses[i].clear();
+                q.get_clause(result.clauses[i], i);
+            }
+        }
+    }
+}
+
+// A group of BITS literals given as explicit models, as network groups of
+// that width cannot be: qm expands the don't cares of their clauses. Every
+// cluster is a random model with all 16 values of 4 of its literals, so the
+// primes are one cube per cluster, which the minimal cover keeps.
+template <typename M>
+static void run_wide(unsigned int clusters, typename qm<M>::merge_t merge, threadpool *pool, unsigned int repeat, result_t &result){
+    const unsigned int BITS = sizeof(M)*8;
+    vector<M> models;
+    srand(BITS);
+    for(unsigned int c = 0; c < clusters; c++){
+        cover_element<M> base;
+        base.clear_all();
+        for(unsigned int i = 0; i < BITS; i++)
+            if(rand() % 2)
+                base.set(i);
+        for(unsigned int k = 0; k < 16; k++){
+            cover_element<M> m = base;
+            for(unsigned int b = 0; b < 4; b++){
+                unsigned int i = (c + b*BITS/4) % BITS;
+                if(k & (1 << b))
+                    m.set(i);
+                else m.clear(i);
+            }
+            models.push_back(m.value);
+        }
+    }
+
+    result.time = 0;
+    for(unsigned int r = 0; r < repeat; r++){
+        qm<M> q;
+        for(unsigned int i = 0; i < BITS; i++)
+            q.add_variable(i+1, i);
+        for(unsigned int i = 0; i < models.size(); i++)
+            q.add_model(models[i]);
+        q.set_pool(pool);
+        q.set_merge(merge);
+
+        uint64_t start = threadpool::now();
+        q.canonical_primes(true);
+        result.time += threadpool::now() - start;
+
+        if(r == 0){
+            result.primes = q.get_primes_size();
+            result.clauses.resize(result.primes);
+            for(unsigned int i = 0; i < result.primes; i++){
+                result.clauses[i].clear();
+                q.get_clause(result.clauses[i], i);
+            }
+        }
+    }
+}
+
+template <typename M>
+static bool print_wide(unsigned int clusters, threadpool *pool, unsigned int repeat){
+    result_t pairs, hash;
+    run_wide<M>(clusters, qm<M>::MERGE_PAIRS, pool, repeat, pairs);
+    run_wide<M>(clusters, qm<M>::MERGE_HASH, pool, repeat, hash);
+    bool same = (pairs.clauses == hash.clauses && hash.primes == clusters);
+
+    char name[16];
+    snprintf(name, sizeof(name), "wide%lu", sizeof(M)*8);
+    printf("%-16s %7u %9u %9u %12.2f %12.2f %7.2fx %s\n", name, 1, 16*clusters, hash.primes,
+        pairs.time/1e6/repeat, hash.time/1e6/repeat, hash.time?(double) pairs.time/hash.time:0.0, same?"identical":"DIFFERENT");
+    return same;
+}
+
+int main(int argc, char **argv){
+    int c;
+    unsigned int limit = 12, repeat = 1, threads = 0, clusters = 0;
+    while ((c = getopt(argc, argv, "l:r:j:w:h")) != -1){
+        switch (c){
+            case 'l':
+                limit = atoi(optarg);
+                if(limit == 0 || limit > 32){
+                    fprintf(stderr, "Argument to option -l (%s) is not in [1,32]\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'r':
+                repeat = atoi(optarg);
+                if(repeat == 0){
+                    fprintf(stderr, "Argument to option -r (%s) is not a positive number\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'j':
+                threads = atoi(optarg);
+                if(threads == 0){
+                    fprintf(stderr, "Argument to option -j (%s) is not a positive number\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'w':
+                clusters = atoi(optarg);
+                if(clusters == 0 || clusters > 64){
+                    fprintf(stderr, "Argument to option -w (%s) is not in [1,64]\n", optarg);
+                    return 1;
+                }
+                break;
+            default:
+                help();
+                return 1;
+        }
+    }
+    if(optind >= argc && clusters == 0){
+        help();
+        return 1;
+    }
+
+    threadpool *pool = (threads > 0 ? new threadpool(threads) : NULL);
+    printf("%-16s %7s %9s %9s %12s %12s %8s %s\n", "network", "groups", "models", "primes", "pairs (ms)", "hash (ms)", "speedup", "check");
+
+    int failed = 0;
+    for(int index = optind; index < argc; index++){
+        parser<hugin> net;
+        net.process(argv[index]);
+        bayesnet *bn = net.get_bayesnet();
+        if(bn == NULL){
+            fprintf(stderr, "Failed to read %s\n", argv[index]);
+            return 1;
+        }
+
+        // the clauses encode_prime starts from when -q is given
+        cnf f;
+        f.set_optimization(cnf::opt_t::EQUAL_PROBABILITIES);
+        f.set_encoding(1);
+        f.encode(bn);
+        vector<group_t> groups;
+        get_groups(f, limit, groups);
+
+        uint64_t pairs_time = 0, hash_time = 0;
+        unsigned long models = 0, primes = 0, mismatches = 0;
+        for(unsigned int g = 0; g < groups.size(); g++){
+            result_t pairs, hash;
+            run(groups[g], qm<uint32_t>::MERGE_PAIRS, pool, repeat, pairs);
+            run(groups[g], qm<uint32_t>::MERGE_HASH, pool, repeat, hash);
+            pairs_time += pairs.time;
+            hash_time += hash.time;
+            models += groups[g].models.size();
+            primes += hash.primes;
+            if(pairs.clauses != hash.clauses)
+                mismatches++;
+        }
+
+        printf("%-16s %7lu %9lu %9lu %12.2f %12.2f %7.2fx %s\n", get_basename(argv[index]), groups.size(), models, primes,
+            pairs_time/1e6/repeat, hash_time/1e6/repeat, hash_time?(double) pairs_time/hash_time:0.0, mismatches?"DIFFERENT":"identical");
+        if(mismatches)
+            failed = 1;
+        delete bn;
+    }
+
+    if(clusters > 0){
+        if(!print_wide<uint256_t>(clusters, pool, repeat))
+            failed = 1;
+        if(!print_wide<uint512_t>(clusters, pool, repeat))
+            failed = 1;
+    }
+
+    delete pool;
+    return failed;
+}
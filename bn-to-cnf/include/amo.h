@@ -0,0 +1,147 @@
+#ifndef AMO_H
+#define AMO_H
+
+#include <stddef.h>
+#include <string.h>
+#include <vector>
+#include <algorithm>
+
+// At most one of a list of literals as clauses, shared by the tools of the
+// pipeline. PAIRWISE takes n(n-1)/2 binary clauses, the others O(n) clauses
+// over auxiliary variables:
+//   SEQUENTIAL  the counter s_i = x_1 | ... | x_i, and x_i excludes s_i-1 (Sinz)
+//   COMMANDER   groups of three, a commander per group that is their
+//               disjunction, and at most one commander (Klieber and Kwon)
+//   PRODUCT     x_i on a grid of sqrt(n) columns implies its row u_r and its
+//               column v_c, and at most one u and one v (Chen)
+// Every auxiliary variable is defined as the disjunction of the literals it
+// stands for, both directions, so it is determined by them and weighted model
+// counts do not change. A list of up to PAIRWISE_MAX literals is pairwise in
+// every encoding, which is no larger there.
+namespace amo {
+    enum encoding_t { PAIRWISE, SEQUENTIAL, COMMANDER, PRODUCT };
+
+    const size_t PAIRWISE_MAX = 6;
+    const size_t COMMANDER_GROUP = 3;
+
+    inline const char* name(encoding_t encoding){
+        static const char *names[] = { "pairwise", "sequential", "commander", "product" };
+        return names[encoding];
+    }
+
+    inline bool parse(const char *s, encoding_t &encoding){
+        for(int e = PAIRWISE; e <= PRODUCT; e++)
+            if(strcmp(s, name((encoding_t) e)) == 0){
+                encoding = (encoding_t) e;
+                return true;
+            }
+        return false;
+    }
+
+    // literals are nonzero and signed, new_variable() returns a new (positive)
+    // one and clause(const L*, size_t) takes a clause
+    template <typename L, typename V, typename C>
+    void encode(encoding_t encoding, const std::vector<L> &x, V &new_variable, C &clause){
+        const size_t n = x.size();
+        if(encoding == PAIRWISE || n <= PAIRWISE_MAX){
+            for(size_t i = 0; i + 1 < n; i++)
+                for(size_t j = i+1; j < n; j++){
+                    L c[2] = { -x[i], -x[j] };
+                    clause(c, 2);
+                }
+            return;
+        }
+
+        switch(encoding){
+            case SEQUENTIAL: {
+                std::vector<L> s(n-1);
+                for(size_t i = 0; i < n-1; i++)
+                    s[i] = new_variable();
+                L c0[2] = { -s[0], x[0] };
+                clause(c0, 2);
+                for(size_t i = 0; i < n; i++){
+                    if(i < n-1){
+                        L c[2] = { -x[i], s[i] };
+                        clause(c, 2);
+                    }
+                    if(i > 0){
+                        L c[2] = { -x[i], -s[i-1] };
+                        clause(c, 2);
+                    }
+                    if(i > 0 && i < n-1){
+                        L c[2] = { -s[i-1], s[i] };
+                        clause(c, 2);
+                        L d[3] = { -s[i], s[i-1], x[i] };
+                        clause(d, 3);
+                    }
+                }
+                break;
+            }
+            case COMMANDER: {
+                std::vector<L> commanders, group, definition;
+                for(size_t g = 0; g < n; g += COMMANDER_GROUP){
+                    group.assign(x.begin()+g, x.begin()+std::min(n, g+COMMANDER_GROUP));
+                    L commander = new_variable();
+                    commanders.push_back(commander);
+                    encode(PAIRWISE, group, new_variable, clause);
+                    definition.assign(1, -commander);
+                    for(size_t i = 0; i < group.size(); i++){
+                        L c[2] = { -group[i], commander };
+                        clause(c, 2);
+                        definition.push_back(group[i]);
+                    }
+                    clause(definition.data(), definition.size());
+                }
+                encode(COMMANDER, commanders, new_variable, clause);
+                break;
+            }
+            case PRODUCT: {
+                size_t columns = 1;
+                while(columns*columns < n)
+                    columns++;
+                const size_t rows = (n + columns - 1)/columns;
+                std::vector<L> u(rows), v(columns), definition;
+                for(size_t r = 0; r < rows; r++)
+                    u[r] = new_variable();
+                for(size_t c = 0; c < columns; c++)
+                    v[c] = new_variable();
+                for(size_t i = 0; i < n; i++){
+                    L c[2] = { -x[i], u[i/columns] };
+                    clause(c, 2);
+                    L d[2] = { -x[i], v[i%columns] };
+                    clause(d, 2);
+                }
+                for(size_t r = 0; r < rows; r++){
+                    definition.assign(1, -u[r]);
+                    for(size_t i = r*columns; i < std::min(n, (r+1)*columns); i++)
+                        definition.push_back(x[i]);
+                    clause(definition.data(), definition.size());
+                }
+                for(size_t c = 0; c < columns; c++){
+                    definition.assign(1, -v[c]);
+                    for(size_t i = c; i < n; i += columns)
+                        definition.push_back(x[i]);
+                    clause(definition.data(), definition.size());
+                }
+                encode(PRODUCT, u, new_variable, clause);
+                encode(PRODUCT, v, new_variable, clause);
+                break;
+            }
+            default:
+                break;
+        }
+    }
+
+    // the size of encode() over n literals, to reserve for it
+    inline void count(encoding_t encoding, size_t n, size_t &clauses, size_t &literals, size_t &auxiliary){
+        std::vector<long long> x(n);
+        for(size_t i = 0; i < n; i++)
+            x[i] = i+1;
+        long long next = n;
+        auto new_variable = [&next, &auxiliary](){ auxiliary++; return ++next; };
+        auto clause = [&clauses, &literals](const long long*, size_t size){ clauses++; literals += size; };
+        encode(encoding, x, new_variable, clause);
+    }
+}
+
+#endif
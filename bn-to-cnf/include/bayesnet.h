@@ -4,6 +4,7 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <unordered_map>
 #include "error.h"
 #include "types.h"
 #include "config.h"
@@ -13,32 +14,48 @@ typedef throw_string_error dynamic_bayesnet_error;
 
 class cnf;
 
+// A network as it is parsed. Names are interned to dense ids through a flat
+// (open addressing) hash index, nodes live in one vector and refer to each
+// other by id. finalize() numbers the kept nodes in order of their name,
+// the ids bayesnet::init() gives them.
 class dynamic_bayesnet {
     friend class bayesnet;
     public:
         struct node {
-            std::vector <dynamic_bayesnet::node*> parent;
-            std::vector <dynamic_bayesnet::node*> child;
+            std::vector <uint32_t> parent;
+            std::vector <uint32_t> child;
             std::vector <std::string> value;
             std::vector <probability_t> cpt;
             std::vector <unsigned int> dim;
             std::string name;
 
-            node(std::string node_name) : name(node_name) {};
+            node(const std::string &node_name) : name(node_name) {};
             node(){};
         };
 
-        dynamic_bayesnet::node* get_node(std::string);
-        void finalize();
+        dynamic_bayesnet();
+        uint32_t get_id(const std::string&);            // interned, added when new
+        int find(const std::string&) const;             // -1 when absent
+        dynamic_bayesnet::node* get_node(uint32_t);
+        dynamic_bayesnet::node* get_node(const std::string&); // until the next node is added
+        void add_edge(uint32_t parent, uint32_t child);
+        void finalize(const std::vector<std::string> &query = std::vector<std::string>());
         int wcc();
+        int prune(const std::vector<std::string> &query);
         void print();
     private:
+        static uint64_t hash(const std::string&);
+        void grow();
+
         unsigned int parent_size;
         unsigned int child_size;
         unsigned int dim_size;
-        unsigned int cpt_size;
+        uint64_t cpt_size;
 
-        std::map<std::string,dynamic_bayesnet::node> nodes;
+        std::vector<dynamic_bayesnet::node> nodes;
+        std::vector<uint32_t> index;                    // slots of id+1, 0 is empty
+        std::vector<bool> removed;                      // by wcc() and prune()
+        std::vector<uint32_t> order;                    // kept ids by name, see finalize()
 };
 
 class bayesnet {
@@ -47,7 +64,7 @@ class bayesnet {
     struct bayesdict {
         bayesdict& operator=(bayesdict*);
         std::vector< std::vector<std::string> > value;
-        std::map<std::string,unsigned int> name_to_id;
+        std::unordered_map<std::string,unsigned int> name_to_id;
         std::vector<std::string> id_to_name;
     };
 
@@ -75,6 +92,12 @@ class bayesnet {
 
         static bayesnet* read(const char*); // throws bayesnet_exception
 
+        // binary cache (.bnb) of a parsed network, mapped without copying.
+        // the stamp identifies what it was parsed from, see stamp()
+        static bayesnet* map(const char*, uint64_t);
+        bool save(const char*, uint64_t);
+        static uint64_t stamp(const char*, const std::vector<std::string>&);
+
         inline uint32_t* get_states();
         inline uint32_t* get_parent(unsigned int);
         inline uint32_t* get_child(unsigned int);
@@ -85,25 +108,44 @@ class bayesnet {
         inline unsigned int get_cpt_size(unsigned int);
         inline unsigned int get_parent_size();
         inline unsigned int get_child_size();
-        inline unsigned int get_cpt_size();
+        inline uint64_t get_cpt_size();
     private:
+        struct bnb_header_t {
+            uint64_t magic;
+            uint32_t version;
+            uint32_t size;
+            uint64_t stamp;
+            uint64_t probabilities;
+            uint32_t parents;
+            uint32_t labels;
+            uint64_t strings;
+        };
+
         void destroy();
         BITSTREAM msg;
-        SIZE msg_size;
+        uint64_t msg_size;
         bool dirty;
         SIZE size;
         probability_t *cpt;
         size_t nr_probabilities;
+        uint64_t *cpt_offset;
         uint32_t
             *parent,
             *child,
             *states,
-            *cpt_offset,
             *parent_offset,
             *child_offset;
 
         bayesdict *dict;
         std::string filename;
+
+        // set when the arrays point into a mapped cache, names and value
+        // labels are then read from its string table instead of the dict
+        void *mapping;
+        size_t mapping_size;
+        const char *strings;
+        const uint32_t *string_offset;
+        const uint32_t *value_offset;
 };
 
 typedef dynamic_bayesnet dbn_t;
@@ -149,7 +191,7 @@ inline unsigned int bayesnet::get_child_size(){
     return child_offset[size];
 }
 
-inline unsigned int bayesnet::get_cpt_size(){
+inline uint64_t bayesnet::get_cpt_size(){
     return cpt_offset[size];
 }
 
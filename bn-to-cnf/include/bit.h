@@ -56,10 +56,22 @@ inline unsigned int bitcount(uint64_t x){
     return __builtin_popcountl(x);;
 }
 
-//template <>
-//inline unsigned int bitcount(uint128_t x){
-//    return bitcount((uint64_t) x) + bitcount((uint64_t) (x>>64));
-//}
+template <>
+inline unsigned int bitcount(uint8_t x){
+    return __builtin_popcount(x);
+}
+
+template <>
+inline unsigned int bitcount(uint16_t x){
+    return __builtin_popcount(x);
+}
+
+#if __LP64__
+template <>
+inline unsigned int bitcount(__uint128_t x){
+    return __builtin_popcountl((uint64_t) x) + __builtin_popcountl((uint64_t) (x>>64));
+}
+#endif
 
 template <typename T>
 inline bool is_power_of_two_or_zero(const T x){
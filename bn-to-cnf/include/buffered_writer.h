@@ -0,0 +1,45 @@
+#ifndef BUFFERED_WRITER_H
+#define BUFFERED_WRITER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+// Output formatted into a large reusable buffer with std::to_chars and
+// written to a file descriptor with few write(2) calls. A writer that is not
+// opened keeps everything in memory, which lets chunks be formatted
+// concurrently and appended in order. Doubles are formatted like "%f".
+class buffered_writer {
+    public:
+        buffered_writer(size_t capacity = 1 << 20);
+        buffered_writer(const buffered_writer&) = delete;
+        buffered_writer& operator=(const buffered_writer&) = delete;
+        ~buffered_writer();
+
+        bool open(const char*);
+        bool close();
+
+        void put(char);
+        void put(const char*);
+        void put(const char*, size_t);
+        void put(const std::string&);
+        void put(const buffered_writer&);
+        void put(int32_t);
+        void put(uint32_t);
+        void put(double);
+        void printf(const char*, ...) __attribute__((format(printf, 2, 3)));
+
+        bool flush();
+        bool failed() const;
+        size_t size() const;
+    private:
+        inline char* reserve(size_t);
+
+        int fd;
+        bool error;
+        size_t used;
+        std::vector<char> buffer;
+};
+
+#endif
@@ -6,10 +6,15 @@
 #include <stdio.h>
 #include <map>
 #include <set>
+#include <string>
 #include <vector>
 #include "config.h"
+#include "amo.h"
 
 class bayesnet;
+class threadpool;
+class qm_cache;
+template <typename T> class cube;
 
 typedef int32_t literal_t;
 typedef uint32_t uliteral_t;
@@ -18,6 +23,13 @@ typedef std::vector<variable_t> variable_list_t;
 typedef literal_t weight_t;
 typedef uint8_t bool_t;
 
+// literals of a clause_store are indexed 32-bit unless built with LARGE_CNF
+#ifdef LARGE_CNF
+typedef uint64_t clause_offset_t;
+#else
+typedef uint32_t clause_offset_t;
+#endif
+
 struct clause {
     clause() { w = -1; };
 
@@ -31,6 +43,92 @@ struct clause {
     };
 };
 
+// Literals of one clause, in place in a clause_store.
+template <typename T>
+class literal_span {
+    public:
+        literal_span(T *b, T *e) : b(b), e(e) {};
+        T* begin() const { return b; };
+        T* end() const { return e; };
+        size_t size() const { return e-b; };
+        bool empty() const { return b == e; };
+        T& operator[](size_t i) const { return b[i]; };
+    private:
+        T *b, *e;
+};
+
+// Weight and literals of one clause, in place in a clause_store. It stays
+// valid until clauses or literals are added to the store.
+template <typename W, typename T>
+struct basic_clause_ref {
+    basic_clause_ref(W &w, literal_span<T> literals) : w(w), literals(literals) {};
+    template <typename W2, typename T2>
+    basic_clause_ref(const basic_clause_ref<W2,T2> &c) : w(c.w), literals(c.literals.begin(), c.literals.end()) {};
+
+    inline bool weighted() const { return w >= 0; };
+    W &w;
+    literal_span<T> literals;
+};
+
+typedef basic_clause_ref<weight_t, literal_t> clause_ref;
+typedef basic_clause_ref<const weight_t, const literal_t> const_clause_ref;
+
+// Clauses stored flat: the literals of all clauses in one array, where every
+// clause starts in offsets (with one extra entry for the end), and the
+// weights in a parallel array. Clauses are appended with new_clause() and
+// push_literal(), or copied with append().
+class clause_store {
+    public:
+        clause_store();
+
+        inline size_t size() const { return weights.size(); };
+        inline bool empty() const { return weights.empty(); };
+        inline size_t get_nr_literals() const { return literals.size(); };
+        void clear();
+        void reserve(size_t clauses, size_t literals);
+
+        inline clause_ref operator[](size_t);
+        inline const_clause_ref operator[](size_t) const;
+        inline clause_ref back();
+
+        inline void new_clause(weight_t w = -1);
+        inline void push_literal(literal_t);
+        void append(const literal_t*, size_t, weight_t);
+        void append(const_clause_ref);
+        void append(const clause&);
+        void erase(const std::vector<bool>&);
+        void swap(clause_store&);
+    private:
+        std::vector<literal_t> literals;
+        std::vector<clause_offset_t> offsets;
+        std::vector<weight_t> weights;
+};
+
+inline clause_ref clause_store::operator[](size_t i){
+    return clause_ref(weights[i], literal_span<literal_t>(literals.data()+offsets[i], literals.data()+offsets[i+1]));
+}
+
+inline const_clause_ref clause_store::operator[](size_t i) const {
+    return const_clause_ref(weights[i], literal_span<const literal_t>(literals.data()+offsets[i], literals.data()+offsets[i+1]));
+}
+
+inline clause_ref clause_store::back(){
+    return (*this)[size()-1];
+}
+
+// starts an empty clause: the end of the last clause becomes the begin and
+// the end of the new one, so offsets keeps size()+1 entries
+inline void clause_store::new_clause(weight_t w){
+    weights.push_back(w);
+    offsets.push_back(offsets.back());
+}
+
+// adds a literal to the last clause
+inline void clause_store::push_literal(literal_t l){
+    literals.push_back(l);
+    offsets.back()++;
+}
+
 typedef std::vector<uint32_t> array_t;
 
 class cnf;
@@ -39,7 +137,7 @@ class expression {
     friend class cnf;
     public:
         expression();
-        std::vector<clause> clauses;
+        clause_store clauses;
 
         void clear();
         unsigned int get_nr_variables() const;
@@ -47,6 +145,7 @@ class expression {
         unsigned int get_nr_deterministic() const;
         unsigned int get_nr_zero() const ;
         unsigned int get_nr_literals() const;
+        unsigned int get_nr_auxiliary() const;
         unsigned int get_nr_clauses() const;
         void map_literals();
         bool is_mapped();
@@ -55,6 +154,7 @@ class expression {
         const array_t& get_variable_to_literal() const;
         const array_t& get_literal_to_variable() const;
         const array_t& get_clause_to_variable() const;
+        const array_t& get_auxiliary_to_variable() const;
         expression& operator=(const expression &e);
 
         const std::vector<literal_t>& get_literal_map();
@@ -65,6 +165,7 @@ class expression {
 
         unsigned int LITERALS;
         unsigned int WEIGHTS;
+        unsigned int AUXILIARY;             // LITERALS+1.. in the clauses, after the weights when written
         unsigned int DETERMINISTIC;
         unsigned int ZERO;
         bool mapped;
@@ -72,6 +173,7 @@ class expression {
         array_t literal_to_variable;
         array_t variable_to_literal;
         array_t clause_to_variable;
+        array_t auxiliary_to_variable;
         std::vector<literal_t> literal_to_literal_map;
         std::vector<weight_t> weight_to_weight_map;
         std::vector<unsigned int> variable_to_variable_map;
@@ -80,6 +182,16 @@ class expression {
 typedef clause clause_t;
 typedef expression expression_t;
 
+// A clause group of the Quine-McCluskey step: the clauses of one variable
+// with equal weight, and the literals they contain mapped to the indices of
+// the QM problem in order of first occurrence.
+struct qm_group_t {
+    uint32_t variable;
+    weight_t weight;
+    std::vector<uint32_t> clauses;
+    std::map<uint32_t,uint32_t> l_to_i;
+};
+
 
 
 class cnf {
@@ -91,6 +203,7 @@ class cnf {
             SYMPLIFY,
             QUINE_MCCLUSKEY,
             SUPPRESS_CONSTRAINTS,
+            CSI,
             BOOL
         };
 
@@ -104,9 +217,15 @@ class cnf {
 
         int encode(bayesnet *bn);
         void set_encoding(int);
+        void set_amo(amo::encoding_t);
         void set_optimization(opt_t);
-        void set_filename(char*);
+        void set_filename(const char*);
         void set_qm_limit(int);
+        void set_threads(unsigned int);
+        void set_verbosity(int);
+        void set_qm_budget(uint64_t nodes, double seconds);
+        void set_qm_cache(const char*);
+        void clear(); // the encoding and options, to encode another network
 
         void print();
 
@@ -119,9 +238,14 @@ class cnf {
         unsigned int get_nr_literals() const;
         unsigned int get_nr_weights() const;
         bayesnet* get_bayesnet() const;
+
+        void get_qm_groups(std::vector<qm_group_t>&) const;
+        template <class T> void get_qm_models(const qm_group_t&, std::vector< cube<T> > &constraints, std::vector< cube<T> > &models) const;
     private:
-        int write(const char*, int i);
-        template <class T> void reduce(std::vector<uint32_t> &, std::vector<clause> &, std::map<uint32_t,uint32_t> &);
+        int write(const char*, int i, unsigned int *clauses = NULL);
+        int write_files(const std::string &prefix);
+        int write_partitions(const char*, const std::vector<std::string>&, const std::vector<unsigned int>&);
+        template <class T> bool reduce(const qm_group_t&, std::vector<clause> &, FILE*);
         inline uint32_t v_to_l(uint32_t, uint32_t);
         probability_t get_probability(unsigned int);
         probability_t get_probability(unsigned int, expression &expr);
@@ -130,18 +254,22 @@ class cnf {
         void encode_partitions();
         void encode_constraints();
         void encode_probabilities();
+        void encode_add(unsigned int);
         void encode_prime();
-        void encode_deterministic_probabilities();
-        void encode_determinism();
-        void encode_equal_probabilities();
         void apply_optimization();
 
         void init();
-        void clear();
 
         std::vector<unsigned int> qm_variable_count;
         unsigned int qm_eligible;
         unsigned int qm_possible;
+        unsigned int qm_interrupted;
+        unsigned int csi_rows;
+        unsigned int csi_clauses;
+        uint64_t qm_rounds;
+        double qm_utilization;
+        threadpool *pool;
+        qm_cache *cache;
         int encoding;
         char *filename;
         bool
@@ -151,9 +279,15 @@ class cnf {
             OPT_SUPPRESS_CONSTRAINTS,
             OPT_SYMPLIFY,
             OPT_QUINE_MCCLUSKEY,
+            OPT_CSI,
             OPT_BOOL;
 
         int QM_LIMIT;
+        amo::encoding_t AMO;
+        unsigned int THREADS;
+        int VERBOSITY;
+        uint64_t QM_NODES;
+        double QM_SECONDS;
         unsigned int CONSTRAINTS;
         unsigned int VARIABLES;
         expression_t expr;
@@ -79,10 +79,11 @@ class cover<T,0> {
         cover& or_assign(cover&, const unsigned int);
         cover& and_assign(cover&, const unsigned int);
         cover& xor_assign(cover&, const unsigned int);
+        bool assign_and(cover&, cover&, const unsigned int);    // true when the intersection is empty
 
     private:
-        bool compat_dummy;
-        T elements[];
+        T elements[0]; // zero-length, so a cover starts with its first element
+
 };
 
 #include "cover.hxx"
@@ -2,6 +2,7 @@
 #define COVER_TH
 
 #include "cover.h"
+#include "cover_simd.h"
 #include "bit.h"
 #include <string.h>
 
@@ -174,9 +175,11 @@ cover<T,0>& cover<T,0>::cast(void *v){
     return *((cover<T,0>*)v);
 }
 
+// covers are padded to whole COVER_ALIGN blocks, the padding stays empty
 template <typename T>
 size_t cover<T,0>::cover_size(unsigned int N){
-    return div_round_up(N,sizeof(cover_element<T>)*8);
+    const unsigned int BLOCK = COVER_ALIGN/sizeof(T);
+    return div_round_up(div_round_up(N,sizeof(cover_element<T>)*8),BLOCK)*BLOCK;
 }
 
 template <typename T>
@@ -203,6 +206,8 @@ bool cover<T,0>::test(unsigned int i) const {
 
 template <typename T>
 unsigned int cover<T,0>::count(const unsigned int N) const {
+    if(sizeof(T)*N >= COVER_SIMD_MIN)
+        return cover_count(elements, sizeof(T)*N);
     unsigned int bc = 0;
     cover_element<T> *elements = get_cover_elements();
     for(unsigned int i = 0; i < N; i++)
@@ -212,6 +217,8 @@ unsigned int cover<T,0>::count(const unsigned int N) const {
 
 template <typename T>
 bool cover<T,0>::none(const unsigned int N) const {
+    if(sizeof(T)*N >= COVER_SIMD_MIN)
+        return cover_none(elements, sizeof(T)*N);
     for(unsigned int i = 0; i < N; i++)
         if(elements[i] != 0)
             return false;
@@ -228,6 +235,8 @@ bool cover<T,0>::all(const unsigned int N) const {
 
 template <typename T>
 bool cover<T,0>::any(const unsigned int N) const {
+    if(sizeof(T)*N >= COVER_SIMD_MIN)
+        return !cover_none(elements, sizeof(T)*N);
     for(unsigned int i = 0; i < N; i++)
         if(elements[i] != 0)
             return true;
@@ -298,32 +307,50 @@ cover<T,0>& cover<T,0>::assign(unsigned int v, const unsigned int N){
 
 template <typename T>
 cover<T,0>& cover<T,0>::assign(cover &c, const unsigned int N) {
-    for(unsigned int i = 0; i < N; i++)
+    if(sizeof(T)*N >= COVER_SIMD_MIN)
+        cover_copy(elements, c.elements, sizeof(T)*N);
+    else for(unsigned int i = 0; i < N; i++)
         elements[i] = c[i];
     return *this;
 }
 
 template <typename T>
 cover<T,0>& cover<T,0>::or_assign(cover &c, const unsigned int N) {
-    for(unsigned int i = 0; i < N; i++)
+    if(sizeof(T)*N >= COVER_SIMD_MIN)
+        cover_or(elements, c.elements, sizeof(T)*N);
+    else for(unsigned int i = 0; i < N; i++)
         elements[i] |= c[i];
     return *this;
 }
 
 template <typename T>
 cover<T,0>& cover<T,0>::and_assign(cover &c, const unsigned int N) {
-    for(unsigned int i = 0; i < N; i++)
+    if(sizeof(T)*N >= COVER_SIMD_MIN)
+        cover_and(elements, c.elements, sizeof(T)*N);
+    else for(unsigned int i = 0; i < N; i++)
         elements[i] &= c[i];
     return *this;
 }
 
 template <typename T>
 cover<T,0>& cover<T,0>::xor_assign(cover &c, const unsigned int N) {
-    for(unsigned int i = 0; i < N; i++)
+    if(sizeof(T)*N >= COVER_SIMD_MIN)
+        cover_xor(elements, c.elements, sizeof(T)*N);
+    else for(unsigned int i = 0; i < N; i++)
         elements[i] ^= c[i];
     return *this;
 }
 
+template <typename T>
+bool cover<T,0>::assign_and(cover &a, cover &b, const unsigned int N) {
+    if(sizeof(T)*N >= COVER_SIMD_MIN)
+        return cover_and_to(elements, a.elements, b.elements, sizeof(T)*N);
+    T acc = 0;
+    for(unsigned int i = 0; i < N; i++)
+        acc |= (elements[i] = a[i] & b[i]);
+    return acc == 0;
+}
+
 template <typename T>
 cover<T,0>& cover<T,0>::not_assign(unsigned int N){
     for(unsigned int i = 0; i < N; i++)
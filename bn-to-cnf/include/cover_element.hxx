@@ -25,12 +25,12 @@ unsigned int cover_element<T>::count() const{
 
 template <typename T>
 bool cover_element<T>::test(unsigned int i) const {
-    return (value >> i) & (T)1;
+    return ((value >> i) & (T)1) != (T)0;
 }
 
 template <typename T>
 bool cover_element<T>::any() const {
-    return value;
+    return value != (T)0;
 }
 
 template <typename T>
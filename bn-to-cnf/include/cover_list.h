@@ -30,7 +30,7 @@ class cover_list {
     private:
         unsigned int SIZE;
         unsigned int COVER_SIZE;
-        T covers[];
+        alignas(COVER_ALIGN) T covers[];
 };
 
 #include "cover_list.hxx"
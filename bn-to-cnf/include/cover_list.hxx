@@ -3,7 +3,7 @@
 template <typename T>
 void cover_list<T>::init(const unsigned int value){
     if(value == 1)
-        memset(covers, ~(T)0, sizeof(T)*SIZE*COVER_SIZE);
+        memset(covers, 0xff, sizeof(T)*SIZE*COVER_SIZE);
     else if(value == 0)
         memset(covers, (T)0, sizeof(T)*SIZE*COVER_SIZE);
     else
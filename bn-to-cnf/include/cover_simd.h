@@ -0,0 +1,38 @@
+#ifndef COVER_SIMD_H
+#define COVER_SIMD_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Alignment of cover storage, and the granularity covers are padded to.
+#define COVER_ALIGN 32
+
+// Kernels for the bitwise operations of cover<T,0> and cover_list, working
+// on raw bytes. The widest instruction set the CPU supports is selected at
+// the first call, covers shorter than COVER_SIMD_MIN bytes are handled
+// inline by the cover itself.
+#define COVER_SIMD_MIN 16
+
+enum cover_isa_t {
+    COVER_SCALAR,
+    COVER_SSE2,
+    COVER_AVX2
+};
+
+cover_isa_t cover_get_isa();
+bool cover_set_isa(cover_isa_t);
+const char* cover_isa_name(cover_isa_t);
+
+void cover_copy(void *dst, const void *src, size_t bytes);
+void cover_and(void *dst, const void *src, size_t bytes);
+void cover_or(void *dst, const void *src, size_t bytes);
+void cover_xor(void *dst, const void *src, size_t bytes);
+bool cover_and_to(void *dst, const void *a, const void *b, size_t bytes);   // dst = a & b, true when dst is empty
+bool cover_none(const void *src, size_t bytes);
+size_t cover_count(const void *src, size_t bytes);
+
+inline void* cover_align(void *p){
+    return (void*) (((uintptr_t) p + COVER_ALIGN-1) & ~(uintptr_t) (COVER_ALIGN-1));
+}
+
+#endif
@@ -2,6 +2,8 @@
 #define HUGIN_H
 
 #include "reader.h"
+#include "lexer.h"
+#include "config.h"
 #include <string>
 #include <vector>
 #include <map>
@@ -59,16 +61,17 @@ namespace HUGIN {
     struct variable {
         void print();
         variable();
-        void parse(reader&, unsigned int d = 0);
+        template <class R> void parse(R&, unsigned int d = 0);
         variable_type type;
         unsigned int dimensions;
         std::vector<unsigned int> dim;
         std::vector<std::string> value;
+        std::vector<probability_t> number; // numeric values of float variables
     };
 
     struct attribute {
         void print();
-        void parse(reader&);
+        template <class R> void parse(R&);
 
         std::string name;
         variable value;
@@ -76,7 +79,7 @@ namespace HUGIN {
 
     struct domain_element {
         void print();
-        void parse(reader&);
+        template <class R> void parse(R&);
         attribute* get_attribute(std::string);
         domain_element_type type;
         std::string name;
@@ -85,13 +88,13 @@ namespace HUGIN {
 
     struct domain_header {
         void print();
-        void parse(reader&);
+        template <class R> void parse(R&);
         std::vector <attribute> attr;
     };
 
     struct domain_definition {
         void print();
-        void parse(reader&);
+        template <class R> void parse(R&);
         domain_header header;
         std::vector<domain_element> elements;
     };
@@ -103,11 +106,12 @@ struct hugin {
 
     void process(std::string); // throws parser_exception
     HUGIN::domain_definition definition;
-    void parse(reader&);
     void print();
-    reader input;
+    lexer mapped; // used whenever the file can be memory-mapped
+    reader input; // fallback for pipes and other unmappable files
     bayesnet* get_bayesnet();
     std::string filename;
+    std::vector<std::string> query; // only their ancestors are kept, if any
 };
 
 #endif
@@ -0,0 +1,61 @@
+#ifndef LEXER_H
+#define LEXER_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <stack>
+#include <stdarg.h>
+#include "reader.h"
+#include "error.h"
+
+// Memory-mapped counterpart of the reader. The file is mapped once and
+// tokens are returned as views into the mapping, so no characters are copied
+// while lexing. A view stays valid until close() is called. The delimiter
+// semantics are identical to those of the reader; the reader remains the
+// fallback for inputs that cannot be mapped (pipes, character devices).
+class lexer {
+    public:
+        lexer();
+        ~lexer();
+
+        bool open(std::string);
+        void close();
+
+        void add_delimiter(delimiter_type, char, char ce = '\0');
+        void add_delimiters(delimiter_type, unsigned int, ...);
+
+        std::string_view last_word();
+        std::string_view get_word();
+        std::string_view get_word_peek();
+        int get_row();
+        int get_col();
+        void get_word_equal_or_assert(std::string_view);
+        void get_word_not_equal_or_assert(std::string_view);
+        bool get_word_peek_equal(std::string_view);
+        bool get_word_peek_not_equal(std::string_view);
+
+        int get_scope_depth();
+        std::string get_filename();
+        void allow_eof(bool);
+    private:
+        delimiter_t get_delimiter(char);
+        std::string_view next_word();
+
+        bool eof_allowed;
+        bool eof_reached;
+        std::string filename;
+        const char *data;
+        const char *pos;
+        const char *end;
+        size_t size;
+        std::vector<delimiter_t> delimiters;
+        delimiter_t table[256];
+        std::stack<delimiter_t> scope;
+        bool hierarchical;
+        bool commented;
+        bool buffered;
+        std::string_view bufferword;
+};
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdint.h>
+#include <string>
+
+// Instrumentation shared by the tools of the pipeline: scoped phase timers,
+// counters and peak RSS samples of the process. Nothing is recorded until
+// enable() is called, a phase then costs two clock reads and a getrusage.
+// write() emits a JSON summary, phases aggregated by name, and/or a Chrome
+// trace (chrome://tracing, Perfetto) of every phase per thread.
+// Recording is thread safe.
+namespace metrics {
+    void enable(const char *tool, const std::string &json, const std::string &trace = "");
+    bool enabled();
+
+    void count(const char *name, int64_t n = 1);    // added up
+    void set(const char *name, double value);       // the last value is kept
+    void sample_rss(const char *name);              // peak RSS so far
+    int write();
+
+    // the name is kept by pointer, a string literal
+    class phase {
+        public:
+            phase(const char *name);
+            ~phase();
+            void end();                             // before the end of the scope
+        private:
+            const char *name;
+            uint64_t start;
+    };
+}
+
+#endif
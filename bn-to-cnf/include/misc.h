@@ -2,10 +2,13 @@
 #define MISC_H
 
 #include <string.h>
+#include <stdio.h>
+#include <string>
 
 const char *get_filename_ext(const char *filename);
 char *get_basename(char *filename);
 void remove_ext(const char *filename);
+void write_json_string(FILE *file, const std::string &s);
 
 #endif
 
@@ -43,8 +43,10 @@ typedef __uint128_t uint128_t;
 
 #endif
 
+#include "wide.h"
 #include "cube.h"
 #include "cover_element.h"
+#include "threadpool.h"
 #include <stdint.h>
 #include <stddef.h>
 #include <stdio.h>
@@ -56,6 +58,10 @@ typedef __uint128_t uint128_t;
 template <typename M>
 class qm {
     public:
+        // pairwise scan of adjacent bitcount groups, or hash lookups of the
+        // partners of every cube
+        enum merge_t { MERGE_PAIRS, MERGE_HASH };
+
         qm();
         ~qm();
 
@@ -64,13 +70,21 @@ class qm {
         inline void add_model(M);
         void clear();
         int solve();
-
-        int canonical_primes();
+        void set_pool(threadpool*);
+        void set_merge(merge_t);
+        void set_budget(uint64_t nodes, double seconds);
+        bool interrupted_search() const;
+        bool out_of_time() const;
+        const std::vector<float>& get_utilization() const;
+
+        int canonical_primes(bool minimal = true);
         size_t required_size();
         void print(bool characters = false);
 
-        template <typename T> int compute_primes(std::vector< cube<T> >&);
+        template <typename T> int compute_primes(std::vector< cube<T> >&, bool minimal = true);
         template <typename T> int quine_mccluskey(std::vector< cube<T> >&);
+        template <typename T> int quine_mccluskey_pairs(std::vector< cube<T> >&);
+        template <typename T> int quine_mccluskey_hash(std::vector< cube<T> >&);
         template <typename P, typename T> int reduce(std::vector< cube<P> >&);
         template <typename T> inline unsigned int get_weight(cube<T>&, const T&) const;
         template <typename P> void print_cubes(std::vector< cube<P> >&);
@@ -86,8 +100,25 @@ class qm {
         std::vector<unsigned int> variables;         // variables with least significant bit first (variables[0])
         std::set< M > models;
         std::vector< cube<M> > primes;
+        threadpool *pool;
+        merge_t merge;
+        std::vector<float> utilization;            // busy fraction of the pool per merge round
+        uint64_t max_nodes;                        // budget of the minimal cover search, 0 is unlimited
+        double max_seconds;
+        uint64_t deadline;                         // end of the time budget, 0 is unlimited
+        bool expired;                              // the time ran out before the primes were found
+        bool interrupted;                          // the last cover search ran out of budget
+
+        inline bool past_deadline();
 };
 
+template <typename M>
+inline bool qm<M>::past_deadline(){
+    if(deadline && !expired && threadpool::now() >= deadline)
+        expired = true;
+    return expired;
+}
+
 template <typename M>
 inline void qm<M>::add_variable(uint32_t v, int index){
     if(index == -1)
@@ -110,8 +141,11 @@ inline void qm<M>::add_model(cube<M> model){
         cover_element<M> m;
         m = model[0];
 
+        unsigned long n = 0;
         while(true){
             models.insert(m.value);
+            if(deadline && ++n % 4096 == 0 && past_deadline())
+                return;
 
             bool changed = false;
             for(unsigned int i = 0; i < variables.size(); i++){
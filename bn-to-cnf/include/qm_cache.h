@@ -0,0 +1,77 @@
+#ifndef QM_CACHE_H
+#define QM_CACHE_H
+
+#include <pthread.h>
+#include <stdint.h>
+#include <atomic>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Content-addressed store of Quine-McCluskey results. A key describes a
+// clause group in index space (the literal layout and the clauses), the
+// value holds the prime clauses in the same index space, so equal groups of
+// different variables or networks share an entry. The file is mapped
+// read-only and may be shared by concurrent readers: new entries are kept in
+// memory and save() writes a new file that replaces the old one by rename.
+// Writers serialize on a lock file next to the cache, and save() merges the
+// entries other runs saved since this one opened the cache.
+class qm_cache {
+    public:
+        typedef std::vector<int32_t> key_t;
+        typedef std::vector< std::vector<int32_t> > value_t;
+
+        qm_cache();
+        ~qm_cache();
+
+        bool open(std::string);
+        bool save();
+        void close();
+
+        bool lookup(const key_t&, value_t&);
+        void insert(const key_t&, const value_t&);
+
+        uint64_t get_hits() const;
+        uint64_t get_misses() const;
+        size_t size() const;
+    private:
+        struct header_t {
+            uint64_t magic;
+            uint32_t version;
+            uint32_t entries;
+        };
+
+        // offsets and sizes are in 32-bit words from the start of the payload
+        struct entry_t {
+            uint64_t hash;
+            uint64_t offset;
+            uint32_t key_size;
+            uint32_t value_size;
+        };
+
+        // a validated, read-only mapping of a cache file
+        struct mapping_t {
+            const char *data;
+            size_t size;
+            const entry_t *entries;
+            uint32_t ENTRIES;
+            const int32_t *payload;
+        };
+
+        static bool map(const std::string&, mapping_t&);
+        static void unmap(mapping_t&);
+        static uint64_t hash(const int32_t*, size_t);
+        static void encode(const value_t&, std::vector<int32_t>&);
+        static bool decode(const int32_t*, size_t, value_t&);
+
+        std::string filename;
+        mapping_t mapped;
+
+        pthread_mutex_t mutex;
+        std::unordered_map<uint64_t, std::vector< std::pair<key_t, std::vector<int32_t> > > > pending;
+        size_t pending_size;
+        std::atomic<uint64_t> hits;
+        std::atomic<uint64_t> misses;
+};
+
+#endif
@@ -0,0 +1,78 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <pthread.h>
+#include <stdint.h>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <vector>
+
+// Persistent pool of worker threads. Every worker owns a task deque: it
+// takes work from the back of its own deque and steals from the front of
+// the others when it runs dry. Tasks are submitted as part of a batch and
+// wait() executes outstanding tasks on the calling thread until the batch
+// is done, which makes it safe to wait on a batch from inside a task.
+class threadpool {
+    public:
+        struct batch {
+            batch(bool measured = false) : pending(0), busy(0), tasks(0), measured(measured) {};
+            std::atomic<unsigned int> pending;
+            std::atomic<uint64_t> busy;     // nanoseconds spent in tasks
+            unsigned int tasks;
+            bool measured;                  // busy time counts towards the utilization of rounds
+        };
+
+        // A round of measured batches. Rounds may overlap: the capacity of
+        // the pool is counted once for the time in which any round runs.
+        struct round {
+            uint64_t start;
+            uint64_t busy;                  // measured busy time of the pool at the start
+        };
+
+        threadpool(unsigned int threads = 0);
+        ~threadpool();
+
+        void submit(batch&, std::function<void()>);
+        void wait(batch&);
+        unsigned int get_concurrency() const;
+
+        void begin_round(round&);
+        float end_round(const round&);
+        uint64_t get_rounds() const;
+        double get_utilization() const;
+
+        static uint64_t now();
+    private:
+        struct task_t {
+            std::function<void()> f;
+            batch *b;
+        };
+
+        struct queue_t {
+            pthread_mutex_t mutex;
+            std::deque<task_t> tasks;
+        };
+
+        static void* worker(void*);
+        bool run_one(unsigned int);
+        unsigned int self() const;
+
+        unsigned int WORKERS;
+        std::vector<pthread_t> threads;
+        std::vector<queue_t> queues;       // one per worker, the last one is shared by outside threads
+        std::atomic<unsigned int> queued;
+        std::atomic<unsigned int> next;
+        pthread_mutex_t sleep_mutex;
+        pthread_cond_t wake;
+        bool stop;
+
+        pthread_mutex_t round_mutex;
+        unsigned int active_rounds;
+        uint64_t active_start;
+        std::atomic<uint64_t> rounds;
+        std::atomic<uint64_t> busy_time;
+        std::atomic<uint64_t> capacity_time;
+};
+
+#endif
@@ -0,0 +1,223 @@
+#ifndef WIDE_H
+#define WIDE_H
+
+#include <stdint.h>
+#include <string.h>
+#include <type_traits>
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+// Fixed width unsigned integer of BITS bits (a multiple of 64), stored least
+// significant word first. It behaves like the builtin unsigned types, so
+// cover_element, cube and qm can be instantiated on it for clause groups
+// wider than 128 literals. The bitwise operations use AVX2 (256 bits) and
+// AVX-512 (512 bits) when the compiler targets them, and loops over the
+// 64-bit words otherwise.
+template <unsigned int BITS>
+class alignas(BITS >= 512 ? 64 : 32) wide {
+    static_assert(BITS % 64 == 0, "wide integers consist of 64-bit words");
+    template <typename I>
+    using integral = std::enable_if_t<std::is_integral<I>::value || std::is_same<I,__int128_t>::value || std::is_same<I,__uint128_t>::value>;
+
+    public:
+        static const unsigned int WORDS = BITS/64;
+
+        wide() = default;
+
+        template <typename I, typename = integral<I> >
+        wide(I v){
+            bool negative = std::is_signed<I>::value && v < (I) 0;
+            memset(w, negative ? 0xff : 0, sizeof(w));
+            w[0] = (uint64_t) v;
+            if(sizeof(I) > sizeof(uint64_t))
+                w[1] = (uint64_t) (((__uint128_t) v) >> 64);
+        };
+
+        template <unsigned int B, typename = std::enable_if_t<(B < BITS)> >
+        wide(const wide<B> &v){
+            memset(w, 0, sizeof(w));
+            memcpy(w, v.w, sizeof(v.w));
+        };
+
+        template <unsigned int B, typename = std::enable_if_t<(B > BITS)>, typename = void>
+        explicit wide(const wide<B> &v){
+            memcpy(w, v.w, sizeof(w));
+        };
+
+        explicit operator bool() const {
+            return !is_zero();
+        };
+
+        template <typename I, typename = integral<I> >
+        explicit operator I() const {
+            if(sizeof(I) > sizeof(uint64_t))
+                return (I) ((((__uint128_t) w[1]) << 64) | w[0]);
+            return (I) w[0];
+        };
+
+        bool is_zero() const {
+            #if defined(__AVX512F__)
+            if constexpr (BITS == 512)
+                return _mm512_test_epi64_mask(load512(0), load512(0)) == 0;
+            #endif
+            #if defined(__AVX2__)
+            if constexpr (BITS % 256 == 0){
+                for(unsigned int i = 0; i < WORDS; i += 4)
+                    if(!_mm256_testz_si256(load256(i), load256(i)))
+                        return false;
+                return true;
+            }
+            #endif
+            for(unsigned int i = 0; i < WORDS; i++)
+                if(w[i])
+                    return false;
+            return true;
+        };
+
+        // summed in 64-bit lanes: GCC 12 miscompiles the narrowing sum of
+        // vectorized popcounts when part of the value is a known constant
+        unsigned int count() const {
+            #if defined(__AVX512VPOPCNTDQ__) && defined(__AVX512F__)
+            if constexpr (BITS == 512)
+                return _mm512_reduce_add_epi64(_mm512_popcnt_epi64(load512(0)));
+            #endif
+            uint64_t c = 0;
+            for(unsigned int i = 0; i < WORDS; i++)
+                c += __builtin_popcountll(w[i]);
+            return c;
+        };
+
+        wide operator~() const {
+            wide r;
+            #if defined(__AVX512F__)
+            if constexpr (BITS == 512){
+                r.store512(0, _mm512_ternarylogic_epi64(load512(0), load512(0), load512(0), 0x55));
+                return r;
+            }
+            #endif
+            for(unsigned int i = 0; i < WORDS; i++)
+                r.w[i] = ~w[i];
+            return r;
+        };
+
+        wide& operator&=(const wide &v){ apply<AND>(v); return *this; };
+        wide& operator|=(const wide &v){ apply<OR>(v); return *this; };
+        wide& operator^=(const wide &v){ apply<XOR>(v); return *this; };
+
+        wide& operator<<=(unsigned int s){
+            if(s >= BITS){
+                memset(w, 0, sizeof(w));
+                return *this;
+            }
+            unsigned int q = s/64, r = s%64;
+            for(int i = WORDS-1; i >= 0; i--){
+                uint64_t v = (i >= (int) q ? w[i-q] << r : 0);
+                if(r && i > (int) q)
+                    v |= w[i-q-1] >> (64-r);
+                w[i] = v;
+            }
+            return *this;
+        };
+
+        wide& operator>>=(unsigned int s){
+            if(s >= BITS){
+                memset(w, 0, sizeof(w));
+                return *this;
+            }
+            unsigned int q = s/64, r = s%64;
+            for(unsigned int i = 0; i < WORDS; i++){
+                uint64_t v = (i+q < WORDS ? w[i+q] >> r : 0);
+                if(r && i+q+1 < WORDS)
+                    v |= w[i+q+1] << (64-r);
+                w[i] = v;
+            }
+            return *this;
+        };
+
+        wide& operator+=(const wide &v){
+            uint64_t carry = 0;
+            for(unsigned int i = 0; i < WORDS; i++){
+                uint64_t s = w[i] + v.w[i];
+                uint64_t c = s < w[i];
+                w[i] = s + carry;
+                carry = c | (w[i] < s);
+            }
+            return *this;
+        };
+
+        wide& operator-=(const wide &v){
+            uint64_t borrow = 0;
+            for(unsigned int i = 0; i < WORDS; i++){
+                uint64_t d = w[i] - v.w[i];
+                uint64_t b = w[i] < v.w[i];
+                w[i] = d - borrow;
+                borrow = b | (d < borrow);
+            }
+            return *this;
+        };
+
+        friend wide operator&(wide a, const wide &b){ return a &= b; };
+        friend wide operator|(wide a, const wide &b){ return a |= b; };
+        friend wide operator^(wide a, const wide &b){ return a ^= b; };
+        friend wide operator+(wide a, const wide &b){ return a += b; };
+        friend wide operator-(wide a, const wide &b){ return a -= b; };
+        friend wide operator<<(wide a, unsigned int s){ return a <<= s; };
+        friend wide operator>>(wide a, unsigned int s){ return a >>= s; };
+
+        friend bool operator==(const wide &a, const wide &b){ return (a ^ b).is_zero(); };
+        friend bool operator!=(const wide &a, const wide &b){ return !(a == b); };
+        friend bool operator<(const wide &a, const wide &b){
+            for(int i = WORDS-1; i >= 0; i--)
+                if(a.w[i] != b.w[i])
+                    return a.w[i] < b.w[i];
+            return false;
+        };
+
+        uint64_t w[WORDS];
+    private:
+        enum op_t { AND, OR, XOR };
+
+        template <op_t OP>
+        void apply(const wide &v){
+            #if defined(__AVX512F__)
+            if constexpr (BITS == 512){
+                __m512i a = load512(0), b = v.load512(0);
+                store512(0, OP == AND ? _mm512_and_si512(a, b) : OP == OR ? _mm512_or_si512(a, b) : _mm512_xor_si512(a, b));
+                return;
+            }
+            #endif
+            #if defined(__AVX2__)
+            if constexpr (BITS % 256 == 0){
+                for(unsigned int i = 0; i < WORDS; i += 4){
+                    __m256i a = load256(i), b = v.load256(i);
+                    store256(i, OP == AND ? _mm256_and_si256(a, b) : OP == OR ? _mm256_or_si256(a, b) : _mm256_xor_si256(a, b));
+                }
+                return;
+            }
+            #endif
+            for(unsigned int i = 0; i < WORDS; i++)
+                w[i] = (OP == AND ? w[i] & v.w[i] : OP == OR ? w[i] | v.w[i] : w[i] ^ v.w[i]);
+        };
+
+        #if defined(__AVX2__)
+        __m256i load256(unsigned int i) const { return _mm256_load_si256((const __m256i*) (w+i)); };
+        void store256(unsigned int i, __m256i v){ _mm256_store_si256((__m256i*) (w+i), v); };
+        #endif
+        #if defined(__AVX512F__)
+        __m512i load512(unsigned int i) const { return _mm512_load_si512((const void*) (w+i)); };
+        void store512(unsigned int i, __m512i v){ _mm512_store_si512((void*) (w+i), v); };
+        #endif
+
+        template <unsigned int B> friend class wide;
+};
+
+typedef wide<256> uint256_t;
+typedef wide<512> uint512_t;
+
+template <unsigned int BITS>
+inline unsigned int bitcount(wide<BITS> x){
+    return x.count();
+}
+
+#endif
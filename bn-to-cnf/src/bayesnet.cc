@@ -1,147 +1,265 @@
 //#include "exceptions.h"
 #include "bayesnet.h"
 #include <deque>
-#include <list>
 #include <algorithm>
 #include <string.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "cnf.h"
 #include "parser.h"
 using namespace std;
 
 // Note: exceptions have been removed as I can't get the header to work
 
-dynamic_bayesnet::node* dynamic_bayesnet::get_node(std::string name){
-    dynamic_bayesnet::node* n = &(nodes[name]);
-    n->name = name;
-    return n;
+dynamic_bayesnet::dynamic_bayesnet(){
+    parent_size = 0;
+    child_size = 0;
+    dim_size = 0;
+    cpt_size = 0;
+}
+
+// FNV-1a
+uint64_t dynamic_bayesnet::hash(const std::string &name){
+    uint64_t h = 14695981039346656037ull;
+    for(size_t i = 0; i < name.size(); i++){
+        h ^= (unsigned char) name[i];
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+// doubles the index, at most half of its slots are in use
+void dynamic_bayesnet::grow(){
+    vector<uint32_t>(index.empty() ? 64 : index.size()*2, 0).swap(index);
+    const size_t mask = index.size()-1;
+    for(uint32_t id = 0; id < nodes.size(); id++){
+        size_t slot = hash(nodes[id].name) & mask;
+        while(index[slot])
+            slot = (slot+1) & mask;
+        index[slot] = id+1;
+    }
+}
+
+int dynamic_bayesnet::find(const std::string &name) const {
+    if(index.empty())
+        return -1;
+    const size_t mask = index.size()-1;
+    for(size_t slot = hash(name) & mask; index[slot]; slot = (slot+1) & mask)
+        if(nodes[index[slot]-1].name == name)
+            return index[slot]-1;
+    return -1;
+}
+
+uint32_t dynamic_bayesnet::get_id(const std::string &name){
+    if(2*(nodes.size()+1) > index.size())
+        grow();
+    const size_t mask = index.size()-1;
+    size_t slot = hash(name) & mask;
+    for(; index[slot]; slot = (slot+1) & mask)
+        if(nodes[index[slot]-1].name == name)
+            return index[slot]-1;
+
+    uint32_t id = nodes.size();
+    nodes.push_back(dynamic_bayesnet::node(name));
+    removed.push_back(false);
+    index[slot] = id+1;
+    return id;
+}
+
+dynamic_bayesnet::node* dynamic_bayesnet::get_node(uint32_t id){
+    return id < nodes.size() ? &nodes[id] : NULL;
+}
+
+dynamic_bayesnet::node* dynamic_bayesnet::get_node(const std::string &name){
+    return &nodes[get_id(name)];
+}
+
+void dynamic_bayesnet::add_edge(uint32_t parent, uint32_t child){
+    nodes[child].parent.push_back(parent);
+    nodes[parent].child.push_back(child);
 }
 
+// keeps the largest weakly connected component, the first one found (in
+// order of the ids) of those of equal size
 int dynamic_bayesnet::wcc(){
-    int node_count = nodes.size();
-    if(node_count == 0)
+    const uint32_t N = nodes.size();
+    if(N == 0)
         return 0;
 
-    vector< list<string> > subnet;
-    map<dynamic_bayesnet::node*,bool> frontier;
-    for(auto it = nodes.begin(); it != nodes.end(); it++)
-        frontier[&(it->second)] = true;
-
-    deque<dynamic_bayesnet::node*> q;
-    while(node_count > 0){
-        unsigned int subnet_id = subnet.size();
-        subnet.resize(subnet_id+1);
-
-        for(auto it = frontier.begin(); it != frontier.end(); it++){
-            if(it->second){
-                q.push_back(it->first);
-                it->second = false;
-                node_count--;
-                break;
-            }
-        }
+    vector<uint32_t> component(N, UINT32_MAX);
+    vector<uint32_t> component_size;
+    deque<uint32_t> q;
+    for(uint32_t root = 0; root < N; root++){
+        if(removed[root] || component[root] != UINT32_MAX)
+            continue;
+        uint32_t c = component_size.size();
+        component_size.push_back(0);
+        component[root] = c;
+        q.push_back(root);
 
         while(!q.empty()){
-            dynamic_bayesnet::node *n = q.front();
-            subnet[subnet_id].push_back(n->name);
+            const dynamic_bayesnet::node &n = nodes[q.front()];
             q.pop_front();
-            node_count--;
+            component_size[c]++;
 
-            for(unsigned int i = 0; i < n->parent.size(); i++){
-                if(frontier[n->parent[i]]){
-                    frontier[n->parent[i]] = false;
-                    q.push_back(n->parent[i]);
+            for(unsigned int i = 0; i < n.parent.size(); i++){
+                if(component[n.parent[i]] == UINT32_MAX){
+                    component[n.parent[i]] = c;
+                    q.push_back(n.parent[i]);
                 }
             }
 
-            for(unsigned int i = 0; i < n->child.size(); i++){
-                if(frontier[n->child[i]]){
-                    frontier[n->child[i]] = false;
-                    q.push_back(n->child[i]);
+            for(unsigned int i = 0; i < n.child.size(); i++){
+                if(component[n.child[i]] == UINT32_MAX){
+                    component[n.child[i]] = c;
+                    q.push_back(n.child[i]);
                 }
             }
         }
     }
 
-    int list_id = -1;
-    for(unsigned int i = 0; i < subnet.size(); i++){
-        if(list_id == -1 || (subnet[list_id].size() < subnet[i].size()))
-            list_id = i;
-    }
+    if(component_size.empty())
+        throw dynamic_bayesnet_error("no connected components");
+    uint32_t largest = max_element(component_size.begin(), component_size.end()) - component_size.begin();
 
     int node_count_deleted = 0;
-    if(list_id >= 0){
-        int node_count_deleted = nodes.size() - subnet[list_id].size();
-        if(node_count_deleted > 0){
-            auto it = nodes.begin();
-            while(it != nodes.end()){
-                if(find(subnet[list_id].begin(), subnet[list_id].end(), it->second.name) == subnet[list_id].end()){
-                    auto del_it = it;
-                    it++;
-                    nodes.erase(del_it);
-                } else it++;
+    for(uint32_t id = 0; id < N; id++){
+        if(!removed[id] && component[id] != largest){
+            removed[id] = true;
+            node_count_deleted++;
+        }
+    }
+
+    return node_count_deleted;
+}
+
+// keeps the ancestors of the query nodes only, the other nodes are barren:
+// summed out they leave the distribution of the query nodes unchanged
+int dynamic_bayesnet::prune(const vector<string> &query){
+    vector<bool> relevant(nodes.size(), false);
+    deque<uint32_t> q;
+    for(unsigned int i = 0; i < query.size(); i++){
+        int id = find(query[i]);
+        if(id < 0 || removed[id])
+            throw dynamic_bayesnet_error("query node '%s' is not in the network", query[i].c_str());
+        if(!relevant[id]){
+            relevant[id] = true;
+            q.push_back(id);
+        }
+    }
+
+    while(!q.empty()){
+        const dynamic_bayesnet::node &n = nodes[q.front()];
+        q.pop_front();
+        for(unsigned int i = 0; i < n.parent.size(); i++){
+            if(!relevant[n.parent[i]]){
+                relevant[n.parent[i]] = true;
+                q.push_back(n.parent[i]);
             }
         }
-    } else throw dynamic_bayesnet_error("no connected components");
+    }
+
+    // parents of relevant nodes are relevant, only the children can dangle
+    int node_count_deleted = 0;
+    for(uint32_t id = 0; id < nodes.size(); id++){
+        if(removed[id])
+            continue;
+        if(!relevant[id]){
+            removed[id] = true;
+            node_count_deleted++;
+        } else {
+            vector<uint32_t> &child = nodes[id].child;
+            unsigned int kept = 0;
+            for(unsigned int i = 0; i < child.size(); i++)
+                if(relevant[child[i]])
+                    child[kept++] = child[i];
+            child.resize(kept);
+        }
+    }
 
     return node_count_deleted;
 }
 
 void dynamic_bayesnet::print(){
-    printf("number of nodes: %lu\n", nodes.size());
-    for(auto it = nodes.begin(); it != nodes.end(); it++){
-        printf("  * node %s\n", it->first.c_str());
-
-        printf("    - values   (%lu):", it->second.value.size());
-        for(unsigned int j = 0; j < it->second.value.size(); j++)
-            printf(" [%s]", it->second.value[j].c_str());
+    vector<uint32_t> ids = order;
+    if(ids.empty())
+        for(uint32_t id = 0; id < nodes.size(); id++)
+            if(!removed[id])
+                ids.push_back(id);
+
+    printf("number of nodes: %lu\n", ids.size());
+    for(unsigned int k = 0; k < ids.size(); k++){
+        const dynamic_bayesnet::node &n = nodes[ids[k]];
+        printf("  * node %s\n", n.name.c_str());
+
+        printf("    - values   (%lu):", n.value.size());
+        for(unsigned int j = 0; j < n.value.size(); j++)
+            printf(" [%s]", n.value[j].c_str());
         printf("\n");
 
-        printf("    - parents  (%lu):", it->second.parent.size());
-        for(unsigned int j = 0; j < it->second.parent.size(); j++)
-            printf(" %s", it->second.parent[j]->name.c_str());
+        printf("    - parents  (%lu):", n.parent.size());
+        for(unsigned int j = 0; j < n.parent.size(); j++)
+            printf(" %s", nodes[n.parent[j]].name.c_str());
         printf("\n");
 
-        printf("    - children (%lu):", it->second.child.size());
-        for(unsigned int j = 0; j < it->second.child.size(); j++)
-            printf(" %s", it->second.child[j]->name.c_str());
+        printf("    - children (%lu):", n.child.size());
+        for(unsigned int j = 0; j < n.child.size(); j++)
+            printf(" %s", nodes[n.child[j]].name.c_str());
         printf("\n");
 
         printf("    - CPT");
-        for(unsigned int j = 0; j < it->second.dim.size(); j++)
-            printf("[%d]", it->second.dim[j]);
-        printf(" (%lu):", it->second.cpt.size());
-        for(unsigned int j = 0; j < it->second.cpt.size(); j++)
-            printf(" %lf", it->second.cpt[j]);
+        for(unsigned int j = 0; j < n.dim.size(); j++)
+            printf("[%d]", n.dim[j]);
+        printf(" (%lu):", n.cpt.size());
+        for(unsigned int j = 0; j < n.cpt.size(); j++)
+            printf(" %lf", n.cpt[j]);
         printf("\n");
     }
 }
 
-void dynamic_bayesnet::finalize(){
+void dynamic_bayesnet::finalize(const vector<string> &query){
     wcc();
+    if(!query.empty())
+        prune(query);
+
+    // the ids of the network are in order of the names, as they always were,
+    // which keeps the variables of the CNF (and .bnb caches) as they are
+    order.clear();
+    for(uint32_t id = 0; id < nodes.size(); id++)
+        if(!removed[id])
+            order.push_back(id);
+    sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b){ return nodes[a].name < nodes[b].name; });
 
     parent_size = 0;
     child_size = 0;
     dim_size = 0;
     cpt_size = 0;
-    for(auto it = nodes.begin(); it != nodes.end(); it++){
-        it->second.dim.resize(it->second.parent.size()+1);
-        it->second.dim[0] = it->second.value.size();
-        for(unsigned int i = 0; i < it->second.parent.size(); i++)
-            it->second.dim[i+1] = it->second.parent[i]->value.size();
-
-        unsigned int mult = it->second.dim[0];
-        for(unsigned int i = 1; i < it->second.dim.size(); i++)
-            mult *= it->second.dim[i];
+    for(unsigned int k = 0; k < order.size(); k++){
+        dynamic_bayesnet::node &n = nodes[order[k]];
+        n.dim.resize(n.parent.size()+1);
+        n.dim[0] = n.value.size();
+        for(unsigned int i = 0; i < n.parent.size(); i++)
+            n.dim[i+1] = nodes[n.parent[i]].value.size();
+
+        // a single CPT is indexed 32-bit, the network as a whole 64-bit
+        uint64_t mult = n.dim[0];
+        for(unsigned int i = 1; i < n.dim.size() && mult <= UINT32_MAX; i++)
+            mult *= n.dim[i];
+        if(mult > UINT32_MAX)
+            throw dynamic_bayesnet_error("CPT of node '%s' has more than %u entries", n.name.c_str(), UINT32_MAX);
 
         if(mult){
-            if(it->second.cpt.size() != mult)
-                throw dynamic_bayesnet_error("CPT of node '%s' is incomplete", it->second.name.c_str());
-        } else throw dynamic_bayesnet_error("A node connect to '%s' has no values", it->second.name.c_str());
+            if(n.cpt.size() != mult)
+                throw dynamic_bayesnet_error("CPT of node '%s' is incomplete", n.name.c_str());
+        } else throw dynamic_bayesnet_error("A node connect to '%s' has no values", n.name.c_str());
 
 
-        parent_size += it->second.parent.size();
-        dim_size += it->second.dim.size();
-        cpt_size += it->second.cpt.size();
+        parent_size += n.parent.size();
+        dim_size += n.dim.size();
+        cpt_size += n.cpt.size();
     }
     child_size = parent_size;
 }
@@ -169,6 +287,14 @@ bayesnet::bayesdict* bayesnet::get_dict_cpy(){
 
 bayesnet::bayesnet(){
     dict = NULL;
+    mapping = NULL;
+    cpt = NULL;
+    parent = NULL;
+    child = NULL;
+    cpt_offset = NULL;
+    parent_offset = NULL;
+    child_offset = NULL;
+    states = NULL;
     size = 0;
     msg = NULL;
     dirty = true;
@@ -197,8 +323,10 @@ size_t bayesnet::get_nr_probabilities(){
 }
 
 
+// one pass over the nodes in the order of finalize(), the ids of the parsed
+// network are mapped to their position in it
 void bayesnet::init(dynamic_bayesnet *dbn){
-    size = dbn->nodes.size();
+    size = dbn->order.size();
     msg = NULL;
     dirty = true;
 
@@ -206,43 +334,46 @@ void bayesnet::init(dynamic_bayesnet *dbn){
     cpt = (probability_t*) malloc(sizeof(probability_t)*dbn->cpt_size);
     parent = (uint32_t*) malloc(sizeof(uint32_t)*dbn->parent_size);
     child = (uint32_t*) malloc(sizeof(uint32_t)*dbn->child_size);
-    cpt_offset = (uint32_t*) malloc(sizeof(uint32_t)*(size+1));
+    cpt_offset = (uint64_t*) malloc(sizeof(uint64_t)*(size+1));
     parent_offset = (uint32_t*) malloc(sizeof(uint32_t)*(size+1));
     child_offset = (uint32_t*) malloc(sizeof(uint32_t)*(size+1));
-    states = (uint32_t*) malloc(sizeof(uint32_t)*size);
+    states = (uint32_t*) malloc(sizeof(uint32_t)*(size+1));
+    states[size] = 0;
 
     clear_dict();
     dict = new bayesdict();
+    dict->id_to_name.resize(size);
+    dict->value.resize(size);
+    dict->name_to_id.reserve(size);
 
-    for(auto it = dbn->nodes.begin(); it != dbn->nodes.end(); it++){
-        unsigned int id = dict->id_to_name.size();
-        dynamic_bayesnet::node *n = &(it->second);
-
-        dict->id_to_name.push_back(n->name);
-        dict->name_to_id[n->name] = id;
-    }
+    vector<uint32_t> to_id(dbn->nodes.size(), UINT32_MAX);
+    for(unsigned int id = 0; id < size; id++)
+        to_id[dbn->order[id]] = id;
 
     parent_offset[0] = 0;
     child_offset[0] = 0;
     cpt_offset[0] = 0;
-    for(auto it = dbn->nodes.begin(); it != dbn->nodes.end(); it++){
-        dynamic_bayesnet::node *n = &(it->second);
-        unsigned int id = dict->name_to_id[n->name];
+    for(unsigned int id = 0; id < size; id++){
+        dynamic_bayesnet::node *n = &(dbn->nodes[dbn->order[id]]);
 
         parent_offset[id+1] = parent_offset[id] + n->parent.size();
         for(unsigned int i = 0; i < n->parent.size(); i++)
-            parent[parent_offset[id]+i] = dict->name_to_id[n->parent[i]->name];
+            parent[parent_offset[id]+i] = to_id[n->parent[i]];
 
         child_offset[id+1] = child_offset[id] + n->child.size();
         for(unsigned int i = 0; i < n->child.size(); i++)
-            child[child_offset[id]+i] = dict->name_to_id[n->child[i]->name];
+            child[child_offset[id]+i] = to_id[n->child[i]];
 
         states[id] = n->value.size();
 
+        // the CPT of a node is released once copied, so that the whole net
+        // is not held twice
         cpt_offset[id+1] = cpt_offset[id] + n->cpt.size();
         memcpy(cpt + cpt_offset[id], &(n->cpt[0]), sizeof(probability_t)*n->cpt.size());
+        vector<probability_t>().swap(n->cpt);
 
-        dict->value.resize(id+1);
+        dict->name_to_id.emplace(n->name, id);
+        dict->id_to_name[id] = n->name;
         dict->value[id] = n->value;
     }
 }
@@ -252,6 +383,10 @@ int bayesnet::get_node_id(string name){
         auto it = dict->name_to_id.find(name);
         if(it != dict->name_to_id.end())
             return it->second;
+    } else if(strings){
+        for(unsigned int id = 0; id < size; id++)
+            if(name == strings+string_offset[id])
+                return id;
     }
     return -1;
 }
@@ -259,12 +394,16 @@ int bayesnet::get_node_id(string name){
 string bayesnet::get_node_value_name(unsigned int id, unsigned int i){
     if(dict && id < size && i < dict->value[id].size())
         return dict->value[id][i];
+    else if(strings && id < size && i < states[id])
+        return string(strings+string_offset[size+value_offset[id]+i]);
     else return string("");
 }
 
 string bayesnet::get_node_name(unsigned int id){
     if(dict && id < size)
         return dict->id_to_name[id];
+    else if(strings && id < size)
+        return string(strings+string_offset[id]);
     else return string("");
 }
 
@@ -349,8 +488,183 @@ bayesnet* bayesnet::read(const char *infile){
     */
 }
 
+static const uint64_t BNB_MAGIC = 0x31424e4254454e42ull; // "BNETBNB1"
+static const uint32_t BNB_VERSION = 2;
+
+// FNV-1a
+static inline void fnv1a(uint64_t &h, const void *data, size_t n){
+    const unsigned char *p = (const unsigned char*) data;
+    for(size_t i = 0; i < n; i++){
+        h ^= p[i];
+        h *= 0x100000001b3ull;
+    }
+}
+
+// identifies a .net file by its size and modification time, and the query
+// the network is pruned to; 0 if the file cannot be found
+uint64_t bayesnet::stamp(const char *netfile, const vector<string> &query){
+    struct stat st;
+    if(stat(netfile, &st) != 0)
+        return 0;
+    uint64_t h = 0xcbf29ce484222325ull;
+    uint64_t fields[4] = { (uint64_t) st.st_size, (uint64_t) st.st_ino, (uint64_t) st.st_mtim.tv_sec, (uint64_t) st.st_mtim.tv_nsec };
+    fnv1a(h, fields, sizeof(fields));
+    for(unsigned int i = 0; i < query.size(); i++)
+        fnv1a(h, query[i].c_str(), query[i].size()+1);
+    return h ? h : 1;
+}
+
+// layout: header, cpt, cpt_offset (64-bit), the uint32 arrays parent_offset,
+// child_offset, states, value_offset (size+1 each), parent, child, the
+// string offsets of all names and then all value labels, and the strings.
+// NULL is returned for a missing, stale or invalid file.
+bayesnet* bayesnet::map(const char *filename, uint64_t stamp){
+    int fd = open(filename, O_RDONLY);
+    if(fd < 0)
+        return NULL;
+    struct stat st;
+    if(fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || (size_t) st.st_size < sizeof(bnb_header_t)){
+        close(fd);
+        return NULL;
+    }
+    const size_t file_size = st.st_size;
+
+    // private and writable, pages are only copied if the net is modified
+    void *data = mmap(NULL, file_size, PROT_READ|PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(data == MAP_FAILED)
+        return NULL;
+
+    // every count is checked against the file size before it is multiplied
+    const bnb_header_t *header = (const bnb_header_t*) data;
+    const uint64_t N = header->size, P = header->parents, L = header->labels;
+    bool valid = header->magic == BNB_MAGIC && header->version == BNB_VERSION && stamp != 0 && header->stamp == stamp
+        && header->probabilities <= file_size/sizeof(probability_t) && header->strings <= file_size;
+    uint64_t words = 4*(N+1) + 2*P + (N+L+1);
+    valid = valid && sizeof(bnb_header_t) + header->probabilities*sizeof(probability_t) + (N+1)*sizeof(uint64_t)
+        + words*sizeof(uint32_t) + header->strings == file_size;
+    if(!valid){
+        munmap(data, file_size);
+        return NULL;
+    }
+
+    bayesnet *bn = new bayesnet();
+    char *p = (char*) data + sizeof(bnb_header_t);
+    bn->cpt = (probability_t*) p;
+    p += header->probabilities*sizeof(probability_t);
+    bn->cpt_offset = (uint64_t*) p;
+    p += (N+1)*sizeof(uint64_t);
+    uint32_t *w = (uint32_t*) p;
+    bn->parent_offset = w; w += N+1;
+    bn->child_offset = w; w += N+1;
+    bn->states = w; w += N+1;
+    bn->value_offset = w; w += N+1;
+    bn->parent = w; w += P;
+    bn->child = w; w += P;
+    bn->string_offset = w; w += N+L+1;
+    bn->strings = (const char*) w;
+    bn->size = N;
+    bn->nr_probabilities = header->probabilities;
+    bn->mapping = data;
+    bn->mapping_size = file_size;
+
+    // the encoder trusts these arrays, so every offset is verified
+    valid = bn->cpt_offset[0] == 0 && bn->parent_offset[0] == 0 && bn->child_offset[0] == 0 && bn->value_offset[0] == 0
+        && bn->cpt_offset[N] == header->probabilities && bn->parent_offset[N] == P && bn->child_offset[N] == P
+        && bn->value_offset[N] == L && bn->string_offset[0] == 0 && bn->string_offset[N+L] == header->strings;
+    for(uint64_t i = 0; i < N && valid; i++){
+        valid = bn->cpt_offset[i] <= bn->cpt_offset[i+1] && bn->cpt_offset[i+1]-bn->cpt_offset[i] <= UINT32_MAX
+            && bn->parent_offset[i] <= bn->parent_offset[i+1]
+            && bn->child_offset[i] <= bn->child_offset[i+1] && bn->value_offset[i+1]-bn->value_offset[i] == bn->states[i]
+            && bn->value_offset[i] <= bn->value_offset[i+1] && bn->states[i] > 0;
+    }
+    for(uint64_t i = 0; i < P && valid; i++)
+        valid = bn->parent[i] < N && bn->child[i] < N;
+    for(uint64_t i = 0; i < N && valid; i++){
+        // the CPT holds a row per parent configuration, compared by division
+        uint64_t entries = bn->get_cpt_size(i);
+        valid = entries % bn->states[i] == 0;
+        entries /= bn->states[i];
+        for(unsigned int j = 0; j < bn->get_parent_size(i) && valid; j++){
+            uint32_t values = bn->states[bn->get_parent(i)[j]];
+            valid = entries % values == 0;
+            entries /= values;
+        }
+        valid = valid && entries == 1;
+    }
+    for(uint64_t i = 0; i < N+L && valid; i++)
+        valid = bn->string_offset[i] < bn->string_offset[i+1] && bn->strings[bn->string_offset[i+1]-1] == '\0';
+    if(!valid){
+        delete bn;
+        return NULL;
+    }
+    return bn;
+}
+
+// written next to the final name and renamed, readers never see a partial file
+bool bayesnet::save(const char *filename, uint64_t stamp){
+    if(!dict && !strings)
+        return false;
+
+    vector<uint32_t> value_offsets(size+1), string_offsets(1, 0);
+    string blob;
+    for(unsigned int i = 0; i < size; i++){
+        blob += get_node_name(i);
+        blob += '\0';
+        string_offsets.push_back(blob.size());
+    }
+    value_offsets[0] = 0;
+    for(unsigned int i = 0; i < size; i++){
+        value_offsets[i+1] = value_offsets[i] + states[i];
+        for(unsigned int j = 0; j < states[i]; j++){
+            blob += get_node_value_name(i, j);
+            blob += '\0';
+            string_offsets.push_back(blob.size());
+        }
+    }
+
+    bnb_header_t header = bnb_header_t();
+    header.magic = BNB_MAGIC;
+    header.version = BNB_VERSION;
+    header.size = size;
+    header.stamp = stamp;
+    header.probabilities = cpt_offset[size];
+    header.parents = parent_offset[size];
+    header.labels = value_offsets[size];
+    header.strings = blob.size();
+
+    // states is padded to size+1 entries like the offsets
+    vector<uint32_t> padded_states(states, states+size);
+    padded_states.push_back(0);
+
+    string tmp = string(filename) + ".tmp." + to_string(getpid());
+    FILE *file = fopen(tmp.c_str(), "wb");
+    if(file == NULL)
+        return false;
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1
+        && fwrite(cpt, sizeof(probability_t), header.probabilities, file) == header.probabilities
+        && fwrite(cpt_offset, sizeof(uint64_t), size+1, file) == size+1
+        && fwrite(parent_offset, sizeof(uint32_t), size+1, file) == size+1
+        && fwrite(child_offset, sizeof(uint32_t), size+1, file) == size+1
+        && fwrite(padded_states.data(), sizeof(uint32_t), size+1, file) == size+1
+        && fwrite(value_offsets.data(), sizeof(uint32_t), size+1, file) == size+1
+        && fwrite(parent, sizeof(uint32_t), header.parents, file) == header.parents
+        && fwrite(child, sizeof(uint32_t), header.parents, file) == header.parents
+        && fwrite(string_offsets.data(), sizeof(uint32_t), string_offsets.size(), file) == string_offsets.size()
+        && fwrite(blob.data(), 1, blob.size(), file) == blob.size();
+    ok = (fclose(file) == 0) && ok;
+    ok = ok && rename(tmp.c_str(), filename) == 0;
+    if(!ok)
+        unlink(tmp.c_str());
+    return ok;
+}
+
 void bayesnet::clear(){
-    if(size > 0){
+    if(mapping){
+        munmap(mapping, mapping_size);
+        size = 0;
+    } else {
+        // an empty network has its (empty) arrays as well
         size = 0;
         free(cpt);
         free(parent);
@@ -367,6 +681,11 @@ void bayesnet::clear(){
     parent_offset = NULL;
     child_offset = NULL;
     states = NULL;
+    mapping = NULL;
+    mapping_size = 0;
+    strings = NULL;
+    string_offset = NULL;
+    value_offset = NULL;
 }
 
 void bayesnet::destroy(){
@@ -379,7 +698,7 @@ void bayesnet::destroy(){
 }
 
 template <class T>
-inline void scpy(BITSTREAM &s, T &v, bool reverse = false,unsigned int n = 1){
+inline void scpy(BITSTREAM &s, T &v, bool reverse = false, size_t n = 1){
     if(reverse)
         memcpy((void*) &v, s, sizeof(T)*n);
     else
@@ -389,7 +708,7 @@ inline void scpy(BITSTREAM &s, T &v, bool reverse = false,unsigned int n = 1){
 }
 
 template <class T>
-inline void scpy(BITSTREAM &s, T *&v, bool reverse = false, unsigned int n = 1){
+inline void scpy(BITSTREAM &s, T *&v, bool reverse = false, size_t n = 1){
     if(reverse)
         memcpy((void*) v, s, sizeof(T)*n);
     else
@@ -403,8 +722,9 @@ char* bayesnet::serialize(){
         destroy();
 
         // calculate size
-        msg_size = sizeof(SIZE)*10;
-        msg_size += sizeof(uint32_t) * 5 * (size+1);
+        msg_size = sizeof(uint64_t)*10;
+        msg_size += sizeof(uint64_t) * (size+1);
+        msg_size += sizeof(uint32_t) * 4 * (size+1);
         msg_size += sizeof(probability_t) * cpt_offset[size];
         msg_size += sizeof(uint32_t) * parent_offset[size];
         msg_size += sizeof(uint32_t) * child_offset[size];
@@ -455,7 +775,7 @@ void bayesnet::deserialize(BITSTREAM strm, bool shared = false){
         scpy(s,msg_size,reverse);
         scpy(s,size,reverse);
 
-        cpt_offset = (uint32_t*) malloc(sizeof(uint32_t)*(size+1));
+        cpt_offset = (uint64_t*) malloc(sizeof(uint64_t)*(size+1));
         parent_offset = (uint32_t*) malloc(sizeof(uint32_t)*(size+1));
         child_offset = (uint32_t*) malloc(sizeof(uint32_t)*(size+1));
         states = (uint32_t*) malloc(sizeof(uint32_t)*(size+1));
@@ -473,11 +793,14 @@ void bayesnet::deserialize(BITSTREAM strm, bool shared = false){
         parent = (uint32_t*) malloc(sizeof(uint32_t)*parent_offset[size]);
         child = (uint32_t*) malloc(sizeof(uint32_t)*child_offset[size]);
 
+        nr_probabilities = cpt_offset[size];
+
         // data
+        uint64_t cpt_size;
+        scpy(s,cpt_size,reverse);
+        scpy(s,cpt,reverse,cpt_size);
         SIZE tmp_size;
         scpy(s,tmp_size,reverse);
-        scpy(s,cpt,reverse,tmp_size);
-        scpy(s,tmp_size,reverse);
         scpy(s,parent,reverse,tmp_size);
         scpy(s,tmp_size,reverse);
         scpy(s,child,reverse,tmp_size);
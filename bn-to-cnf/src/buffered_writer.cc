@@ -0,0 +1,133 @@
+#include "buffered_writer.h"
+#include <algorithm>
+#include <charconv>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+using namespace std;
+
+buffered_writer::buffered_writer(size_t capacity){
+    fd = -1;
+    error = false;
+    used = 0;
+    buffer.resize(capacity);
+}
+
+buffered_writer::~buffered_writer(){
+    close();
+}
+
+bool buffered_writer::open(const char *filename){
+    close();
+    fd = ::open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    error = (fd < 0);
+    used = 0;
+    return !error;
+}
+
+bool buffered_writer::close(){
+    bool ok = flush();
+    if(fd >= 0 && ::close(fd) != 0)
+        ok = false;
+    fd = -1;
+    return ok && !error;
+}
+
+// room for n more characters, flushing or growing the buffer
+inline char* buffered_writer::reserve(size_t n){
+    if(used + n > buffer.size()){
+        if(fd >= 0)
+            flush();
+        if(used + n > buffer.size())
+            buffer.resize(std::max(2*buffer.size(), used + n));
+    }
+    return buffer.data() + used;
+}
+
+void buffered_writer::put(char c){
+    *reserve(1) = c;
+    used++;
+}
+
+void buffered_writer::put(const char *s){
+    put(s, strlen(s));
+}
+
+void buffered_writer::put(const char *s, size_t n){
+    memcpy(reserve(n), s, n);
+    used += n;
+}
+
+void buffered_writer::put(const string &s){
+    put(s.data(), s.size());
+}
+
+void buffered_writer::put(const buffered_writer &w){
+    put(w.buffer.data(), w.used);
+}
+
+void buffered_writer::put(int32_t v){
+    char *p = reserve(11);
+    used = to_chars(p, p+11, v).ptr - buffer.data();
+}
+
+void buffered_writer::put(uint32_t v){
+    char *p = reserve(10);
+    used = to_chars(p, p+10, v).ptr - buffer.data();
+}
+
+// correctly rounded like printf, so the output matches "%f"
+void buffered_writer::put(double v){
+    char *p = reserve(512);
+    to_chars_result r = to_chars(p, p+512, v, chars_format::fixed, 6);
+    if(r.ec == errc())
+        used = r.ptr - buffer.data();
+    else printf("%f", v);
+}
+
+void buffered_writer::printf(const char *format, ...){
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(NULL, 0, format, args);
+    va_end(args);
+    if(n < 0){
+        error = true;
+        return;
+    }
+
+    char *p = reserve(n+1);
+    va_start(args, format);
+    vsnprintf(p, n+1, format, args);
+    va_end(args);
+    used += n;
+}
+
+bool buffered_writer::flush(){
+    if(fd < 0)
+        return !error;
+    size_t done = 0;
+    while(done < used){
+        ssize_t n = ::write(fd, buffer.data()+done, used-done);
+        if(n < 0){
+            if(errno == EINTR)
+                continue;
+            error = true;
+            break;
+        }
+        done += n;
+    }
+    used = 0;
+    return !error;
+}
+
+bool buffered_writer::failed() const {
+    return error;
+}
+
+size_t buffered_writer::size() const {
+    return used;
+}
@@ -2,7 +2,12 @@
 #include "misc.h"
 #include "qm.h"
 #include "bayesnet.h"
+#include "threadpool.h"
+#include "qm_cache.h"
+#include "buffered_writer.h"
+#include "metrics.h"
 #include <stack>
+#include <deque>
 #include <array>
 #include <string.h>
 #include <string>
@@ -11,6 +16,9 @@
 #include <tuple>
 #include <array>
 #include <map>
+#include <unordered_map>
+#include <functional>
+#include <limits>
 #include <math.h>
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -21,6 +29,16 @@
 
 using namespace std;
 
+// the widest clause groups QM is applied to, a limit (-l) can only lower it.
+// qm expands the don't cares of every clause into explicit models, so wider
+// groups of a network cannot finish; the 256 and 512-bit cubes of qm are only
+// reached with explicit models (qm-bench -w).
+#if __LP64__
+#define QM_MAX_WIDTH 128
+#else
+#define QM_MAX_WIDTH 64
+#endif
+
 template <class T>
 T& dynamic_assign(std::vector<T> &v, unsigned int i){
     if(v.size() <= i)
@@ -28,6 +46,60 @@ T& dynamic_assign(std::vector<T> &v, unsigned int i){
     return v[i];
 }
 
+clause_store::clause_store(){
+    offsets.push_back(0);
+}
+
+void clause_store::clear(){
+    literals.clear();
+    weights.clear();
+    offsets.assign(1, 0);
+}
+
+void clause_store::reserve(size_t clauses, size_t literals){
+    this->weights.reserve(clauses);
+    this->offsets.reserve(clauses+1);
+    this->literals.reserve(literals);
+}
+
+void clause_store::append(const literal_t *l, size_t size, weight_t w){
+    weights.push_back(w);
+    literals.insert(literals.end(), l, l+size);
+    offsets.push_back(literals.size());
+}
+
+void clause_store::append(const_clause_ref c){
+    append(c.literals.begin(), c.literals.size(), c.w);
+}
+
+void clause_store::append(const clause &c){
+    append(c.literals.data(), c.literals.size(), c.w);
+}
+
+void clause_store::swap(clause_store &s){
+    literals.swap(s.literals);
+    offsets.swap(s.offsets);
+    weights.swap(s.weights);
+}
+
+// removes the clauses marked in drop, in one pass
+void clause_store::erase(const std::vector<bool> &drop){
+    size_t n = 0, l = 0;
+    for(size_t i = 0; i < weights.size(); i++){
+        if(drop[i])
+            continue;
+        size_t begin = offsets[i], end = offsets[i+1];
+        std::copy(literals.begin()+begin, literals.begin()+end, literals.begin()+l);
+        offsets[n] = l;
+        weights[n++] = weights[i];
+        l += end-begin;
+    }
+    offsets[n] = l;
+    weights.resize(n);
+    offsets.resize(n+1);
+    literals.resize(l);
+}
+
 expression::expression(){
     clear();
 }
@@ -38,11 +110,13 @@ expression& expression::operator=(const expression &e){
     ZERO = e.ZERO;
     LITERALS = e.LITERALS;
     WEIGHTS = e.WEIGHTS;
+    AUXILIARY = e.AUXILIARY;
     mapped = e.mapped;
     values = e.values;
     literal_to_variable = literal_to_variable;
     variable_to_literal = variable_to_literal;
     clause_to_variable = clause_to_variable;
+    auxiliary_to_variable = e.auxiliary_to_variable;
     literal_to_literal_map = literal_to_literal_map;
     weight_to_weight_map = weight_to_weight_map;
     variable_to_variable_map = variable_to_variable_map;
@@ -52,6 +126,7 @@ expression& expression::operator=(const expression &e){
 void expression::clear(){
     LITERALS = 0;
     WEIGHTS = 0;
+    AUXILIARY = 0;
     DETERMINISTIC = 0;
     ZERO = 0;
     mapped = false;
@@ -62,6 +137,7 @@ void expression::clear(){
     variable_to_variable_map.clear();
     variable_to_literal.clear();
     clause_to_variable.clear();
+    auxiliary_to_variable.clear();
 }
 
 const std::vector<literal_t>& expression::get_literal_map(){
@@ -84,6 +160,10 @@ const std::vector<uint32_t>& expression::get_clause_to_variable() const {
     return clause_to_variable;
 }
 
+const std::vector<uint32_t>& expression::get_auxiliary_to_variable() const {
+    return auxiliary_to_variable;
+}
+
 const std::vector<uint32_t>& expression::get_variable_to_literal() const {
     return variable_to_literal;
 }
@@ -96,6 +176,10 @@ unsigned int expression::get_nr_literals() const {
     return LITERALS;
 }
 
+unsigned int expression::get_nr_auxiliary() const {
+    return AUXILIARY;
+}
+
 unsigned int expression::get_nr_weights() const {
     return WEIGHTS;
 }
@@ -124,8 +208,8 @@ void expression::map_literals(){
     mapped = true;
     std::set<uliteral_t> literals;
     std::set<uliteral_t> weights;
-    for(auto it = clauses.begin(); it != clauses.end(); it++){
-        clause_t &c = *it;
+    for(size_t i = 0; i < clauses.size(); i++){
+        clause_ref c = clauses[i];
         if(c.w >= 0)
             weights.insert(c.w);
         for(auto lit = c.literals.begin(); lit != c.literals.end(); lit++){
@@ -153,8 +237,8 @@ void expression::map_literals(){
         i++;
     }
 
-    for(auto it = clauses.begin(); it != clauses.end(); it++){
-        clause_t &c = *it;
+    for(size_t i = 0; i < clauses.size(); i++){
+        clause_ref c = clauses[i];
         if(c.w >= 0)
             c.w = w_to_w[c.w];
 
@@ -170,15 +254,14 @@ void expression::map_literals(){
 
 cnf::cnf(){
     bn = NULL;
+    pool = NULL;
+    cache = NULL;
     filename = NULL;
     clear();
 }
 
 cnf::~cnf(){
-    if(filename){
-        free(filename);
-        filename = NULL;
-    }
+    clear();
 }
 
 const std::vector<probability_t>& cnf::get_probability_to_weight() const {
@@ -229,14 +312,36 @@ void cnf::clear(){
     OPT_DETERMINISTIC_PROBABILITIES = false;
     OPT_SYMPLIFY = false;
     OPT_QUINE_MCCLUSKEY = false;
+    OPT_CSI = false;
     OPT_BOOL = false;
     expr.clauses.clear();
+    exprs.clear();
+    variable_expr_map.clear();
     qm_eligible = 0;
     qm_possible = 0;
+    csi_rows = 0;
+    csi_clauses = 0;
+    qm_rounds = 0;
+    qm_utilization = 0;
+    qm_interrupted = 0;
     qm_variable_count.clear();
     QM_LIMIT = -1;
+    AMO = amo::PAIRWISE;
+    THREADS = 0;
+    VERBOSITY = 0;
+    QM_NODES = 0;
+    QM_SECONDS = 0;
     encoding = 0; // default encoding containing constraints
-    this->~cnf();
+
+    // release the members without destroying them, the object stays in use
+    if(filename){
+        free(filename);
+        filename = NULL;
+    }
+    delete cache;
+    cache = NULL;
+    delete pool;
+    pool = NULL;
 }
 
 
@@ -325,90 +430,190 @@ void cnf::clear(){
 //     return 0;
 // }
 
-int cnf::write(const char* outfile, int i){
+// clauses are formatted in chunks of this many clauses when written
+// concurrently
+#define WRITE_CHUNK 65536
+
+int cnf::write(const char* outfile, int i, unsigned int *clauses){
+    metrics::phase phase("write");
     expression_t *tmp;
     if(i < 0)
         tmp = &expr;
     else tmp = &(exprs[i]);
     expression &expr = *tmp;
 
-    FILE *file = fopen(outfile,"w");
-    if(file){
-        fprintf(file, "c DIMACS CNF Format\n");
-        fprintf(file, "c\n");
-        stats(file, &expr);
-        fprintf(file, "c\n");
+    buffered_writer file;
+    if(file.open(outfile)){
+        // the statistics are shared with stats(), which prints to a stream
+        char *header = NULL;
+        size_t header_size = 0;
+        FILE *stream = open_memstream(&header, &header_size);
+        stats(stream, &expr);
+        fclose(stream);
+
+        file.put("c DIMACS CNF Format\n");
+        file.put("c\n");
+        file.put(header, header_size);
+        free(header);
+        file.put("c\n");
         if(i >= 0){
-            fprintf(file, "c CNF representation of variable '%s'\n", bn->get_node_name(i).c_str());
-            fprintf(file, "c\n");
+            file.printf("c CNF representation of variable '%s'\n", bn->get_node_name(i).c_str());
+            file.put("c\n");
         }
-        fprintf(file, "c ===================================================\n");
+        file.put("c ===================================================\n");
+
+        // one look at the probability of every clause decides whether it is
+        // written and whether it carries its weight literal
+        const unsigned int CLAUSES = expr.clauses.size();
+        std::vector<uint8_t> emit(CLAUSES);
         unsigned int counter = 0;
-        for(unsigned int i = 0; i < expr.clauses.size(); i++){
-            probability_t p = get_probability(i,expr);
-            if(!OPT_SYMPLIFY || p != 1)
+        for(unsigned int c = 0; c < CLAUSES; c++){
+            probability_t p = get_probability(c,expr);
+            if(!OPT_SYMPLIFY || p != 1){
                 counter++;
-        }
-
-        fprintf(file, "p cnf %u %u\n", expr.LITERALS+expr.WEIGHTS, counter);
-        for(unsigned int i = 0; i < expr.clauses.size(); i++){
-            if(!OPT_SYMPLIFY || get_probability(i,expr) != 1){
-                clause &c = expr.clauses[i];
-                for(unsigned int j = 0; j < c.literals.size(); j++)
-                    fprintf(file, "%d ", c.literals[j]);
-
-                if(get_probability(i,expr) != -1 && (!OPT_SYMPLIFY || get_probability(i,expr) != 0))
-                    fprintf(file, "%u ", expr.LITERALS+1+c.w);
-
-                fprintf(file,"0\n");
+                emit[c] = 1;
+                if(p != -1 && (!OPT_SYMPLIFY || p != 0))
+                    emit[c] = 2;
             }
         }
 
-        fprintf(file, "c ===================================================\n");
+        auto format = [&expr, &emit](buffered_writer &out, unsigned int begin, unsigned int end){
+            const literal_t LITERALS = expr.LITERALS, WEIGHTS = expr.WEIGHTS;
+            for(unsigned int c = begin; c < end; c++){
+                if(emit[c]){
+                    const_clause_ref cl = expr.clauses[c];
+                    for(unsigned int j = 0; j < cl.literals.size(); j++){
+                        literal_t l = cl.literals[j];
+                        if(l > LITERALS)
+                            l += WEIGHTS;
+                        else if(l < -LITERALS)
+                            l -= WEIGHTS;
+                        out.put((int32_t) l);
+                        out.put(' ');
+                    }
+                    if(emit[c] == 2){
+                        out.put((uint32_t) (expr.LITERALS+1+cl.w));
+                        out.put(' ');
+                    }
+                    out.put("0\n", 2);
+                }
+            }
+        };
+
+        file.printf("p cnf %u %u\n", expr.LITERALS+expr.WEIGHTS+expr.AUXILIARY, counter);
+        if(clauses)
+            *clauses = counter;
+        if(THREADS > 0 && CLAUSES > WRITE_CHUNK){
+            const unsigned int CHUNKS = (CLAUSES+WRITE_CHUNK-1)/WRITE_CHUNK;
+            std::deque<buffered_writer> chunks;
+            for(unsigned int k = 0; k < CHUNKS; k++)
+                chunks.emplace_back(0);
+
+            // the pool of the QM pass is reused, created here without -q
+            if(!pool)
+                pool = new threadpool(THREADS);
+            threadpool::batch b;
+            for(unsigned int k = 0; k < CHUNKS; k++)
+                pool->submit(b, [&format, &chunks, k, CLAUSES](){
+                    format(chunks[k], k*WRITE_CHUNK, std::min(CLAUSES, (k+1)*WRITE_CHUNK));
+                });
+            pool->wait(b);
+            for(unsigned int k = 0; k < CHUNKS; k++)
+                file.put(chunks[k]);
+        } else format(file, 0, CLAUSES);
+
+        file.put("c ===================================================\n");
         //fprintf(file, "c clauses       : %-6u\n", expr.clauses.size());
         //fprintf(file, "c literals      : %-6u (1-%u)\n", expr.LITERALS,expr.LITERALS);
         //fprintf(file, "c probabilities : %-6u (%u-%u)\n", weight_to_probability.size(), expr.LITERALS+1, expr.LITERALS+weight_to_probability.size());
-        fprintf(file, "c\n");
-        fprintf(file, "c literal-to-real-weight mapping:\n");
-        fprintf(file, "c     1-%u = 1\n",expr.LITERALS);
+        file.put("c\n");
+        file.put("c literal-to-real-weight mapping:\n");
+        file.printf("c     1-%u = 1\n",expr.LITERALS);
 
         if(expr.is_mapped()){
-            for(unsigned int i = 0; i < expr.weight_to_weight_map.size(); i++)
-                fprintf(file, "c     %u = %f\n", expr.LITERALS+1+i, get_probability(expr.weight_to_weight_map[i]));
+            for(unsigned int i = 0; i < expr.weight_to_weight_map.size(); i++){
+                file.put("c     ");
+                file.put((uint32_t) (expr.LITERALS+1+i));
+                file.put(" = ");
+                file.put(get_probability(expr.weight_to_weight_map[i]));
+                file.put('\n');
+            }
         } else {
-            for(unsigned int i = 0; i < weight_to_probability.size(); i++)
-                fprintf(file, "c     %u = %f\n", expr.LITERALS+1+i, weight_to_probability[i]);
+            for(unsigned int i = 0; i < weight_to_probability.size(); i++){
+                file.put("c     ");
+                file.put((uint32_t) (expr.LITERALS+1+i));
+                file.put(" = ");
+                file.put(weight_to_probability[i]);
+                file.put('\n');
+            }
         }
+        if(expr.AUXILIARY)
+            file.printf("c     %u-%u = 1\n", expr.LITERALS+expr.WEIGHTS+1, expr.LITERALS+expr.WEIGHTS+expr.AUXILIARY);
 
-        fprintf(file, "c\nc variable-to-literal mapping:\n");
+        file.put("c\nc variable-to-literal mapping:\n");
         for(unsigned int v = 0; v < expr.get_nr_variables(); v++){
-            fprintf(file, "c     %u = {",v);
+            file.put("c     ");
+            file.put((uint32_t) v);
+            file.put(" = {");
             for(unsigned int l = 0; l < expr.values[v]; l++){
-                if(l > 0) fprintf(file,",");
-                fprintf(file, "%u",expr.variable_to_literal[v]+l);
+                if(l > 0) file.put(',');
+                file.put((uint32_t) (expr.variable_to_literal[v]+l));
                 if(OPT_BOOL && expr.values[v] == 2)
                     break;
             }
-            fprintf(file,"}\n");
+            file.put("}\n");
         }
 
         if(bn){
-            fprintf(file, "c\nc variable-and-values-to-names mapping:\n");
-            fprintf(file, "c     <variable> <nr of values> <variable name>\n");
-            fprintf(file, "c          <value literal> <value name>\n");
-            fprintf(file, "c         [<value literal> <value name>]\nc\n");
+            file.put("c\nc variable-and-values-to-names mapping:\n");
+            file.put("c     <variable> <nr of values> <variable name>\n");
+            file.put("c          <value literal> <value name>\n");
+            file.put("c         [<value literal> <value name>]\nc\n");
             for(unsigned int v = 0; v < expr.get_nr_variables(); v++){
                 unsigned int old_variable = v;
                 if(expr.is_mapped())
                     old_variable = expr.variable_to_variable_map[v];
-                fprintf(file, "c     %u %u \"%s\"\n", v, expr.values[v], bn->get_node_name(old_variable).c_str());
-                for(unsigned int l = 0; l < expr.values[v]; l++)
-                    fprintf(file, "c         %u \"%s\"\n", expr.variable_to_literal[v]+l, bn->get_node_value_name(old_variable,l).c_str());
+                file.put("c     ");
+                file.put((uint32_t) v);
+                file.put(' ');
+                file.put((uint32_t) expr.values[v]);
+                file.put(" \"");
+                file.put(bn->get_node_name(old_variable));
+                file.put("\"\n");
+                for(unsigned int l = 0; l < expr.values[v]; l++){
+                    file.put("c         ");
+                    file.put((uint32_t) (expr.variable_to_literal[v]+l));
+                    file.put(" \"");
+                    file.put(bn->get_node_value_name(old_variable,l));
+                    file.put("\"\n");
+                }
             }
+
+            // the auxiliary variables of the at-most-one constraint of a
+            // variable are consecutive
+            if(expr.AUXILIARY){
+                file.put("c\nc auxiliary-variables mapping:\n");
+                file.put("c     <first literal>-<last literal> <variable> <variable name>\nc\n");
+                for(unsigned int a = 0; a < expr.AUXILIARY; ){
+                    unsigned int v = expr.auxiliary_to_variable[a], b = a;
+                    while(b+1 < expr.AUXILIARY && expr.auxiliary_to_variable[b+1] == v)
+                        b++;
+                    file.printf("c     %u-%u %u \"", expr.LITERALS+expr.WEIGHTS+1+a, expr.LITERALS+expr.WEIGHTS+1+b, v);
+                    file.put(bn->get_node_name(v));
+                    file.put("\"\n");
+                    a = b+1;
+                }
+            }
+        }
+        if(!file.close()){
+            fprintf(stderr, "Could not write file '%s'\n", outfile);
+            return 1;
         }
-        fclose(file);
 
-    } else fprintf(stderr, "Could not open file '%s'\n", filename);
+    } else {
+        fprintf(stderr, "Could not open file '%s'\n", outfile);
+        return 1;
+    }
     return 0;
 
 }
@@ -417,61 +622,104 @@ int cnf::write(const char *extra){
     string prefix = bn->get_filename();
     size_t found = prefix.find_last_of(".");
     prefix = prefix.substr(0,found);
-    string name = prefix;
     if(extra){
-        name += ".";
-        name += extra;
-    }
-    name += ".cnf";
-
-    if(write(name.c_str(),-1) == 0)
-        printf("\nDIMACS CNF written to: %s\n\n", name.c_str());
-    else {
-        return 1;
-        printf("Could not write to: %s\n\n", name.c_str());
-    }
-
-    if(exprs.size() > 0 && OPT_PARTITION) {
-        for(unsigned int v = 0; v < exprs.size(); v++){
-                name = prefix + ".";
-            if(extra)
-                 name += extra;
-            name += "." + to_string(v) + ".cnf";
-            if(write(name.c_str(), v) != 0){
-                printf("Could not write to: %s\n\n", name.c_str());
-                return 1;
-            }
-        }
-        printf("Partitioned DIMACS CNF written to: %s.*.cnf\n\n", prefix.c_str());
+        prefix += ".";
+        prefix += extra;
     }
-    return 0;
+    return write_files(prefix);
 }
 
 int cnf::write_with_location(const char* outfile){
     string prefix = outfile;
     size_t found = prefix.find_last_of(".");
     prefix = prefix.substr(0,found);
-    string name = prefix;
-    name += ".cnf";
+    return write_files(prefix);
+}
 
-    if(write(name.c_str(),-1) == 0)
-        printf("\nDIMACS CNF written to: %s\n\n", name.c_str());
-    else {
-        return 1;
+// <prefix>.cnf and with -p the expression of every variable v as
+// <prefix>.<v>.cnf, written concurrently with -j, and listed in
+// <prefix>.partitions.json
+int cnf::write_files(const string &prefix){
+    string name = prefix + ".cnf";
+    if(write(name.c_str(),-1) != 0){
         printf("Could not write to: %s\n\n", name.c_str());
+        return 1;
     }
+    printf("\nDIMACS CNF written to: %s\n\n", name.c_str());
 
     if(exprs.size() > 0 && OPT_PARTITION) {
-        for(unsigned int v = 0; v < exprs.size(); v++){
-            name = prefix + ".";
-            name += "." + to_string(v) + ".cnf";
-            if(write(name.c_str(), v) != 0){
-                printf("Could not write to: %s\n\n", name.c_str());
+        const unsigned int PARTITIONS = exprs.size();
+        std::vector<string> names(PARTITIONS);
+        std::vector<unsigned int> clauses(PARTITIONS, 0);
+        std::vector<int> status(PARTITIONS, 0);
+        for(unsigned int v = 0; v < PARTITIONS; v++)
+            names[v] = prefix + "." + to_string(v) + ".cnf";
+
+        if(THREADS > 0){
+            if(!pool)
+                pool = new threadpool(THREADS);
+            threadpool::batch b;
+            for(unsigned int v = 0; v < PARTITIONS; v++)
+                pool->submit(b, [this, &names, &clauses, &status, v](){
+                    status[v] = write(names[v].c_str(), v, &clauses[v]);
+                });
+            pool->wait(b);
+        } else {
+            for(unsigned int v = 0; v < PARTITIONS; v++)
+                status[v] = write(names[v].c_str(), v, &clauses[v]);
+        }
+
+        for(unsigned int v = 0; v < PARTITIONS; v++){
+            if(status[v] != 0){
+                printf("Could not write to: %s\n\n", names[v].c_str());
                 return 1;
             }
         }
         printf("Partitioned DIMACS CNF written to: %s.*.cnf\n\n", prefix.c_str());
+
+        name = prefix + ".partitions.json";
+        if(write_partitions(name.c_str(), names, clauses) != 0){
+            printf("Could not write to: %s\n\n", name.c_str());
+            return 1;
+        }
+        printf("Partitions listed in: %s\n\n", name.c_str());
+    }
+    return 0;
+}
+
+// the file, size and maps of every partition. The literals of a partition
+// are 1..literals+weights, "literal_map" holds the literal of the full CNF
+// every one of them stands for, "variable_map" the network variable of
+// every partition variable.
+int cnf::write_partitions(const char *manifest, const std::vector<string> &names, const std::vector<unsigned int> &clauses){
+    FILE *file = fopen(manifest, "w");
+    if(file == NULL)
+        return 1;
+    fprintf(file, "{\n  \"variables\": %u,\n  \"literals\": %u,\n  \"weights\": %u,\n  \"partitions\": [\n",
+        VARIABLES, expr.LITERALS, expr.WEIGHTS);
+    for(unsigned int v = 0; v < exprs.size(); v++){
+        const expression &e = exprs[v];
+        struct stat st;
+        string base = names[v].substr(names[v].find_last_of('/')+1);
+        fprintf(file, "    {\"variable\": %u, \"name\": ", v);
+        write_json_string(file, bn->get_node_name(v));
+        fprintf(file, ", \"file\": ");
+        write_json_string(file, base);
+        fprintf(file, ", \"bytes\": %lld, \"variables\": %u, \"literals\": %u, \"weights\": %u, \"clauses\": %u,\n",
+            stat(names[v].c_str(), &st) == 0 ? (long long) st.st_size : -1LL, e.get_nr_variables(), e.LITERALS, e.WEIGHTS, clauses[v]);
+        fprintf(file, "     \"variable_map\": [");
+        for(unsigned int i = 0; i < e.variable_to_variable_map.size(); i++)
+            fprintf(file, i ? ",%u" : "%u", e.variable_to_variable_map[i]);
+        fprintf(file, "],\n     \"literal_map\": [");
+        for(unsigned int l = 1; l <= e.LITERALS; l++)
+            fprintf(file, l > 1 ? ",%d" : "%d", e.literal_to_literal_map[l]);
+        for(unsigned int w = 0; w < e.WEIGHTS; w++)
+            fprintf(file, e.LITERALS+w ? ",%u" : "%u", expr.LITERALS+1+e.weight_to_weight_map[w]);
+        fprintf(file, "]}%s\n", v+1 < exprs.size() ? "," : "");
     }
+    fprintf(file, "  ]\n}\n");
+    if(fclose(file) != 0)
+        return 1;
     return 0;
 }
 
@@ -501,13 +749,15 @@ void cnf::stats(FILE *file, expression_t* e){
     fprintf(file,"%sDeterministic   : %d\n", prefix, e->DETERMINISTIC);
     fprintf(file,"%sUnsatisfiable   : %d\n", prefix, e->ZERO);
     fprintf(file,"%sLiterals        : %d\n", prefix, e->LITERALS);
+    if(e->AUXILIARY)
+        fprintf(file,"%sAuxiliary       : %d (%s at-most-one)\n", prefix, e->AUXILIARY, amo::name(AMO));
     fprintf(file,"%sClauses         : %lu\n", prefix, e->clauses.size());
 
     int max = 0;
     int min = -1;
     unsigned long int total = 0;
-    for(auto it = e->clauses.begin(); it != e->clauses.end(); it++){
-        int size = it->literals.size();
+    for(size_t c = 0; c < e->clauses.size(); c++){
+        int size = e->clauses[c].literals.size();
         total += size;
         if(size > max)
             max = size;
@@ -516,11 +766,22 @@ void cnf::stats(FILE *file, expression_t* e){
     }
 
     vector<uint32_t> sizes(max+1,0);
-    for(auto it = e->clauses.begin(); it != e->clauses.end(); it++)
-        sizes[it->literals.size()]++;
+    for(size_t c = 0; c < e->clauses.size(); c++)
+        sizes[e->clauses[c].literals.size()]++;
 
     fprintf(file,"%sLiteral/clauses : %.2f \n", prefix, (float) total/e->clauses.size());
     fprintf(file,"%sClause sizes    : %d-%d\n", prefix, min, max);
+    if(file == stdout && OPT_CSI)
+        fprintf(file,"%sCSI clauses     : %u for %u CPT rows\n", prefix, csi_clauses, csi_rows);
+    if(file == stdout && OPT_QUINE_MCCLUSKEY)
+        fprintf(file,"%sQM merge rounds : %lu (pool utilization %.1f%%)\n", prefix, (unsigned long) qm_rounds, 100*qm_utilization);
+    if(file == stdout && OPT_QUINE_MCCLUSKEY && cache){
+        uint64_t lookups = cache->get_hits() + cache->get_misses();
+        fprintf(file,"%sQM cache        : %lu hits, %lu misses (%.1f%%), %lu entries\n", prefix, (unsigned long) cache->get_hits(),
+            (unsigned long) cache->get_misses(), lookups?100.0*cache->get_hits()/lookups:0.0, (unsigned long) cache->size());
+    }
+    if(file == stdout && OPT_QUINE_MCCLUSKEY && (QM_NODES || QM_SECONDS > 0))
+        fprintf(file,"%sQM over budget  : %u groups\n", prefix, qm_interrupted);
     //printf("clauses/size    : ");
     //for(unsigned int i = 1; i <= max; i++)
     //    printf("%5d ", sizes[i]);
@@ -545,15 +806,110 @@ void cnf::stats(FILE *file, expression_t* e){
     //printf("\n");
 }
 
+// hash of a weight class under -e, the probability of a clause per variable
+struct probability_class_hash {
+    size_t operator()(const std::pair<unsigned int, probability_t> &c) const {
+        return std::hash<probability_t>()(c.second) * 31 + c.first;
+    }
+};
+
 void cnf::apply_optimization(){
-    if(OPT_EQUAL_PROBABILITIES)
-        encode_equal_probabilities();
+    metrics::phase phase("encode.optimization");
+    if(!OPT_EQUAL_PROBABILITIES && !OPT_DETERMINISTIC_PROBABILITIES && !OPT_SYMPLIFY)
+        return;
+
+    // one pass maps every weighted clause to its class, the (variable,
+    // probability) pair with -e and its current weight otherwise. classes get
+    // new weights in order of first occurrence; -a drops the clauses with
+    // probability 1 and unweights those with 0, -d shares weights 0 and 1.
+    typedef std::pair<unsigned int, probability_t> class_t;
+    const bool DETERMINISTIC = OPT_DETERMINISTIC_PROBABILITIES && !OPT_SYMPLIFY;
+    unordered_map<class_t, weight_t, probability_class_hash> class_to_w;
+    vector<weight_t> w_to_w(OPT_EQUAL_PROBABILITIES ? 0 : weight_to_probability.size(), -1);
+    vector<probability_t> w_to_p;
+    vector<bool> drop(OPT_SYMPLIFY ? expr.clauses.size() : 0);
+    bool dropped = false;
+    int d[2] = { 0 };
+    if(DETERMINISTIC){
+        w_to_p.push_back(0);
+        w_to_p.push_back(1);
+    }
+
+    for(unsigned int i = 0; i < expr.clauses.size(); i++){
+        weight_t &w = expr.clauses[i].w;
+        if(w < 0)
+            continue;
+        probability_t p = weight_to_probability[w];
+        if(p == 0 || p == 1){
+            if(OPT_SYMPLIFY){
+                if(p == 1)
+                    drop[i] = dropped = true;
+                else w = -1;
+                continue;
+            } else if(DETERMINISTIC){
+                w = (weight_t) p;
+                d[w] = 1;
+                continue;
+            }
+        }
+        if(OPT_EQUAL_PROBABILITIES){
+            auto it = class_to_w.emplace(class_t(expr.clause_to_variable[i], p), w_to_p.size());
+            if(it.second)
+                w_to_p.push_back(p);
+            w = it.first->second;
+        } else {
+            if(w_to_w[w] < 0){
+                w_to_w[w] = w_to_p.size();
+                w_to_p.push_back(p);
+            }
+            w = w_to_w[w];
+        }
+    }
 
-    if(OPT_DETERMINISTIC_PROBABILITIES)
-        encode_deterministic_probabilities();
+    if(dropped){
+        unsigned int kept = 0;
+        for(unsigned int i = 0; i < drop.size(); i++)
+            if(!drop[i])
+                expr.clause_to_variable[kept++] = expr.clause_to_variable[i];
+        expr.clauses.erase(drop);
+        expr.clause_to_variable.resize(kept);
+    }
 
-    if(OPT_SYMPLIFY)
-        encode_determinism();
+    if(DETERMINISTIC && (!d[0] || !d[1])){
+        // only the used deterministic weights are kept in front
+        if(!d[1]) w_to_p.erase(w_to_p.begin()+1);
+        if(!d[0]) w_to_p.erase(w_to_p.begin());
+        const weight_t shift = d[0] + d[1] - 2;
+        for(unsigned int i = 0; i < expr.clauses.size(); i++){
+            weight_t &w = expr.clauses[i].w;
+            if(w > 0)
+                w += shift;
+        }
+    } else if(OPT_EQUAL_PROBABILITIES && !OPT_SYMPLIFY && !DETERMINISTIC){
+        // -e alone numbers the classes in (variable, probability) order
+        vector<class_t> classes(w_to_p.size());
+        for(auto it = class_to_w.begin(); it != class_to_w.end(); it++)
+            classes[it->second] = it->first;
+        vector<weight_t> order(classes.size());
+        for(unsigned int w = 0; w < order.size(); w++)
+            order[w] = w;
+        std::sort(order.begin(), order.end(), [&classes](weight_t a, weight_t b){
+            return classes[a] < classes[b];
+        });
+        vector<weight_t> rank(order.size());
+        for(unsigned int r = 0; r < order.size(); r++){
+            rank[order[r]] = r;
+            w_to_p[r] = classes[order[r]].second;
+        }
+        for(unsigned int i = 0; i < expr.clauses.size(); i++){
+            weight_t &w = expr.clauses[i].w;
+            if(w >= 0)
+                w = rank[w];
+        }
+    }
+
+    weight_to_probability.swap(w_to_p);
+    expr.WEIGHTS = weight_to_probability.size();
 }
 
 int cnf::encode(bayesnet *bn){
@@ -588,6 +944,20 @@ int cnf::encode(bayesnet *bn){
         }
     }
 
+    // literals and weights are written as 32-bit DIMACS ids, the literals of
+    // the clauses are indexed by clause_offset_t
+    uint64_t literals = 0;
+    for(unsigned int i = 0; i < VARIABLES; i++)
+        literals += (uint64_t) bn->get_cpt_size(i)*(bn->get_parent_size(i)+1) + (uint64_t) bn->states[i]*bn->states[i];
+    if(expr.LITERALS + bn->get_cpt_size() > INT32_MAX){
+        fprintf(stderr, "The network has too many probabilities for 32-bit DIMACS literals\n");
+        return -1;
+    }
+    if(literals > std::numeric_limits<clause_offset_t>::max()){
+        fprintf(stderr, "The CNF has more than %lu literals, build with -DLARGE_CNF=ON\n", (unsigned long) std::numeric_limits<clause_offset_t>::max());
+        return -1;
+    }
+
     switch(encoding){
         case 0:
             encode_constraints(); // note missing break;
@@ -602,7 +972,15 @@ int cnf::encode(bayesnet *bn){
     apply_optimization();
 
     if(OPT_QUINE_MCCLUSKEY){
+        // one pool serves every clause group, merge round and write
+        pool = new threadpool(THREADS);
         encode_prime();
+        if(cache)
+            cache->save();
+        qm_rounds = pool->get_rounds();
+        qm_utilization = pool->get_utilization();
+        metrics::set("qm.utilization", qm_utilization);
+
         if(!OPT_SUPPRESS_CONSTRAINTS){
             set_encoding(0);
             encode_constraints();
@@ -613,89 +991,144 @@ int cnf::encode(bayesnet *bn){
     if(OPT_PARTITION)
         encode_partitions();
 
+    metrics::count("clauses", expr.clauses.size());
+    metrics::count("literals", expr.LITERALS);
+    metrics::count("weights", expr.WEIGHTS);
     if(expr.clauses.size() == 0)
         clear();
 
-
-
     return 0;
 }
 
 void cnf::init(){
 }
 
+// The expression of every variable: its constraints, those of its parents
+// and its CPT clauses. They are built from the clause indices of every
+// variable, the literals and weights mapped straight from the global
+// expression to dense ranges (in the order of the global ones), with -j
+// on the pool.
 void cnf::encode_partitions(){
+    metrics::phase phase("encode.partition");
     exprs.resize(VARIABLES);
-    std::vector< std::vector<unsigned int> > variable_to_constraints;
-    variable_to_constraints.resize(VARIABLES);
-
-    // identify constraint clauses
-    if(!OPT_SUPPRESS_CONSTRAINTS){
-        for(unsigned int i = 0; i < CONSTRAINTS; i++){
-            unsigned int v = expr.clause_to_variable[i];
-            variable_to_constraints[v].push_back(i);
-        }
-    } else CONSTRAINTS = 0;
-
-    // add constraint clauses
-    if(!OPT_SUPPRESS_CONSTRAINTS){
-        for(unsigned v = 0; v < VARIABLES; v++){
-            // add constraints for variable v
-            for(unsigned int i = 0; i < variable_to_constraints[v].size(); i++){
-                unsigned int c = variable_to_constraints[v][i];
-                exprs[v].clauses.push_back(expr.clauses[c]);
-            }
-            // add constraint clauses for the parents of v
-            uint32_t* parents = bn->get_parent(v);
-            for(unsigned int i = 0; i < bn->get_parent_size(v); i++){
-                unsigned int vv = parents[i];
-                for(unsigned int i = 0; i < variable_to_constraints[vv].size(); i++){
-                    unsigned int c = variable_to_constraints[vv][i];
-                    exprs[v].clauses.push_back(expr.clauses[c]);
-                }
-            }
-        }
-    }
 
-    // divide CPT clauses per variable
-    for(unsigned int i = CONSTRAINTS; i < expr.clauses.size(); i++){
+    if(OPT_SUPPRESS_CONSTRAINTS)
+        CONSTRAINTS = 0;
+
+    // the constraint and CPT clauses of every variable, in order
+    const size_t CLAUSES = expr.clauses.size();
+    std::vector<uint32_t> constraint_offset(VARIABLES+2, 0), cpt_offset(VARIABLES+2, 0);
+    for(size_t i = 0; i < CLAUSES; i++)
+        (i < CONSTRAINTS ? constraint_offset : cpt_offset)[expr.clause_to_variable[i]+2]++;
+    for(unsigned int v = 0; v < VARIABLES; v++){
+        constraint_offset[v+2] += constraint_offset[v+1];
+        cpt_offset[v+2] += cpt_offset[v+1];
+    }
+    std::vector<uint32_t> constraints(CONSTRAINTS), cpt(CLAUSES-CONSTRAINTS);
+    for(size_t i = 0; i < CLAUSES; i++){
         unsigned int v = expr.clause_to_variable[i];
-        exprs[v].clauses.push_back(expr.clauses[i]);
+        if(i < CONSTRAINTS)
+            constraints[constraint_offset[v+1]++] = i;
+        else cpt[cpt_offset[v+1]++] = i;
     }
 
-    // set other variables of expression
-    for(unsigned int i = 0; i < VARIABLES; i++){
-        expression &e = exprs[i];
-        e.map_literals();
-        e.LITERALS = e.literal_to_literal_map.size()-1;
-        e.WEIGHTS = e.weight_to_weight_map.size();
+    auto build = [this, &constraints, &constraint_offset, &cpt, &cpt_offset](unsigned int v){
+        // marks and new indices (+1) of the global literals, weights and
+        // variables, reset after every partition
+        static thread_local std::vector<uint32_t> literal_index, weight_index, variable_index;
+        if(literal_index.size() <= expr.LITERALS)
+            literal_index.resize(expr.LITERALS+1, 0);
+        if(weight_index.size() < weight_to_probability.size())
+            weight_index.resize(weight_to_probability.size(), 0);
+        if(variable_index.size() < VARIABLES)
+            variable_index.resize(VARIABLES, 0);
+
+        std::vector<uint32_t> clauses;
+        clauses.insert(clauses.end(), constraints.begin()+constraint_offset[v], constraints.begin()+constraint_offset[v+1]);
+        uint32_t* parents = bn->get_parent(v);
+        for(unsigned int i = 0; i < bn->get_parent_size(v); i++)
+            clauses.insert(clauses.end(), constraints.begin()+constraint_offset[parents[i]], constraints.begin()+constraint_offset[parents[i]+1]);
+        clauses.insert(clauses.end(), cpt.begin()+cpt_offset[v], cpt.begin()+cpt_offset[v+1]);
+
+        expression &e = exprs[v];
+        std::vector<literal_t> &literals = e.literal_to_literal_map;
+        std::vector<weight_t> &weights = e.weight_to_weight_map;
+        size_t size = 0;
+        literals.assign(1, 0);
+        weights.clear();
+        for(unsigned int i = 0; i < clauses.size(); i++){
+            const_clause_ref c = expr.clauses[clauses[i]];
+            if(c.w >= 0 && !weight_index[c.w]){
+                weight_index[c.w] = 1;
+                weights.push_back(c.w);
+            }
+            for(unsigned int j = 0; j < c.literals.size(); j++){
+                uliteral_t l = abs(c.literals[j]);
+                if(!literal_index[l]){
+                    literal_index[l] = 1;
+                    literals.push_back(l);
+                }
+            }
+            size += c.literals.size();
+        }
+        std::sort(literals.begin()+1, literals.end());
+        std::sort(weights.begin(), weights.end());
+        for(unsigned int i = 1; i < literals.size(); i++)
+            literal_index[literals[i]] = i;
+        for(unsigned int i = 0; i < weights.size(); i++)
+            weight_index[weights[i]] = i+1;
+
+        e.clauses.clear();
+        e.values.clear();
+        e.variable_to_variable_map.clear();
+        e.clauses.reserve(clauses.size(), size);
+        for(unsigned int i = 0; i < clauses.size(); i++){
+            const_clause_ref c = expr.clauses[clauses[i]];
+            e.clauses.new_clause(c.w >= 0 ? weight_index[c.w]-1 : c.w);
+            for(unsigned int j = 0; j < c.literals.size(); j++){
+                literal_t l = c.literals[j];
+                e.clauses.push_literal(l < 0 ? -(literal_t) literal_index[-l] : (literal_t) literal_index[l]);
+            }
+        }
+        e.mapped = true;
+        e.LITERALS = literals.size()-1;
+        e.WEIGHTS = weights.size();
 
-        std::map<unsigned int, unsigned int> variables;
+        // variables in order of their first literal
         e.literal_to_variable.resize(e.LITERALS+1);
-        unsigned int variable = 0;
         for(unsigned int l = 1; l <= e.LITERALS; l++){
-            literal_t old_l = e.literal_to_literal_map[l];
-            unsigned int old_variable = expr.literal_to_variable[old_l];
-            unsigned int old_values = expr.values[old_variable];
-
-            auto hit = variables.find(old_variable);
-            unsigned int new_variable = variable;
-            if(hit == variables.end())
-                variables[old_variable] = variable++;
-            else new_variable = hit->second;
-
-            e.values.resize(variables.size());
-            e.values[new_variable] = old_values;
-
-            e.variable_to_variable_map.resize(variables.size());
-            e.variable_to_variable_map[new_variable] = old_variable;
-
-            e.literal_to_variable[l] = new_variable;
+            unsigned int old_variable = expr.literal_to_variable[literals[l]];
+            if(!variable_index[old_variable]){
+                e.variable_to_variable_map.push_back(old_variable);
+                e.values.push_back(expr.values[old_variable]);
+                variable_index[old_variable] = e.values.size();
+            }
+            e.literal_to_variable[l] = variable_index[old_variable]-1;
         }
         e.variable_to_literal.resize(e.get_nr_variables());
-        e.variable_to_literal[0] = 1;
+        if(!e.values.empty())
+            e.variable_to_literal[0] = 1;
         for(unsigned int i = 1; i < e.values.size(); i++)
             e.variable_to_literal[i] = e.variable_to_literal[i-1] + e.values[i-1];
+
+        for(unsigned int i = 1; i < literals.size(); i++)
+            literal_index[literals[i]] = 0;
+        for(unsigned int i = 0; i < weights.size(); i++)
+            weight_index[weights[i]] = 0;
+        for(unsigned int i = 0; i < e.variable_to_variable_map.size(); i++)
+            variable_index[e.variable_to_variable_map[i]] = 0;
+    };
+
+    if(THREADS > 0){
+        if(!pool)
+            pool = new threadpool(THREADS);
+        threadpool::batch b;
+        for(unsigned int v = 0; v < VARIABLES; v++)
+            pool->submit(b, [&build, v](){ build(v); });
+        pool->wait(b);
+    } else {
+        for(unsigned int v = 0; v < VARIABLES; v++)
+            build(v);
     }
 }
 
@@ -750,24 +1183,67 @@ void expression::print(){
 }
 
 void cnf::encode_constraints(){
+    metrics::phase phase("encode.constraints");
     //expr.literals.resize(expr.LITERALS);
 
+    // one clause per variable and one per pair of its values, or those of
+    // the at-most-one encoding
+    size_t clauses = expr.clauses.size(), literals = expr.clauses.get_nr_literals();
+    for(unsigned int i = 0; i < bn->size; i++){
+        if(AMO == amo::PAIRWISE){
+            clauses += 1 + bn->states[i]*(bn->states[i]-1)/2;
+            literals += bn->states[i] + bn->states[i]*(bn->states[i]-1);
+        } else {
+            size_t auxiliary = 0;
+            clauses += 1;
+            literals += bn->states[i];
+            amo::count(AMO, bn->states[i], clauses, literals, auxiliary);
+        }
+    }
+    expr.clauses.reserve(clauses, literals);
+    expr.clause_to_variable.reserve(clauses);
+
     // variable encoding
     for(unsigned int i = 0; i < bn->size; i++){
         if(OPT_BOOL && bn->states[i] == 2)
             continue;
 
-        uint32_t cid = expr.clauses.size();
-        expr.clauses.resize(cid+1);
-        clause_t &c = expr.clauses.back();
+        expr.clauses.new_clause();
         expr.clause_to_variable.push_back(i);
         //c.w = -1; // expr.clause_to_weight.push_back(-1);
         for(unsigned int v = 0; v < bn->states[i]; v++)
-            c.literals.push_back(v_to_l(i,v));
+            expr.clauses.push_literal(v_to_l(i,v));
         CONSTRAINTS++;
     }
 
     // constraint encoding
+    if(AMO != amo::PAIRWISE){
+        // auxiliary variables follow the literals, write() moves them after
+        // the weights
+        std::vector<literal_t> values;
+        unsigned int i = 0;
+        auto new_variable = [this, &i](){
+            expr.auxiliary_to_variable.push_back(i);
+            return (literal_t) (expr.LITERALS + ++expr.AUXILIARY);
+        };
+        auto add_clause = [this, &i](const literal_t *l, size_t size){
+            expr.clauses.new_clause();
+            expr.clause_to_variable.push_back(i);
+            for(size_t j = 0; j < size; j++)
+                expr.clauses.push_literal(l[j]);
+            CONSTRAINTS++;
+        };
+        for(i = 0; i < bn->size; i++){
+            if(OPT_BOOL && bn->states[i] == 2)
+                continue;
+            values.resize(bn->states[i]);
+            for(unsigned int v = 0; v < bn->states[i]; v++)
+                values[v] = v_to_l(i,v);
+            amo::encode(AMO, values, new_variable, add_clause);
+        }
+        return;
+    }
+
     for(unsigned int i = 0; i < bn->size; i++){
         if(OPT_BOOL && bn->states[i] == 2)
             continue;
@@ -776,13 +1252,12 @@ void cnf::encode_constraints(){
         uint32_t literal_base = v_to_l(i,0);
         for(unsigned int v = 0; v < values-1; v++){
             for(unsigned int vv = v+1; vv < values; vv++){
-                expr.clauses.resize(expr.clauses.size()+1);
-                clause &c = expr.clauses.back();
+                expr.clauses.new_clause();
                 expr.clause_to_variable.push_back(i);
                 //c.w = -1; // clause_to_weight.push_back(-1);
 
-                c.literals.push_back(-1*(literal_base+v));
-                c.literals.push_back(-1*(literal_base+vv));
+                expr.clauses.push_literal(-1*(literal_base+v));
+                expr.clauses.push_literal(-1*(literal_base+vv));
                 CONSTRAINTS++;
             }
         }
@@ -802,10 +1277,24 @@ const uint32_t* cnf::get_states() const {
 }
 
 void cnf::encode_probabilities(){
+    metrics::phase phase("encode.probabilities");
     //expr.literals.resize(expr.LITERALS+1);
 
+    // one clause per CPT entry over the variable and its parents
+    size_t literals = expr.clauses.get_nr_literals();
+    for(unsigned int i = 0; i < bn->size; i++)
+        literals += (size_t) bn->get_cpt_size(i)*(bn->get_parent_size(i)+1);
+    expr.clauses.reserve(expr.clauses.size()+bn->get_cpt_size(), literals);
+    expr.clause_to_variable.reserve(expr.clauses.size()+bn->get_cpt_size());
+    weight_to_probability.reserve(weight_to_probability.size()+bn->get_cpt_size());
+
     // weight encoding
     for(unsigned int i = 0; i < bn->size; i++){
+        if(OPT_CSI){
+            encode_add(i);
+            continue;
+        }
+
         unsigned int m = bn->get_parent_size(i);
         int *max = (int*) malloc(sizeof(int)*(m+1));
         int *ctr = (int*) malloc(sizeof(int)*(m+1));
@@ -819,13 +1308,11 @@ void cnf::encode_probabilities(){
         max[m] = expr.values[i];
         ctr[m] = 0;
 
-        int q = 0;
+        unsigned int q = 0;
         while(true){
             expr.clause_to_variable.push_back(i);
 
-            uint32_t cid = expr.clauses.size();
-            expr.clauses.resize(cid+1);
-            clause_t &c = expr.clauses.back();
+            expr.clauses.new_clause();
 
             probability_t p = bn->cpt[bn->cpt_offset[i]+q++];
             if(p == 0)
@@ -834,7 +1321,7 @@ void cnf::encode_probabilities(){
             if(p == 0 || p == 1)
                 expr.DETERMINISTIC++;
 
-            c.w = weight_to_probability.size(); //clause_to_weight.push_back(weight_to_probability.size());
+            expr.clauses.back().w = weight_to_probability.size(); //clause_to_weight.push_back(weight_to_probability.size());
             weight_to_probability.push_back(p);
             expr.WEIGHTS = weight_to_probability.size();
             //} else clause_to_weight.push_back((uint32_t) p);
@@ -844,13 +1331,13 @@ void cnf::encode_probabilities(){
                 if(OPT_BOOL && max[i] == 2){
                     lid = v_to_l(variable[i],0);
                     if(ctr[i]==1)
-                        c.literals.push_back(-1*lid);
+                        expr.clauses.push_literal(-1*lid);
                     else
-                        c.literals.push_back(lid);
+                        expr.clauses.push_literal(lid);
                     //c.negated.push_back((ctr[i]==1));
                 } else {
                     lid = v_to_l(variable[i],ctr[i]);
-                    c.literals.push_back(-1*lid);
+                    expr.clauses.push_literal(-1*lid);
                 }
 
                 //literal_t &l = expr.literals[lid];
@@ -879,185 +1366,252 @@ void cnf::encode_probabilities(){
     }
 }
 
-void cnf::encode_determinism(){
-    // 1. remove weights that correspond to probability 0
-    vector <probability_t> w_to_p;
-    map< int, int > w_to_w;
-    w_to_w[-1] = -1;
-    for(unsigned int i = 0; i < expr.clauses.size(); i++){
-        weight_t &w = expr.clauses[i].w;
-        probability_t p = get_probability(i);
-        if(p == 0)
-            w = -1;
-        else if(w_to_w.find(w) == w_to_w.end()){
-            w_to_w[w] = w_to_p.size();
-            w_to_p.push_back(p);
+// hash of the children of a decision diagram node
+struct add_node_hash {
+    size_t operator()(const std::vector<uint32_t> &children) const {
+        uint64_t h = 0xcbf29ce484222325ull;
+        for(unsigned int c = 0; c < children.size(); c++){
+            h ^= children[c];
+            h *= 0x100000001b3ull;
         }
+        return h;
     }
-    weight_to_probability = w_to_p;
-    for(unsigned int i = 0; i < expr.clauses.size(); i++)
-        expr.clauses[i].w = w_to_w[expr.clauses[i].w];
-
-    // 2. remove all clauses with probability 1
-    w_to_w.clear(); w_to_p.clear();
-    w_to_w[-1] = -1;
-    for(unsigned int i = 0; i < expr.clauses.size(); i++){
-        weight_t w = expr.clauses[i].w;
-        probability_t p = get_probability(i);
-        if(p != 1 && w_to_w.find(w) == w_to_w.end()){
-            w_to_w[w] = w_to_p.size();
-            w_to_p.push_back(p);
-        }
+};
+
+// Encodes the CPT of variable i through an algebraic decision diagram over
+// its parents and itself, in CPT order. A variable is not tested where the
+// rows are equal for all its values, and every path of the diagram becomes
+// one clause over the variables it tests. The diagram is built bottom-up
+// from the CPT in a single pass per variable, with a unique table per level.
+void cnf::encode_add(unsigned int i){
+    const unsigned int m = bn->get_parent_size(i);
+    vector<uint32_t> variable(m+1), dim(m+1);
+    for(unsigned int j = 0; j < m; j++)
+        variable[j] = bn->get_parent(i)[j];
+    variable[m] = i;
+    for(unsigned int j = 0; j <= m; j++)
+        dim[j] = expr.values[variable[j]];
+
+    // nodes below LEAVES are the distinct probabilities of the CPT
+    const unsigned int SIZE = bn->get_cpt_size(i);
+    const probability_t *cpt = bn->get_cpt(i);
+    vector<probability_t> leaf;
+    unordered_map<probability_t, uint32_t> to_leaf;
+    vector<uint32_t> level(SIZE);
+    for(unsigned int q = 0; q < SIZE; q++){
+        auto it = to_leaf.emplace(cpt[q], leaf.size());
+        if(it.second)
+            leaf.push_back(cpt[q]);
+        level[q] = it.first->second;
     }
-    for(unsigned int i = 0; i < expr.clauses.size(); i++){
-        if(get_probability(i) == 1){
-            expr.clauses.erase(expr.clauses.begin()+i);
-            expr.clause_to_variable.erase(expr.clause_to_variable.begin()+i);
-            i--;
-        } else expr.clauses[i].w = w_to_w[expr.clauses[i].w];
+    const uint32_t LEAVES = leaf.size();
+
+    // the fastest changing variable of the CPT is the lowest in the diagram
+    vector<uint32_t> node_variable, node_children, children;
+    for(int k = m; k >= 0; k--){
+        unordered_map<vector<uint32_t>, uint32_t, add_node_hash> unique;
+        vector<uint32_t> next(level.size()/dim[k]);
+        for(unsigned int j = 0; j < next.size(); j++){
+            const uint32_t *row = &level[j*dim[k]];
+            if(std::count(row, row+dim[k], row[0]) == (int) dim[k]){
+                next[j] = row[0];
+                continue;
+            }
+            auto it = unique.emplace(vector<uint32_t>(row, row+dim[k]), LEAVES+node_variable.size());
+            if(it.second){
+                node_variable.push_back(k);
+                node_children.push_back(children.size());
+                children.insert(children.end(), row, row+dim[k]);
+            }
+            next[j] = it.first->second;
+        }
+        level.swap(next);
     }
-    weight_to_probability = w_to_p;
-    expr.WEIGHTS = weight_to_probability.size();
-}
-
-
-void cnf::encode_deterministic_probabilities(){
-    vector <probability_t> w_to_p;
-    w_to_p.push_back(0);
-    w_to_p.push_back(1);
 
-    int d[2] = { 0 };
-    map< int, int > w_to_w;
-    w_to_w[-1] = -1;
-    for(unsigned int i = 0; i < expr.clauses.size(); i++){
-        weight_t w = expr.clauses[i].w;
-        probability_t p = get_probability(i);
+    // one clause per path, over the literals of the values it takes
+    vector<literal_t> path;
+    std::function<void(uint32_t)> emit = [&](uint32_t node){
+        if(node < LEAVES){
+            expr.clause_to_variable.push_back(i);
+            expr.clauses.new_clause(weight_to_probability.size());
+            for(unsigned int l = 0; l < path.size(); l++)
+                expr.clauses.push_literal(path[l]);
 
-        if(p == 0 || p == 1){
-            w_to_w[w] = (weight_t) p;
-            d[(weight_t) p] = 1;
-        } else if(w_to_w.find(w) == w_to_w.end()){
-            w_to_w[w] = w_to_p.size();
-            w_to_p.push_back(p);
+            probability_t p = leaf[node];
+            if(p == 0)
+                expr.ZERO++;
+            if(p == 0 || p == 1)
+                expr.DETERMINISTIC++;
+            weight_to_probability.push_back(p);
+            csi_clauses++;
+            return;
         }
-    }
-
-    if(!d[1]) w_to_p.erase(w_to_p.begin()+1);
-    if(!d[0]) w_to_p.erase(w_to_p.begin());
-    weight_to_probability = w_to_p;
-    for(unsigned int i = 0; i < expr.clauses.size(); i++){
-        weight_t &w = expr.clauses[i].w;
-        w = w_to_w[w];
-        if(w > 0)
-            w = w + d[0] + d[1] - 2;
-    }
+        const unsigned int k = node_variable[node-LEAVES];
+        for(unsigned int v = 0; v < dim[k]; v++){
+            if(OPT_BOOL && dim[k] == 2){
+                literal_t lid = v_to_l(variable[k],0);
+                path.push_back(v == 1 ? -lid : lid);
+            } else path.push_back(-1*(literal_t) v_to_l(variable[k],v));
+            emit(children[node_children[node-LEAVES]+v]);
+            path.pop_back();
+        }
+    };
+    emit(level[0]);
+    csi_rows += SIZE;
     expr.WEIGHTS = weight_to_probability.size();
 }
 
-void cnf::encode_equal_probabilities(){
-    map< unsigned, vector<unsigned int> > variable_to_clause;
-    for(unsigned int i = 0; i < expr.clause_to_variable.size(); i++)
-        variable_to_clause[expr.clause_to_variable[i]].push_back(i);
+// the clause groups of the current clauses in (variable, weight) order
+void cnf::get_qm_groups(std::vector<qm_group_t> &groups) const {
+    map<unsigned int, vector<uint32_t> > variable_to_clause;
+    for(unsigned int c = 0; c < expr.clause_to_variable.size(); c++)
+        variable_to_clause[expr.clause_to_variable[c]].push_back(c);
 
-    vector<probability_t> p_to_w;
-    for(unsigned int v = 0; v < VARIABLES; v++){
-        vector<unsigned int> &cpt_clause = variable_to_clause[v];
-
-        map< probability_t, vector<int> > probability_to_clause;
-        for(unsigned int idx = 0; idx < cpt_clause.size(); idx++){
-            unsigned int i = cpt_clause[idx];
-            probability_t p = get_probability(i);
-            if(p >= 0)
-                probability_to_clause[p].push_back(i);
+    for(auto vit = variable_to_clause.begin(); vit != variable_to_clause.end(); vit++){
+
+        // per variable, group clauses with equal symbolic probability
+        map< int, vector<uint32_t> > weight_to_clause;
+        for(unsigned int c = 0; c < vit->second.size(); c++){
+            unsigned int clausenr = vit->second[c];
+            weight_to_clause[expr.clauses[clausenr].w].push_back(clausenr);
         }
-        for(auto it = probability_to_clause.begin(); it != probability_to_clause.end(); it++){
-            unsigned int pid = p_to_w.size();
-            p_to_w.push_back(it->first);
-            for(unsigned int idx = 0; idx < it->second.size(); idx++)
-                expr.clauses[it->second[idx]].w = pid;
+
+        for(auto mit = weight_to_clause.begin(); mit != weight_to_clause.end(); mit++){
+            groups.resize(groups.size()+1);
+            qm_group_t &group = groups.back();
+            group.variable = vit->first;
+            group.weight = mit->first;
+            group.clauses.swap(mit->second);
+
+            // map literals in clause groups to [0-...] range
+            map <uint32_t, uint32_t> &l_to_i = group.l_to_i;
+            for(auto cit = group.clauses.begin(); cit != group.clauses.end(); cit++){
+                const_clause_ref clause = expr.clauses[*cit];
+                for(auto lit = clause.literals.begin(); lit != clause.literals.end(); lit++){
+                    if(l_to_i.find(abs(*lit)) == l_to_i.end()){
+                        uint32_t idx = l_to_i.size();
+                        l_to_i[abs(*lit)] = idx;
+                    }
+                }
+            }
         }
     }
-    weight_to_probability = p_to_w;
-    expr.WEIGHTS = weight_to_probability.size();
 }
 
+// The models of the QM problem of a clause group: the at least and at most
+// one value constraints of its multi-valued variables, and its clauses.
 template <class T>
-void cnf::reduce(std::vector< uint32_t > &clauses, std::vector<clause> &nclauses, std::map<uint32_t,uint32_t> &l_to_i){
-    qm<T> q;
+void cnf::get_qm_models(const qm_group_t &group, std::vector< cube<T> > &constraints, std::vector< cube<T> > &models) const {
+    const std::map<uint32_t,uint32_t> &l_to_i = group.l_to_i;
+    const uint32_t N = l_to_i.size();
 
     // craeate variables to literal mapping
-    std::map <unsigned int, std::vector <unsigned int> > v_to_l;
-    for(auto mlit = l_to_i.begin(); mlit != l_to_i.end(); mlit++){
-        q.add_variable(mlit->first, mlit->second);
-        v_to_l[expr.literal_to_variable[mlit->first]].push_back(mlit->first);
-    }
+    std::map <unsigned int, std::vector <unsigned int> > v_to_i;
+    for(auto mlit = l_to_i.begin(); mlit != l_to_i.end(); mlit++)
+        v_to_i[expr.literal_to_variable[mlit->first]].push_back(mlit->second);
 
     // create constraint clauses
-    std::vector < cube<T> > constraints;
-    for(auto vit = v_to_l.begin(); vit != v_to_l.end(); vit++){
-        std::vector <unsigned int> &literals = vit->second;
+    for(auto vit = v_to_i.begin(); vit != v_to_i.end(); vit++){
+        std::vector <unsigned int> &idx = vit->second;
+        if(idx.size() <= 1)
+            continue;
+
+        // variable clauses
+        {
+            constraints.resize(constraints.size()+1);
+            cube<T> &m = constraints.back();
+            m[0].clear_all();
+            m[1].set_lsb(N);
+            for(unsigned int i = 0; i < idx.size(); i++)
+                m[1].clear(idx[i]);
+        }
 
-        if(literals.size() > 1){
-            // variable clauses
-            {
+        // constraint clauses
+        for(unsigned int l1 = 0; l1 < idx.size()-1; l1++){
+            for(unsigned int l2 = l1+1; l2 < idx.size(); l2++){
                 constraints.resize(constraints.size()+1);
                 cube<T> &m = constraints.back();
                 m[0].clear_all();
-                m[1].set_lsb(l_to_i.size());
-                for(unsigned int i = 0; i < literals.size(); i++)
-                    m[1].clear(l_to_i[literals[i]]);
-            }
+                m[0].set(idx[l1]);
+                m[0].set(idx[l2]);
 
-            // constraint clauses
-            for(unsigned int l1 = 0; l1 < literals.size()-1; l1++){
-                for(unsigned int l2 = l1+1; l2 < literals.size(); l2++){
-                    constraints.resize(constraints.size()+1);
-                    cube<T> &m = constraints.back();
-                    T tl1 = l_to_i[literals[l1]];
-                    T tl2 = l_to_i[literals[l2]];
-
-                    m[0].clear_all();
-                    m[0].set(tl1);
-                    m[0].set(tl2);
-
-                    m[1].set_lsb(l_to_i.size());
-                    m[1].clear(tl1);
-                    m[1].clear(tl2);
-                }
+                m[1].set_lsb(N);
+                m[1].clear(idx[l1]);
+                m[1].clear(idx[l2]);
             }
         }
     }
 
-    // add constraint clauses
-    for(auto it = constraints.begin(); it != constraints.end(); it++)
-        q.add_model(*it);
-
     // models
-    for(auto cit = clauses.begin(); cit != clauses.end(); cit++){
-        cube<T> model;
+    for(auto cit = group.clauses.begin(); cit != group.clauses.end(); cit++){
+        models.resize(models.size()+1);
+        cube<T> &model = models.back();
         model[0].clear_all();
-        model[1].set_lsb(l_to_i.size());
-        clause_t &clause = expr.clauses[*cit];
+        model[1].set_lsb(N);
+        const_clause_ref clause = expr.clauses[*cit];
         for(unsigned int i = 0; i < clause.literals.size(); i++){
-            unsigned int idx = l_to_i[abs(clause.literals[i])];
+            unsigned int idx = l_to_i.at(abs(clause.literals[i]));
             model[1].clear(idx);
             if(signbit(clause.literals[i]))
                 model[0].set(idx);
         }
-        q.add_model(model);
     }
+}
+
+template void cnf::get_qm_models<uint32_t>(const qm_group_t&, std::vector< cube<uint32_t> >&, std::vector< cube<uint32_t> >&) const;
+
+template <class T>
+bool cnf::reduce(const qm_group_t &group, std::vector<clause> &nclauses, FILE *log){
+    const std::vector<uint32_t> &clauses = group.clauses;
+    qm<T> q;
+    q.set_budget(QM_NODES, QM_SECONDS);
+    for(auto mlit = group.l_to_i.begin(); mlit != group.l_to_i.end(); mlit++)
+        q.add_variable(mlit->first, mlit->second);
+
+    // constraint clauses first, then the clauses of the group
+    std::vector < cube<T> > constraints, models;
+    get_qm_models(group, constraints, models);
+    for(auto it = constraints.begin(); it != constraints.end(); it++)
+        q.add_model(*it);
+    for(auto it = models.begin(); it != models.end(); it++)
+        q.add_model(*it);
 
     // perform Quine-McCluskey
+    q.set_pool(pool);
     q.solve();
 
+    // out of time before the primes were found, the clauses are kept
+    if(q.out_of_time()){
+        if(log)
+            fprintf(log, "    stopped by the time budget, the clauses are kept\n");
+        unsigned int offset = nclauses.size();
+        nclauses.resize(offset+clauses.size());
+        for(unsigned int i = 0; i < clauses.size(); i++){
+            const_clause_ref c = expr.clauses[clauses[i]];
+            nclauses[offset+i].literals.assign(c.literals.begin(), c.literals.end());
+        }
+        return true;
+    }
+
     // remove constraint clauses
     // ASSUMPTION: constraint clauses haven't been added before calling this function
     for(auto it = constraints.begin(); it != constraints.end(); it++)
         q.remove_prime(*it);
 
-    printf("    #clauses reduced from %lu to %d!\n", clauses.size(), q.get_primes_size());
+    if(log){
+        fprintf(log, "    #clauses reduced from %lu to %d!\n", clauses.size(), q.get_primes_size());
+        if(q.interrupted_search())
+            fprintf(log, "    cover search stopped by the budget, the cover may not be minimal\n");
+    }
     if(clauses.size() < q.get_primes_size())
         fprintf(stderr, "ERROR: nr of clauses increased!!\n");
+    const vector<float> &utilization = q.get_utilization();
+    if(log && !utilization.empty()){
+        fprintf(log, "    utilization per merge round:");
+        for(unsigned int i = 0; i < utilization.size(); i++)
+            fprintf(log, " %.0f%%", 100*utilization[i]);
+        fprintf(log, "\n");
+    }
     //printf("primes %d: ", q.primes.size());
     //for(unsigned int i = 0;i < q.primes.size(); i++)
     //    printf("(%lu,%lu)", q.primes[i][0].value, q.primes[i][1].value);
@@ -1072,119 +1626,227 @@ void cnf::reduce(std::vector< uint32_t > &clauses, std::vector<clause> &nclauses
         for(unsigned int j = 0; j < l.size(); j++)
             l[j] = -1*l[j];
     }
+    return q.interrupted_search();
 }
 
+// The cache key of a clause group in index space: the number of literals,
+// the literals of every variable that get the at least/most one constraints,
+// and the clauses as signed index+1, each part sorted so that the order in
+// which the group was collected does not matter.
+static void cache_key(const expression_t &expr, const std::vector<uint32_t> &clauses, std::map<uint32_t,uint32_t> &l_to_i, qm_cache::key_t &key){
+    std::map<unsigned int, std::vector<int32_t> > v_to_i;
+    for(auto lit = l_to_i.begin(); lit != l_to_i.end(); lit++)
+        v_to_i[expr.get_literal_to_variable()[lit->first]].push_back(lit->second);
+    std::vector< std::vector<int32_t> > groups;
+    for(auto vit = v_to_i.begin(); vit != v_to_i.end(); vit++){
+        if(vit->second.size() > 1){
+            groups.push_back(vit->second);
+            std::sort(groups.back().begin(), groups.back().end());
+        }
+    }
+    std::sort(groups.begin(), groups.end());
+
+    std::vector< std::vector<int32_t> > models(clauses.size());
+    for(unsigned int c = 0; c < clauses.size(); c++){
+        const_clause_ref clause = expr.clauses[clauses[c]];
+        for(unsigned int i = 0; i < clause.literals.size(); i++){
+            int32_t idx = l_to_i[abs(clause.literals[i])] + 1;
+            models[c].push_back(signbit(clause.literals[i]) ? -idx : idx);
+        }
+        std::sort(models[c].begin(), models[c].end());
+    }
+    std::sort(models.begin(), models.end());
+    models.erase(std::unique(models.begin(), models.end()), models.end());
+
+    key.clear();
+    key.push_back(l_to_i.size());
+    for(auto parts : {&groups, &models}){
+        key.push_back(parts->size());
+        for(unsigned int i = 0; i < parts->size(); i++){
+            key.push_back((*parts)[i].size());
+            key.insert(key.end(), (*parts)[i].begin(), (*parts)[i].end());
+        }
+    }
+}
+
+// prime clauses between literals and index space
+static void to_cache(const std::vector<clause> &nclauses, std::map<uint32_t,uint32_t> &l_to_i, qm_cache::value_t &value){
+    value.resize(nclauses.size());
+    for(unsigned int c = 0; c < nclauses.size(); c++){
+        value[c].clear();
+        for(unsigned int i = 0; i < nclauses[c].literals.size(); i++){
+            int32_t idx = l_to_i[abs(nclauses[c].literals[i])] + 1;
+            value[c].push_back(nclauses[c].literals[i] < 0 ? -idx : idx);
+        }
+    }
+}
+
+static void from_cache(const qm_cache::value_t &value, std::map<uint32_t,uint32_t> &l_to_i, std::vector<clause> &nclauses){
+    std::vector<int32_t> i_to_l(l_to_i.size());
+    for(auto lit = l_to_i.begin(); lit != l_to_i.end(); lit++)
+        i_to_l[lit->second] = lit->first;
+    nclauses.resize(value.size());
+    for(unsigned int c = 0; c < value.size(); c++){
+        nclauses[c].literals.clear();
+        for(unsigned int i = 0; i < value[c].size(); i++){
+            int32_t l = i_to_l[abs(value[c][i])-1];
+            nclauses[c].literals.push_back(value[c][i] < 0 ? -l : l);
+        }
+    }
+}
+
+// A group of clauses of one variable sharing the same weight. Groups are
+// independent QM problems, each one is solved into its own output buffer.
+struct prime_group_t : qm_group_t {
+    enum action_t { COPY, SKIP, REDUCE } action;
+    std::vector<clause> nclauses;
+    bool interrupted;               // the cover search ran out of budget
+    char *log;
+    size_t log_size;
+};
+
 void cnf::encode_prime(){
+    metrics::phase phase("encode.qm");
     if(expr.clauses.size() > 0){
         qm_variable_count.clear();
         qm_eligible = 0;
         qm_possible = 0;
-        std::vector<weight_t> clause_to_weight;
-        for(unsigned int i = 0; i < expr.clauses.size(); i++)
-            clause_to_weight.push_back(expr.clauses[i].w);
-
-        std::vector<clause> nclauses;
-        std::vector<weight_t> nclause_to_weight;
+        qm_interrupted = 0;
+        clause_store nclauses;
+        nclauses.reserve(expr.clauses.size(), expr.clauses.get_nr_literals());
         std::vector<uint32_t> nclause_to_variable;
 
-        map<unsigned int, vector<uint32_t> > variable_to_clause;
-        for(unsigned int c = 0; c < expr.clause_to_variable.size(); c++)
-            variable_to_clause[expr.clause_to_variable[c]].push_back(c);
-
-        for(unsigned int v = 0; v < VARIABLES; v++){
+        // collect the clause groups in (variable, weight) order
+        std::vector<qm_group_t> qm_groups;
+        get_qm_groups(qm_groups);
+        std::vector<prime_group_t> groups(qm_groups.size());
+        for(unsigned int g = 0; g < groups.size(); g++){
+            prime_group_t &group = groups[g];
+            static_cast<qm_group_t&>(group) = std::move(qm_groups[g]);
+            group.interrupted = false;
+            group.log = NULL;
+            group.log_size = 0;
+            map <uint32_t, uint32_t> &l_to_i = group.l_to_i;
+
+            group.action = prime_group_t::COPY;
+            if(group.clauses.size() > 1){
+                dynamic_assign(qm_variable_count, l_to_i.size())++;
+                qm_possible++;
+                unsigned int width = (QM_LIMIT > 0 ? std::min(QM_LIMIT, QM_MAX_WIDTH) : QM_MAX_WIDTH);
+                if(l_to_i.size() > width){
+                    group.action = prime_group_t::SKIP;
+                } else {
+                    qm_eligible++;
+                    group.action = prime_group_t::REDUCE;
+                }
+            }
+        }
 
-            // per variable, group clauses with equal symbolic probability
-            map< int, vector<uint32_t> > weight_to_clause;
-            for(unsigned int c = 0; c < variable_to_clause[v].size(); c++){
-                unsigned int clausenr = variable_to_clause[v][c];
-                weight_to_clause[clause_to_weight[clausenr]].push_back(clausenr);
+        // perform Quine-McCluskey on a clause group
+        auto solve = [this](prime_group_t &group, FILE *log){
+            vector<uint32_t> &clauses = group.clauses;
+            map <uint32_t, uint32_t> &l_to_i = group.l_to_i;
+
+            // print current clause group, with -v
+            if(log){
+                fprintf(log, "(%u/%u) probability: ", group.variable, VARIABLES);
+                if(group.weight==-1)
+                    fprintf(log, "NONE  probability: NONE   ");
+                else fprintf(log, "%-4d  probability: %-.3f  ", expr.LITERALS+1+group.weight, weight_to_probability[group.weight]);
+                fprintf(log, "literals: %-4lu  clauses: %-4lu\n", l_to_i.size(), clauses.size());
             }
 
-            // per group of clauses apply quine-mccluskey
-            for(auto mit = weight_to_clause.begin(); mit != weight_to_clause.end(); mit++){
-                vector<uint32_t> &clauses = mit->second;
-
-                // map literals in clause groups to [0-...] range
-                map <uint32_t, uint32_t> l_to_i;
-                for(auto cit = clauses.begin(); cit != clauses.end(); cit++){
-                    clause_t &clause = expr.clauses[*cit];
-                    for(auto lit = clause.literals.begin(); lit != clause.literals.end(); lit++){
-                        if(l_to_i.find(abs(*lit)) == l_to_i.end())
-                            l_to_i[abs(*lit)] = l_to_i.size()-1;
-                    }
+            // a cached group is not solved again
+            qm_cache::key_t key;
+            qm_cache::value_t value;
+            if(group.action == prime_group_t::REDUCE && cache){
+                cache_key(expr, clauses, l_to_i, key);
+                if(cache->lookup(key, value)){
+                    from_cache(value, l_to_i, group.nclauses);
+                    metrics::count("qm.groups.cached");
+                    if(log)
+                        fprintf(log, "    #clauses reduced from %lu to %lu! (cached)\n", clauses.size(), group.nclauses.size());
+                    return;
                 }
+            }
 
-                // print current clause group
-                printf("(%u/%u) probability: ", v, VARIABLES);
-                if(mit->first==-1)
-                    printf("NONE  probability: NONE   ");
-                else printf("%-4d  probability: %-.3f  ", expr.LITERALS+1+mit->first, weight_to_probability[mit->first]);
-                printf("literals: %-4lu  clauses: %-4lu\n", l_to_i.size(), mit->second.size());
-
-                // print participating clauses
-                //for(unsigned int k = 0; k < clauses.size(); k++){
-                //    int i = clauses[k];
-                //    printf("   %3u: v%-4u ", i, expr.clause_to_variable[i]);
-                //    if(get_probability(i) == -1)
-                //        printf("NONE  ");
-                //    else
-                //        printf("p%-4d ",expr.LITERALS+1+clause_to_probability[i]);
-                //    printf("(%-.3f): ", get_probability(i));
-                //    for(unsigned int j = 0; j < expr.clauses[i].literals.size(); j++){
-                //        if(!signbit(expr.clauses[i].literals[j]))
-                //            printf(" %-3d ", expr.clauses[i].literals[j]);
-                //        else
-                //            printf("%-4d ", expr.clauses[i].literals[j]);
-                //    }
-                //    printf("\n");
-                //}
-
-                unsigned int offset = nclauses.size();
-                unsigned int CLAUSES = clauses.size();
-                nclause_to_weight.resize(offset+CLAUSES);
-                nclause_to_variable.resize(offset+CLAUSES);
-                for(unsigned int i = 0; i < CLAUSES; i++){
-                    nclause_to_weight[offset+i] = mit->first;
-                    nclause_to_variable[offset+i] = v;
+            if(group.action == prime_group_t::REDUCE){
+                if(l_to_i.size() <= 32)
+                    group.interrupted = reduce<uint32_t>(group, group.nclauses, log);
+                else if(l_to_i.size() <= 64)
+                    group.interrupted = reduce<uint64_t>(group, group.nclauses, log);
+                #if __LP64__
+                else if(l_to_i.size() <= 128)
+                    group.interrupted = reduce<uint128_t>(group, group.nclauses, log);
+                #endif
+
+                // results of an interrupted cover search may not be minimal
+                if(cache && !group.interrupted){
+                    to_cache(group.nclauses, l_to_i, value);
+                    cache->insert(key, value);
                 }
-
-                // perform Quine-McCluskey on clause group
-                if(clauses.size() > 1){
-                    dynamic_assign(qm_variable_count, l_to_i.size())++;
-                    qm_possible++;
-                    #if __LP64__
-                    if((QM_LIMIT > 0 && l_to_i.size() > (unsigned int) QM_LIMIT) || l_to_i.size() > 128){
-                    #else
-                    if((QM_LIMIT > 0 && l_to_i.size() > (unsigned int) QM_LIMIT) || l_to_i.size() > 64){
-                    #endif
-                        printf("  SKIPPED\n");
-                        nclauses.resize(offset+CLAUSES);
-                        for(unsigned int i = 0; i < CLAUSES; i++)
-                            nclauses[offset+i] = expr.clauses[clauses[i]];
-                    } else {
-                        qm_eligible++;
-                        if(l_to_i.size() <= 32)
-                            reduce<uint32_t>(clauses, nclauses, l_to_i);
-                        else if(l_to_i.size() <= 64)
-                            reduce<uint64_t>(clauses, nclauses, l_to_i);
-                        #if __LP64__
-                        else if(l_to_i.size() <= 128)
-                            reduce<uint128_t>(clauses, nclauses, l_to_i);
-                        #endif
-                    }
-                } else if(clauses.size() == 1) {
-                    nclauses.resize(offset+1);
-                    nclauses[offset] = expr.clauses[clauses[0]];
+            } else {
+                if(group.action == prime_group_t::SKIP && log)
+                    fprintf(log, "  SKIPPED\n");
+                group.nclauses.resize(clauses.size());
+                for(unsigned int i = 0; i < clauses.size(); i++){
+                    const_clause_ref c = expr.clauses[clauses[i]];
+                    group.nclauses[i].w = c.w;
+                    group.nclauses[i].literals.assign(c.literals.begin(), c.literals.end());
                 }
             }
+        };
+
+        if(THREADS > 0){
+            // groups are solved concurrently, each logging to its own buffer
+            threadpool::batch b;
+            for(unsigned int g = 0; g < groups.size(); g++){
+                prime_group_t *group = &groups[g];
+                pool->submit(b, [this, group, &solve](){
+                    FILE *log = VERBOSITY > 0 ? open_memstream(&group->log, &group->log_size) : NULL;
+                    solve(*group, log);
+                    if(log)
+                        fclose(log);
+                });
+            }
+            pool->wait(b);
+        }
+
+        // merge the groups in order, the reduced group keeps the weight and
+        // variable of its clauses
+        for(unsigned int g = 0; g < groups.size(); g++){
+            prime_group_t &group = groups[g];
+            if(THREADS > 0){
+                if(group.log)
+                    fwrite(group.log, 1, group.log_size, stdout);
+                free(group.log);
+            } else solve(group, VERBOSITY > 0 ? stdout : NULL);
+            if(group.interrupted)
+                qm_interrupted++;
+            if(group.action == prime_group_t::REDUCE){
+                metrics::count("qm.clauses.in", group.clauses.size());
+                metrics::count("qm.clauses.out", group.nclauses.size());
+            }
+
+            for(unsigned int i = 0; i < group.nclauses.size(); i++){
+                const std::vector<int32_t> &l = group.nclauses[i].literals;
+                nclauses.append(l.data(), l.size(), group.weight);
+                nclause_to_variable.push_back(group.variable);
+            }
+            std::vector<clause>().swap(group.nclauses);
         }
         expr.clause_to_variable = nclause_to_variable;
-        clause_to_weight = nclause_to_weight;
-        expr.clauses = nclauses;
+        expr.clauses.swap(nclauses);
+
+        metrics::count("qm.groups", groups.size());
+        metrics::count("qm.groups.possible", qm_possible);
+        metrics::count("qm.groups.eligible", qm_eligible);
+        metrics::count("qm.groups.interrupted", qm_interrupted);
     }
 }
 
-void cnf::set_filename(char* name){
+void cnf::set_filename(const char* name){
+    free(filename);
     filename = strdup(name);
 }
 
@@ -1192,6 +1854,25 @@ void cnf::set_qm_limit(int max){
     QM_LIMIT = max;
 }
 
+void cnf::set_threads(unsigned int threads){
+    THREADS = threads;
+}
+
+void cnf::set_verbosity(int verbosity){
+    VERBOSITY = verbosity;
+}
+
+void cnf::set_qm_cache(const char *file){
+    delete cache;
+    cache = new qm_cache();
+    cache->open(file);
+}
+
+void cnf::set_qm_budget(uint64_t nodes, double seconds){
+    QM_NODES = nodes;
+    QM_SECONDS = seconds;
+}
+
 void cnf::set_optimization(opt_t opt){
     switch(opt){
         case PARTITION:
@@ -1213,6 +1894,14 @@ void cnf::set_optimization(opt_t opt){
             OPT_SUPPRESS_CONSTRAINTS = false;
             set_encoding(1);
             break;
+        case CSI:
+            // paths skip variables, which needs their exactly-one constraints
+            OPT_CSI = true;
+            OPT_EQUAL_PROBABILITIES = true;
+            OPT_SUPPRESS_CONSTRAINTS = false;
+            if(!OPT_QUINE_MCCLUSKEY)
+                set_encoding(0);
+            break;
         case BOOL:
             OPT_BOOL = true;
             break;
@@ -1225,6 +1914,10 @@ void cnf::set_optimization(opt_t opt){
     }
 }
 
+void cnf::set_amo(amo::encoding_t encoding){
+    AMO = encoding;
+}
+
 void cnf::set_encoding(int encoding){
     this->encoding = encoding;
 }
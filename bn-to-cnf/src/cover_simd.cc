@@ -0,0 +1,304 @@
+#include "cover_simd.h"
+#include <string.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define COVER_X86
+#endif
+
+struct kernels_t {
+    void (*copy)(void*, const void*, size_t);
+    void (*and_assign)(void*, const void*, size_t);
+    void (*or_assign)(void*, const void*, size_t);
+    void (*xor_assign)(void*, const void*, size_t);
+    bool (*and_to)(void*, const void*, const void*, size_t);
+    bool (*none)(const void*, size_t);
+    size_t (*count)(const void*, size_t);
+};
+
+// scalar kernels, on 64-bit words and the remaining bytes
+// ==========================================================
+
+static inline uint64_t load64(const uint8_t *p){
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline void store64(uint8_t *p, uint64_t v){
+    memcpy(p, &v, sizeof(v));
+}
+
+static void copy_scalar(void *dst, const void *src, size_t bytes){
+    memcpy(dst, src, bytes);
+}
+
+#define SCALAR_ASSIGN(NAME, OP) \
+static void NAME(void *dst, const void *src, size_t bytes){ \
+    uint8_t *d = (uint8_t*) dst; \
+    const uint8_t *s = (const uint8_t*) src; \
+    size_t i = 0; \
+    for(; i+8 <= bytes; i += 8) \
+        store64(d+i, load64(d+i) OP load64(s+i)); \
+    for(; i < bytes; i++) \
+        d[i] = d[i] OP s[i]; \
+}
+
+SCALAR_ASSIGN(and_scalar, &)
+SCALAR_ASSIGN(or_scalar, |)
+SCALAR_ASSIGN(xor_scalar, ^)
+
+static bool and_to_scalar(void *dst, const void *a, const void *b, size_t bytes){
+    uint8_t *d = (uint8_t*) dst;
+    const uint8_t *x = (const uint8_t*) a, *y = (const uint8_t*) b;
+    uint64_t acc = 0;
+    size_t i = 0;
+    for(; i+8 <= bytes; i += 8){
+        uint64_t v = load64(x+i) & load64(y+i);
+        store64(d+i, v);
+        acc |= v;
+    }
+    for(; i < bytes; i++)
+        acc |= (d[i] = x[i] & y[i]);
+    return acc == 0;
+}
+
+static bool none_scalar(const void *src, size_t bytes){
+    const uint8_t *s = (const uint8_t*) src;
+    size_t i = 0;
+    for(; i+8 <= bytes; i += 8)
+        if(load64(s+i))
+            return false;
+    for(; i < bytes; i++)
+        if(s[i])
+            return false;
+    return true;
+}
+
+static size_t count_scalar(const void *src, size_t bytes){
+    const uint8_t *s = (const uint8_t*) src;
+    size_t c = 0, i = 0;
+    for(; i+8 <= bytes; i += 8)
+        c += __builtin_popcountll(load64(s+i));
+    for(; i < bytes; i++)
+        c += __builtin_popcount(s[i]);
+    return c;
+}
+
+static const kernels_t scalar_kernels = {
+    copy_scalar, and_scalar, or_scalar, xor_scalar, and_to_scalar, none_scalar, count_scalar
+};
+
+#ifdef COVER_X86
+
+// SSE2 kernels, 16 bytes at a time
+// ==========================================================
+
+#define SSE2_ASSIGN(NAME, INTRINSIC, TAIL) \
+__attribute__((target("sse2"))) \
+static void NAME(void *dst, const void *src, size_t bytes){ \
+    uint8_t *d = (uint8_t*) dst; \
+    const uint8_t *s = (const uint8_t*) src; \
+    size_t i = 0; \
+    for(; i+16 <= bytes; i += 16){ \
+        __m128i v = INTRINSIC(_mm_loadu_si128((const __m128i*) (d+i)), _mm_loadu_si128((const __m128i*) (s+i))); \
+        _mm_storeu_si128((__m128i*) (d+i), v); \
+    } \
+    TAIL(d+i, s+i, bytes-i); \
+}
+
+SSE2_ASSIGN(and_sse2, _mm_and_si128, and_scalar)
+SSE2_ASSIGN(or_sse2, _mm_or_si128, or_scalar)
+SSE2_ASSIGN(xor_sse2, _mm_xor_si128, xor_scalar)
+
+__attribute__((target("sse2")))
+static bool and_to_sse2(void *dst, const void *a, const void *b, size_t bytes){
+    uint8_t *d = (uint8_t*) dst;
+    const uint8_t *x = (const uint8_t*) a, *y = (const uint8_t*) b;
+    __m128i acc = _mm_setzero_si128();
+    size_t i = 0;
+    for(; i+16 <= bytes; i += 16){
+        __m128i v = _mm_and_si128(_mm_loadu_si128((const __m128i*) (x+i)), _mm_loadu_si128((const __m128i*) (y+i)));
+        _mm_storeu_si128((__m128i*) (d+i), v);
+        acc = _mm_or_si128(acc, v);
+    }
+    bool empty = _mm_movemask_epi8(_mm_cmpeq_epi8(acc, _mm_setzero_si128())) == 0xffff;
+    return and_to_scalar(d+i, x+i, y+i, bytes-i) && empty;
+}
+
+__attribute__((target("sse2")))
+static bool none_sse2(const void *src, size_t bytes){
+    const uint8_t *s = (const uint8_t*) src;
+    size_t i = 0;
+    for(; i+16 <= bytes; i += 16){
+        __m128i v = _mm_loadu_si128((const __m128i*) (s+i));
+        if(_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_setzero_si128())) != 0xffff)
+            return false;
+    }
+    return none_scalar(s+i, bytes-i);
+}
+
+static const kernels_t sse2_kernels = {
+    copy_scalar, and_sse2, or_sse2, xor_sse2, and_to_sse2, none_sse2, count_scalar
+};
+
+// AVX2 kernels, 32 bytes at a time
+// ==========================================================
+
+#define AVX2_ASSIGN(NAME, INTRINSIC, TAIL) \
+__attribute__((target("avx2"))) \
+static void NAME(void *dst, const void *src, size_t bytes){ \
+    uint8_t *d = (uint8_t*) dst; \
+    const uint8_t *s = (const uint8_t*) src; \
+    size_t i = 0; \
+    for(; i+32 <= bytes; i += 32){ \
+        __m256i v = INTRINSIC(_mm256_loadu_si256((const __m256i*) (d+i)), _mm256_loadu_si256((const __m256i*) (s+i))); \
+        _mm256_storeu_si256((__m256i*) (d+i), v); \
+    } \
+    TAIL(d+i, s+i, bytes-i); \
+}
+
+AVX2_ASSIGN(and_avx2, _mm256_and_si256, and_sse2)
+AVX2_ASSIGN(or_avx2, _mm256_or_si256, or_sse2)
+AVX2_ASSIGN(xor_avx2, _mm256_xor_si256, xor_sse2)
+
+__attribute__((target("avx2")))
+static void copy_avx2(void *dst, const void *src, size_t bytes){
+    uint8_t *d = (uint8_t*) dst;
+    const uint8_t *s = (const uint8_t*) src;
+    size_t i = 0;
+    for(; i+32 <= bytes; i += 32)
+        _mm256_storeu_si256((__m256i*) (d+i), _mm256_loadu_si256((const __m256i*) (s+i)));
+    memcpy(d+i, s+i, bytes-i);
+}
+
+__attribute__((target("avx2")))
+static bool and_to_avx2(void *dst, const void *a, const void *b, size_t bytes){
+    uint8_t *d = (uint8_t*) dst;
+    const uint8_t *x = (const uint8_t*) a, *y = (const uint8_t*) b;
+    __m256i acc = _mm256_setzero_si256();
+    size_t i = 0;
+    for(; i+32 <= bytes; i += 32){
+        __m256i v = _mm256_and_si256(_mm256_loadu_si256((const __m256i*) (x+i)), _mm256_loadu_si256((const __m256i*) (y+i)));
+        _mm256_storeu_si256((__m256i*) (d+i), v);
+        acc = _mm256_or_si256(acc, v);
+    }
+    bool empty = _mm256_testz_si256(acc, acc);
+    // avoid the AVX to SSE transition penalty in the remainder
+    _mm256_zeroupper();
+    return and_to_sse2(d+i, x+i, y+i, bytes-i) && empty;
+}
+
+__attribute__((target("avx2")))
+static bool none_avx2(const void *src, size_t bytes){
+    const uint8_t *s = (const uint8_t*) src;
+    size_t i = 0;
+    for(; i+32 <= bytes; i += 32){
+        __m256i v = _mm256_loadu_si256((const __m256i*) (s+i));
+        if(!_mm256_testz_si256(v, v))
+            return false;
+    }
+    return none_sse2(s+i, bytes-i);
+}
+
+__attribute__((target("avx2,popcnt")))
+static size_t count_avx2(const void *src, size_t bytes){
+    const uint8_t *s = (const uint8_t*) src;
+    size_t c = 0, i = 0;
+    for(; i+8 <= bytes; i += 8)
+        c += _mm_popcnt_u64(load64(s+i));
+    for(; i < bytes; i++)
+        c += _mm_popcnt_u32(s[i]);
+    return c;
+}
+
+static const kernels_t avx2_kernels = {
+    copy_avx2, and_avx2, or_avx2, xor_avx2, and_to_avx2, none_avx2, count_avx2
+};
+
+#endif
+
+// runtime dispatch
+// ==========================================================
+
+static bool supported(cover_isa_t isa){
+    #ifdef COVER_X86
+    __builtin_cpu_init();
+    if(isa == COVER_AVX2)
+        return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt");
+    if(isa == COVER_SSE2)
+        return __builtin_cpu_supports("sse2");
+    #endif
+    return isa == COVER_SCALAR;
+}
+
+static const kernels_t* get_kernels(cover_isa_t isa){
+    #ifdef COVER_X86
+    if(isa == COVER_AVX2)
+        return &avx2_kernels;
+    if(isa == COVER_SSE2)
+        return &sse2_kernels;
+    #endif
+    return &scalar_kernels;
+}
+
+static cover_isa_t select_isa(){
+    if(supported(COVER_AVX2))
+        return COVER_AVX2;
+    if(supported(COVER_SSE2))
+        return COVER_SSE2;
+    return COVER_SCALAR;
+}
+
+static cover_isa_t active_isa = select_isa();
+static const kernels_t *active = get_kernels(active_isa);
+
+cover_isa_t cover_get_isa(){
+    return active_isa;
+}
+
+bool cover_set_isa(cover_isa_t isa){
+    if(!supported(isa))
+        return false;
+    active_isa = isa;
+    active = get_kernels(isa);
+    return true;
+}
+
+const char* cover_isa_name(cover_isa_t isa){
+    switch(isa){
+        case COVER_AVX2:
+            return "avx2";
+        case COVER_SSE2:
+            return "sse2";
+        default:
+            return "scalar";
+    }
+}
+
+void cover_copy(void *dst, const void *src, size_t bytes){
+    active->copy(dst, src, bytes);
+}
+
+void cover_and(void *dst, const void *src, size_t bytes){
+    active->and_assign(dst, src, bytes);
+}
+
+void cover_or(void *dst, const void *src, size_t bytes){
+    active->or_assign(dst, src, bytes);
+}
+
+void cover_xor(void *dst, const void *src, size_t bytes){
+    active->xor_assign(dst, src, bytes);
+}
+
+bool cover_and_to(void *dst, const void *a, const void *b, size_t bytes){
+    return active->and_to(dst, a, b, bytes);
+}
+
+bool cover_none(const void *src, size_t bytes){
+    return active->none(src, bytes);
+}
+
+size_t cover_count(const void *src, size_t bytes){
+    return active->count(src, bytes);
+}
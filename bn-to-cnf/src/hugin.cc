@@ -2,11 +2,14 @@
 // NOTE: EXCEPTIONS NOT HANDLED
 #include "hugin.h"
 #include <stdarg.h>
+#include <stdlib.h>
+#include <charconv>
 
 using namespace std;
 using namespace HUGIN;
 
-hugin::hugin(){
+template <class R>
+static void add_hugin_delimiters(R &input){
     input.add_delimiters(standard_delimiter, 3, '=', ';', ',');
     input.add_delimiters(ignore_delimiter, 3, ' ', '\t', '\n', '\r');
     input.add_delimiters(escape_delimiter, 1, '\\', '*');
@@ -15,9 +18,44 @@ hugin::hugin(){
     input.add_delimiters(comment_delimiter, 1, '%', '\n');
 }
 
+hugin::hugin(){
+    add_hugin_delimiters(mapped);
+    add_hugin_delimiters(input);
+}
+
+// Converts a numeric token in place. from_chars does not accept a leading
+// '+' and some spellings strtod allows, those take the slow path.
+static bool to_number(string_view w, probability_t &p){
+    const char *b = w.data(), *e = w.data() + w.size();
+    if(e - b > 1 && *b == '+' && *(b+1) != '-')
+        b++;
+
+    from_chars_result r = from_chars(b, e, p);
+    if(r.ec == errc() && r.ptr == e)
+        return true;
+
+    string s(w);
+    char *end = NULL;
+    p = strtod(s.c_str(), &end);
+    return !s.empty() && *end == '\0';
+}
+
 void hugin::process(string f){
+    filename = f;
+    definition = HUGIN::domain_definition(); // a parser is reused across files
+    if(mapped.open(f)){
+        try {
+            definition.parse(mapped);
+        } catch (parse_error& e) {
+            ;
+            //throw parser_exception("HUGIN ERROR: %s", e.what());
+        }
+
+        mapped.close();
+        return;
+    }
+
     try {
-        filename = f;
         input.set_filename(f);
         if(input.open()){
             try {
@@ -34,7 +72,8 @@ void hugin::process(string f){
     }
 }
 
-void domain_definition::parse(reader &input){
+template <class R>
+void domain_definition::parse(R &input){
     input.allow_eof(false);
     header.parse(input);
     input.allow_eof(true);
@@ -48,7 +87,8 @@ void domain_definition::parse(reader &input){
     }
 }
 
-void domain_element::parse(reader &input){
+template <class R>
+void domain_element::parse(R &input){
     if(input.get_word_peek_equal("node")){
         type = node_domain_element;
         input.get_word_equal_or_assert("node");
@@ -67,7 +107,7 @@ void domain_element::parse(reader &input){
         }
 
         input.get_word_equal_or_assert(")");
-    } else throw parse_error("error on %d:%d: expecting domain element specifier, but got '%s'", input.get_row(), input.get_col(), input.get_word_peek().c_str());
+    } else throw parse_error("error on %d:%d: expecting domain element specifier, but got '%s'", input.get_row(), input.get_col(), string(input.get_word_peek()).c_str());
 
     input.get_word_equal_or_assert("{");
     while(input.get_word_peek_not_equal("}")){
@@ -78,7 +118,8 @@ void domain_element::parse(reader &input){
     input.get_word_equal_or_assert("}");
 }
 
-void domain_header::parse(reader &input){
+template <class R>
+void domain_header::parse(R &input){
     input.get_word_equal_or_assert("net");
     input.get_word_equal_or_assert("{");
     while(input.get_word_peek_not_equal("}")){
@@ -89,7 +130,8 @@ void domain_header::parse(reader &input){
     input.get_word_equal_or_assert("}");
 }
 
-void attribute::parse(reader &input){
+template <class R>
+void attribute::parse(R &input){
     name = input.get_word();
     input.get_word_equal_or_assert("=");
     value.parse(input);
@@ -101,7 +143,8 @@ variable::variable(){
     type = undefined_variable;
 }
 
-void variable::parse(reader &input, unsigned int d){
+template <class R>
+void variable::parse(R &input, unsigned int d){
     if(d > dimensions){
         dimensions = d;
         dim.push_back(0);
@@ -130,15 +173,24 @@ void variable::parse(reader &input, unsigned int d){
             if(type == string_variable){
                 input.get_word_equal_or_assert("\"");
                 if(input.get_word_peek_not_equal("\""))
-                    value.push_back(input.get_word());
+                    value.push_back(string(input.get_word()));
                 input.get_word_equal_or_assert("\"");
-            } else value.push_back(input.get_word());
+            } else {
+                auto w = input.get_word();
+                probability_t p;
+                if(to_number(w, p))
+                    number.push_back(p);
+                else value.push_back(string(w));
+            }
         } while(d>0 && input.get_word_peek_not_equal(")"));
         if(d > 0)
             dim[dim.size()-1] = values;
     }
 }
 
+template void domain_definition::parse<reader>(reader&);
+template void domain_definition::parse<lexer>(lexer&);
+
 void attribute::print(){
     printf("            %s %s = ", (value.type==float_variable?"float":(value.type==string_variable?"string":"unknown_type")), name.c_str());
     value.print();
@@ -148,6 +200,8 @@ void variable::print(){
     printf("%dd", dimensions);
     for(unsigned int i = 0; i < dim.size(); i++)
         printf("[%d]", dim[i]);
+    for(unsigned int i = 0; i < number.size(); i++)
+        printf(" %g", number[i]);
     for(unsigned int i = 0; i < value.size(); i++)
         printf(" %s", value[i].c_str());
     printf("\n");
@@ -192,8 +246,6 @@ attribute* domain_element::get_attribute(string varname){
 }
 
 void bidirected(dbn_t *net, vector<string> &words, string comb[2], int s = 0, int d = 0){
-    typedef dbn_t::node node;
-
     if(d < 2) {
         for(unsigned int i = s; i < words.size()-(2-d); i++){
             comb[d] = i;
@@ -202,13 +254,11 @@ void bidirected(dbn_t *net, vector<string> &words, string comb[2], int s = 0, in
     } else if(d == 2) {
         for(unsigned int i = s; i < words.size(); i++){
             comb[d] = i;
-            node *n0 = net->get_node(comb[0]);
-            node *n1 = net->get_node(comb[1]);
+            uint32_t n0 = net->get_id(comb[0]);
+            uint32_t n1 = net->get_id(comb[1]);
 
-            n0->parent.push_back(n1);
-            n1->parent.push_back(n0);
-            n0->child.push_back(n1);
-            n1->child.push_back(n0);
+            net->add_edge(n1, n0);
+            net->add_edge(n0, n1);
         }
     } else return;
 }
@@ -246,13 +296,9 @@ bayesnet* hugin::get_bayesnet(){
                 }
 
                 for(unsigned int i = 0; i < pre.size(); i++){
-                    dbn_t::node *pre_n = net->get_node(pre[i]);
-                    for(unsigned int j = 0; j < post.size(); j++){
-                        dbn_t::node *post_n = net->get_node(post[j]);
-
-                        pre_n->parent.push_back(post_n);
-                        post_n->child.push_back(pre_n);
-                    }
+                    uint32_t pre_id = net->get_id(pre[i]);
+                    for(unsigned int j = 0; j < post.size(); j++)
+                        net->add_edge(net->get_id(post[j]), pre_id);
                 }
 
                 dbn_t::node *n = net->get_node(words[0]);
@@ -263,16 +309,22 @@ bayesnet* hugin::get_bayesnet(){
                 if (n == NULL)
                     throw hugin_error("node '%s' not found to store CPT", words[0].c_str());
 
-                for (unsigned int i = 0; i < attr->value.value.size(); i++)
-                    n->cpt.push_back(atof(attr->value.value[i].c_str()));
+                if (!attr->value.value.empty())
+                    throw hugin_error("CPT of node '%s' contains non-numeric values", words[0].c_str());
+
+                // the parsed numbers are moved, not copied, into the node
+                if(n->cpt.empty())
+                    n->cpt.swap(attr->value.number);
+                else n->cpt.insert(n->cpt.end(), attr->value.number.begin(), attr->value.number.end());
 
             } else throw hugin_error("node type unknown");
         }
 
         try {
-            net->finalize();
+            net->finalize(query);
         } catch(dynamic_bayesnet_error &e){
             printf("dynamic bayesnet error: %s\n", e.what());
+            delete net;
             throw hugin_error("error finalizing net: %s", e.what());
         }
 
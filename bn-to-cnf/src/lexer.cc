@@ -0,0 +1,340 @@
+#include "lexer.h"
+#include <algorithm>
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+lexer::lexer(){
+    data = NULL;
+    pos = NULL;
+    end = NULL;
+    size = 0;
+    hierarchical = true;
+    commented = false;
+    eof_allowed = true;
+    eof_reached = false;
+    buffered = false;
+    for(unsigned int i = 0; i < 256; i++){
+        table[i].type = no_delimiter;
+        table[i].c = (char) i;
+        table[i].ce = '\0';
+    }
+    table[(unsigned char) '\\'].type = escape_delimiter;
+    table[(unsigned char) '\\'].ce = '*';
+}
+
+lexer::~lexer(){
+    close();
+}
+
+bool lexer::open(string f){
+    close();
+    filename = f;
+
+    // anything but a regular file is left unopened for the reader: opening
+    // a pipe here would consume its writer
+    struct stat st;
+    if(stat(filename.c_str(), &st) != 0 || !S_ISREG(st.st_mode))
+        return false;
+
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if(fd < 0)
+        return false;
+
+    if(fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)){
+        ::close(fd);
+        return false;
+    }
+
+    size = st.st_size;
+    if(size > 0){
+        void *m = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(m == MAP_FAILED){
+            ::close(fd);
+            size = 0;
+            return false;
+        }
+        madvise(m, size, MADV_SEQUENTIAL);
+        data = (const char*) m;
+    } else data = "";
+    ::close(fd);
+
+    pos = data;
+    end = data + size;
+    hierarchical = true;
+    commented = false;
+    eof_allowed = true;
+    eof_reached = false;
+    buffered = false;
+    while(!scope.empty())
+        scope.pop();
+    return true;
+}
+
+void lexer::close(){
+    if(data && size > 0)
+        munmap((void*) data, size);
+    data = NULL;
+    pos = NULL;
+    end = NULL;
+    size = 0;
+    buffered = false;
+}
+
+void lexer::allow_eof(bool e){
+    eof_allowed = e;
+}
+
+string lexer::get_filename(){
+    return filename;
+}
+
+string_view lexer::last_word(){
+    return string_view("END_OF_FILE");
+}
+
+int lexer::get_scope_depth(){
+    return scope.size();
+}
+
+int lexer::get_row(){
+    if(!data)
+        return 1;
+    return 1 + count(data, pos, '\n');
+}
+
+int lexer::get_col(){
+    if(!data)
+        return 0;
+    const char *p = pos;
+    while(p != data && *(p-1) != '\n')
+        p--;
+    return pos - p;
+}
+
+void lexer::add_delimiter(delimiter_type dt, char c, char ce){
+    bool scoped = (int) dt >= (int) scope_delimiter;
+    if(scoped && ce == '\0')
+        throw reader_error("scoped delimiters must have ending character");
+    else if(!scoped && ce != '\0')
+        throw reader_error("ending character provided for non-scoped delimiter");
+
+    delimiter_t d;
+    d.type = dt;
+    d.c = c;
+    d.ce = ce;
+    delimiters.push_back(d);
+
+    // the first delimiter matching a character determines its class
+    for(unsigned int i = 0; i < 256; i++){
+        char ch = (char) i;
+        delimiter_t &t = table[i];
+        t.type = no_delimiter;
+        t.c = ch;
+        t.ce = '\0';
+        for(unsigned int j = 0; j < delimiters.size(); j++){
+            if(delimiters[j].c == ch || ((int) delimiters[j].type >= (int) scope_delimiter && delimiters[j].ce == ch)){
+                t = delimiters[j];
+                break;
+            }
+        }
+        if(t.type == no_delimiter && ch == '\\'){
+            t.type = escape_delimiter;
+            t.ce = '*';
+        }
+    }
+}
+
+void lexer::add_delimiters(delimiter_type dt, unsigned int argc, ...){
+    va_list args;
+    va_start (args, argc);
+
+    if(dt == no_delimiter)
+        throw reader_error("Cannot not add delimiter of no type");
+    else if((int) dt >= (int) scope_delimiter){
+        for(unsigned int i = 0; i < argc; i++){
+            char lsd = (char) va_arg(args, int);
+            char rsd = (char) va_arg(args, int);
+            add_delimiter(dt, lsd, rsd);
+        }
+    } else {
+        for(unsigned int i = 0; i < argc; i++)
+            add_delimiter(dt, (char) va_arg(args, int));
+    }
+
+    va_end(args);
+}
+
+delimiter_t lexer::get_delimiter(char c){
+    if(commented){
+        if(!scope.empty() && scope.top().ce == c)
+            return scope.top();
+        delimiter_t d = {ignore_delimiter, c, '\0'};
+        return d;
+    } else if(hierarchical)
+        return table[(unsigned char) c];
+    else if(!scope.empty()){
+        delimiter_t d = scope.top();
+        if(d.type == escape_delimiter){
+            d.type = no_delimiter;
+            d.c = c;
+            return d;
+        } else if(c == d.ce)
+            return d;
+    }
+
+    delimiter_t d = {no_delimiter, c, '\0'};
+    if(c == '\\'){
+        d.type = escape_delimiter;
+        d.ce = '*';
+    }
+    return d;
+}
+
+void lexer::get_word_not_equal_or_assert(string_view c){
+    string_view w = get_word();
+    if(w == c)
+        throw parse_error("error on %d:%d: expecting '%.*s', but got '%.*s'\n", get_row(), get_col(), (int) c.size(), c.data(), (int) w.size(), w.data());
+}
+
+void lexer::get_word_equal_or_assert(string_view c){
+    string_view w = get_word();
+    if(w != c)
+        throw parse_error("error on %d:%d: expecting '%.*s', but got '%.*s'\n", get_row(), get_col(), (int) c.size(), c.data(), (int) w.size(), w.data());
+}
+
+bool lexer::get_word_peek_not_equal(string_view c){
+    return !get_word_peek_equal(c);
+}
+
+bool lexer::get_word_peek_equal(string_view c){
+    return get_word_peek() == c;
+}
+
+string_view lexer::get_word_peek(){
+    if(!buffered){
+        bufferword = next_word();
+        buffered = true;
+    }
+    return bufferword;
+}
+
+string_view lexer::get_word(){
+    if(buffered){
+        buffered = false;
+        return bufferword;
+    }
+    return next_word();
+}
+
+// Mirrors reader::get_word, except that a word is returned as the slice of
+// the mapping it was read from. Words are always contiguous: characters are
+// only skipped while no word has been started.
+string_view lexer::next_word(){
+    if(!data || eof_reached){
+        if(!scope.empty())
+            throw reader_error("Error at end of file: unmatched '%c', scope still at depth %d\n", scope.top().c, scope.size());
+        if(!eof_allowed)
+            throw reader_error("Error at end of file: EOF encountered while processing\n");
+        return last_word();
+    }
+
+    const char *start = pos;
+    size_t length = 0;
+    delimiter_t d;
+    do {
+        if(pos == end){
+            eof_reached = true;
+            if(length == 0)
+                return last_word();
+            break;
+        }
+
+        char c = *pos++;
+        if(length == 0)
+            start = pos-1;
+        d = get_delimiter(c);
+        if(!scope.empty() && scope.top().type == escape_delimiter){
+            scope.pop();
+            d.type = no_delimiter;
+            length++;
+        } else if(d.type == escape_delimiter){
+            scope.push(d);
+            d.type = no_delimiter;
+            length++;
+        } else if(d.type == standard_delimiter){
+            if(length == 0)
+                length++;
+            else pos--;
+        } else if (d.type == ignore_delimiter) {
+            if(length == 0){
+                d.type = no_delimiter;
+                continue;
+            } else if(!hierarchical){
+                length++;
+                d.type = no_delimiter;
+                continue;
+            }
+        } else if(d.type == string_scope_delimiter) {
+            if(length == 0){
+                length++;
+                if(hierarchical){
+                    scope.push(d);
+                    hierarchical = false;
+                } else {
+                    if(scope.top().ce == c){
+                        scope.pop();
+                        hierarchical = true;
+                    } else {
+                        d.type = no_delimiter;
+                        continue;
+                    }
+                }
+            } else pos--;
+        } else if(d.type == comment_delimiter){
+            if(length == 0){
+                if(commented){
+                    if(!scope.empty() && scope.top().ce == c){
+                        scope.pop();
+                        commented = false;
+                    } else throw reader_error("Error at %d:%d: cannot end comment with '%c' instead of '%c'\n", get_row(), get_col(), c, scope.top().ce);
+                } else {
+                    if(d.c == c){
+                        scope.push(d);
+                        commented = true;
+                    } else throw reader_error("Error at %d:%d: found comment ender '%c' whitout comment to end\n", get_row(), get_col(), c);
+                }
+                d.type = no_delimiter;
+            } else pos--;
+        } else if(d.type == scope_delimiter) {
+            if(hierarchical){
+                if(length == 0){
+                    length++;
+                    if(c == d.c)
+                        scope.push(d);
+                    else {
+                        if(!scope.empty()){
+                            if(scope.top().ce == c)
+                                scope.pop();
+                            else throw reader_error("Error at %d:%d: found scope ender '%c', while exprecting '%c'", get_row(), get_col(), c, scope.top().ce);
+                        } else throw reader_error("Error at %d:%d: found scope ender '%c', while in scope depth %d", get_row(), get_col(), c, get_scope_depth());
+                    }
+                } else pos--;
+            } else {
+                length++;
+                d.type = no_delimiter;
+                continue;
+            }
+        } else {
+            length++;
+            if(!scope.empty() && scope.top().type == escape_delimiter)
+                scope.pop();
+        }
+    } while(d.type == no_delimiter);
+
+    return string_view(start, length);
+}
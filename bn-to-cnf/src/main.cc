@@ -2,13 +2,63 @@
 // NOTE: EXCEPTIONS NOT HANDLED
 #include <stdio.h>
 #include <string>
+#include <vector>
+#include <algorithm>
+#include <thread>
 //#include "../build/getopt.h"
 #include <unistd.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <sys/stat.h>
 #include <ctype.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdlib.h>
 #include "parser.h"
 #include "bayesnet.h"
 #include "cnf.h"
 #include "misc.h"
+#include "threadpool.h"
+#include "metrics.h"
+
+// bytes of parsed network and CNF per byte of a .net file, the estimate a job
+// of --batch is charged to the memory budget with
+#define BATCH_MEMORY_FACTOR 16
+
+enum { OPT_BATCH = 256, OPT_REPORT, OPT_MEMORY, OPT_METRICS, OPT_TRACE, OPT_AMO };
+
+struct options_t {
+    options_t() : write(false), stats(false), cache(false), binary(false),
+        qm_limit(-1), threads(0), verbosity(0), budget_seconds(0), budget_nodes(0), amo(amo::PAIRWISE), memory(0) {};
+    std::string infile;
+    std::string outfile;                    // input without extension
+    std::string savefile;
+    bool write, stats, cache, binary;
+    std::vector<std::string> query;
+    std::vector<cnf::opt_t> optimizations;  // in the order given
+    int qm_limit;
+    unsigned int threads;
+    int verbosity;
+    double budget_seconds;
+    unsigned long budget_nodes;
+    amo::encoding_t amo;
+
+    std::string batch;                      // manifest
+    std::string report;
+    unsigned long memory;                   // MB, 0 is unlimited
+
+    std::string metrics;                    // of the process, not per network
+    std::string trace;
+};
+
+struct job_t {
+    options_t options;
+    unsigned int line;
+    uint64_t size;                          // of the input
+    int status;
+    double seconds;
+    unsigned int variables, literals, weights, clauses;
+};
 
 int isnumber (const char * s){
     if (s == NULL || *s == '\0' || isspace(*s))
@@ -18,8 +68,35 @@ int isnumber (const char * s){
     return *p == '\0';
 }
 
+// a positive decimal integer without trailing characters
+int iscount (const char * s, unsigned long &n){
+    if (s == NULL || !isdigit(*s))
+      return 0;
+    char * p;
+    errno = 0;
+    n = strtoul (s, &p, 10);
+    return *p == '\0' && errno == 0 && n > 0;
+}
+
+// one node name per line, the rest of a line (e.g. evidence values) and
+// lines starting with '#' are ignored
+int read_query (const char * filename, std::vector<std::string> &query){
+    FILE *file = fopen(filename, "r");
+    if(file == NULL)
+        return 0;
+    char line[4096];
+    while(fgets(line, sizeof(line), file)){
+        char *name = strtok(line, " \t\r\n");
+        if(name && name[0] != '#')
+            query.push_back(name);
+    }
+    fclose(file);
+    return 1;
+}
+
 void help(){
-    fprintf(stderr, "\nUsage:\n   ./bn-to-cnf -i <filename> [option] [...]\n\n");
+    fprintf(stderr, "\nUsage:\n   ./bn-to-cnf -i <filename> [option] [...]\n");
+    fprintf(stderr, "   ./bn-to-cnf --batch <manifest> [-j <jobs>] [--memory <MB>] [--report <filename>]\n\n");
     fprintf(stderr, "   Options:\n");
     fprintf(stderr, "      optimizations:\n");
     fprintf(stderr, "         -p: Partition cnf per CPT\n");
@@ -29,121 +106,489 @@ void help(){
     fprintf(stderr, "         -a: Apply boolean symplification\n");
     fprintf(stderr, "         -b: Boolean variables are not mapped\n");
     fprintf(stderr, "         -q: Quine-McCluskey (QM)\n");
-    fprintf(stderr, "         -l <limit>: Limit problem size for QM\n");
+    fprintf(stderr, "         -x: Context-specific independence, CPT rows are merged through a decision diagram\n");
+    fprintf(stderr, "         -l <limit>: Limit problem size for QM (at most 128 literals)\n");
+    fprintf(stderr, "         -j <threads>: Solve QM clause groups and format the CNF concurrently\n");
+    fprintf(stderr, "         -t <seconds>: Time budget of QM per group, a group over budget keeps its clauses\n");
+    fprintf(stderr, "                       or, once its primes are found, the best cover so far\n");
+    fprintf(stderr, "         -n <nodes>: Node budget of the minimal QM cover search per group\n");
+    fprintf(stderr, "         -k: Keep QM results in a cache next to the output (<output>.qmc)\n");
+    fprintf(stderr, "         -r <filename>: Relevance, only encode the ancestors of the query nodes\n");
+    fprintf(stderr, "                        (evidence, interventions, classifier inputs) listed in <filename>\n");
+    fprintf(stderr, "         --amo <encoding>: At most one value per variable, 'pairwise' (default), 'sequential',\n");
+    fprintf(stderr, "                           'commander' or 'product' (auxiliary variables, for more than 6 values)\n");
     fprintf(stderr, "      other:\n");
     fprintf(stderr, "         -i <filename>: Input (HUGIN .net file)\n");
+    fprintf(stderr, "         -m: Map the parsed network from a binary file next to the input (<input>.bnb),\n");
+    fprintf(stderr, "             written when it is missing or older than the input\n");
     fprintf(stderr, "         -w: Write CNF in DIMACS format to file\n");
     fprintf(stderr, "         -s: Show stats\n");
+    fprintf(stderr, "         -v: Verbose, print every QM clause group\n");
+    fprintf(stderr, "         --metrics <filename>: Write time and peak memory per phase and counters as JSON\n");
+    fprintf(stderr, "         --trace <filename>: Write the phases as a Chrome trace (chrome://tracing)\n");
     fprintf(stderr, "         -h: Help\n");
+    fprintf(stderr, "      batch:\n");
+    fprintf(stderr, "         --batch <manifest>: Encode every line '<input.net> [option] [...] <output.cnf>'\n");
+    fprintf(stderr, "                             of <manifest> in one process, the largest inputs first\n");
+    fprintf(stderr, "         -j <jobs>: Networks encoded concurrently (default: one per core)\n");
+    fprintf(stderr, "         --memory <MB>: Memory budget of the concurrent jobs, estimated from their input\n");
+    fprintf(stderr, "         --report <filename>: JSON report of the jobs (default: <manifest>.json)\n");
 }
 
-int main(int argc, char **argv){
-    cnf f;
-    int c;
-    char infile[100] = {0};
-    char outfile[100];
-    char savefile [1000];
-    char ext[20] = {0};
+// returns 0 when the options are valid, 2 when help is to be shown
+int parse_options(int argc, char **argv, options_t &o){
+    static const struct option long_options[] = {
+        {"batch",  required_argument, NULL, OPT_BATCH},
+        {"report", required_argument, NULL, OPT_REPORT},
+        {"memory", required_argument, NULL, OPT_MEMORY},
+        {"metrics", required_argument, NULL, OPT_METRICS},
+        {"trace",  required_argument, NULL, OPT_TRACE},
+        {"amo",    required_argument, NULL, OPT_AMO},
+        {NULL, 0, NULL, 0}
+    };
 
-    bool write = false, stats = false;
-    while ((c = getopt(argc, argv, "i:adecsw:bhpql:")) != -1){
+    int c;
+    unsigned long count = 0;
+    optind = 0; // getopt starts over for every line of a manifest
+    while ((c = getopt_long(argc, argv, "i:adecsw:bhpqxl:j:t:n:kr:mv", long_options, NULL)) != -1){
         switch (c){
             case 'p': // partitioned
-                f.set_optimization(cnf::opt_t::PARTITION);
+                o.optimizations.push_back(cnf::opt_t::PARTITION);
                 break;
             case 'd': // determinism
-                f.set_optimization(cnf::opt_t::DETERMINISTIC_PROBABILITIES);
+                o.optimizations.push_back(cnf::opt_t::DETERMINISTIC_PROBABILITIES);
                 break;
             case 'e': // equal probabilities recoginized
-                f.set_optimization(cnf::opt_t::EQUAL_PROBABILITIES);
+                o.optimizations.push_back(cnf::opt_t::EQUAL_PROBABILITIES);
                 break;
             case 'c': // constraint clauses are suppressed
-                f.set_optimization(cnf::opt_t::SUPPRESS_CONSTRAINTS);
+                o.optimizations.push_back(cnf::opt_t::SUPPRESS_CONSTRAINTS);
                 break;
             case 'b': // bool variables are not mapped
-                f.set_optimization(cnf::opt_t::BOOL);
+                o.optimizations.push_back(cnf::opt_t::BOOL);
                 break;
             case 'a': // symplify cnf using identity property
-                f.set_optimization(cnf::opt_t::SYMPLIFY);
+                o.optimizations.push_back(cnf::opt_t::SYMPLIFY);
                 break;
             case 'q': // bool variables are not mapped
-                f.set_optimization(cnf::opt_t::QUINE_MCCLUSKEY);
+                o.optimizations.push_back(cnf::opt_t::QUINE_MCCLUSKEY);
+                break;
+            case 'x': // CPT rows equal for all values of a variable are merged
+                o.optimizations.push_back(cnf::opt_t::CSI);
                 break;
             case 'l': // bool variables are not mapped
                 if(isnumber(optarg))
-                    f.set_qm_limit(atoi(optarg));
+                    o.qm_limit = atoi(optarg);
                 else {
                     fprintf(stderr, "Argument to option -l (%s) is not a number\n", optarg);
                     return 1;
                 }
                 break;
+            case 'j': // clause groups are solved concurrently, or the jobs of a batch
+                if(iscount(optarg, count) && count <= UINT_MAX)
+                    o.threads = count;
+                else {
+                    fprintf(stderr, "Argument to option -j (%s) is not a positive integer\n", optarg);
+                    return 1;
+                }
+                break;
+            case 't': // a group over the budget keeps its clauses or the best cover so far
+                if(isnumber(optarg) && atof(optarg) > 0)
+                    o.budget_seconds = atof(optarg);
+                else {
+                    fprintf(stderr, "Argument to option -t (%s) is not a positive number\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'n':
+                if(iscount(optarg, count))
+                    o.budget_nodes = count;
+                else {
+                    fprintf(stderr, "Argument to option -n (%s) is not a positive integer\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'k': // QM results are reused across runs
+                o.cache = true;
+                break;
+            case 'r': // nodes that are not ancestors of the query are dropped
+                if(!read_query(optarg, o.query) || o.query.empty()){
+                    fprintf(stderr, "Could not read query nodes from '%s'\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'm': // the parsed network is reused across runs
+                o.binary = true;
+                break;
             case 'w':
-                write = true;
-                strcpy(savefile,optarg);
+                o.write = true;
+                o.savefile = optarg;
                 break;
             case 's':
-                stats = true;
+                o.stats = true;
+                break;
+            case 'v': // every QM clause group is printed
+                o.verbosity++;
                 break;
             case 'i': // provide input
-                strcpy(infile,optarg);
-                strcpy(ext, get_filename_ext(infile));
-                strcpy(outfile,infile);
-                remove_ext(outfile);
-                if(strcmp(ext, "net") != 0){
+                o.infile = optarg;
+                o.outfile = optarg;
+                remove_ext(&o.outfile[0]);
+                o.outfile.resize(strlen(o.outfile.c_str()));
+                if(strcmp(get_filename_ext(optarg), "net") != 0){
                     fprintf(stderr, "Unknown file extension, a '*.net' HUGIN file is required\n");
                     return 1;
                 }
                 break;
+            case OPT_BATCH: // many networks in one process
+                o.batch = optarg;
+                break;
+            case OPT_REPORT:
+                o.report = optarg;
+                break;
+            case OPT_MEMORY:
+                if(iscount(optarg, count))
+                    o.memory = count;
+                else {
+                    fprintf(stderr, "Argument to option --memory (%s) is not a positive integer\n", optarg);
+                    return 1;
+                }
+                break;
+            case OPT_METRICS:
+                o.metrics = optarg;
+                break;
+            case OPT_TRACE:
+                o.trace = optarg;
+                break;
+            case OPT_AMO:
+                if(!amo::parse(optarg, o.amo)){
+                    fprintf(stderr, "Unknown at-most-one encoding '%s', 'pairwise', 'sequential', 'commander' or 'product' is required\n", optarg);
+                    return 1;
+                }
+                break;
             case '?':
-                help();
-                return 1;
+                return 2;
             default:
-                help();
-                return 1;
+                return 2;
         }
     }
     for (int index = optind; index < argc; index++)
         printf ("Non-option argument %s\n", argv[index]);
 
-    if(infile[0] == 0){
-        help();
-        fprintf(stderr, "Specify input file with -i <filename>\n");
+    // a partition only maps the literals and weights of its clauses
+    if(o.amo != amo::PAIRWISE &&
+       std::find(o.optimizations.begin(), o.optimizations.end(), cnf::opt_t::PARTITION) != o.optimizations.end()){
+        fprintf(stderr, "Option --amo %s cannot be combined with -p\n", amo::name(o.amo));
         return 1;
     }
+    return 0;
+}
 
-    parser<hugin> net;
-    net.process(infile);
-    /*
-    try {
-        net.process(infile);
-    } catch(parser_exception &e){
-        fprintf(stderr, "Failed to parse %s (%s)\n", infile, e.what());
-        return 1;
+// encodes one network, f and net are left for the next network to reuse
+int encode(cnf &f, parser<hugin> &net, const options_t &o){
+    f.clear();
+    for(auto it = o.optimizations.begin(); it != o.optimizations.end(); it++)
+        f.set_optimization(*it);
+    f.set_qm_limit(o.qm_limit);
+    f.set_amo(o.amo);
+    f.set_threads(o.threads);
+    f.set_verbosity(o.verbosity);
+    f.set_qm_budget(o.budget_nodes, o.budget_seconds);
+
+    if(o.cache){
+        // next to the CNF write_with_location() writes
+        std::string name = (o.write ? o.savefile : o.outfile);
+        if(o.write && name.find_last_of(".") != std::string::npos)
+            name = name.substr(0, name.find_last_of("."));
+        f.set_qm_cache((name + ".qmc").c_str());
     }
-*/
 
-    f.set_filename(outfile);
+    f.set_filename(o.outfile.c_str());
     bayesnet *bn = NULL;
-    try {
-        bn = net.get_bayesnet();
-        if(bn == NULL)
+
+    // a binary network of the same .net file and query skips the parser
+    std::string binary_file = o.outfile + ".bnb";
+    uint64_t stamp = 0;
+    if(o.binary){
+        metrics::phase phase("map");
+        stamp = bayesnet::stamp(o.infile.c_str(), o.query);
+        bn = bayesnet::map(binary_file.c_str(), stamp);
+        if(bn)
+            bn->set_filename(o.infile.c_str());
+    }
+
+    if(!bn){
+        if(access(o.infile.c_str(), R_OK) != 0){
+            fprintf(stderr, "Could not read '%s'\n", o.infile.c_str());
+            return 1;
+        }
+        net.query = o.query;
+        metrics::phase parse("parse");
+        net.process(o.infile);
+        parse.end();
+        /*
+        try {
+            net.process(o.infile);
+        } catch(parser_exception &e){
+            fprintf(stderr, "Failed to parse %s (%s)\n", o.infile.c_str(), e.what());
+            return 1;
+        }
+    */
+
+        try {
+            metrics::phase phase("network");
+            bn = net.get_bayesnet();
+            if(bn == NULL)
+                fprintf(stderr, "FAILED\n");
+        } catch(throw_string_error &e){
+            fprintf(stderr, "error: %s\n", e.what());
             fprintf(stderr, "FAILED\n");
-    } catch(throw_string_error &e){
-        fprintf(stderr, "error: %s\n", e.what());
-        fprintf(stderr, "FAILED\n");
-        return -1;
+            return -1;
+        }
+
+        if(o.binary && bn){
+            metrics::phase phase("save");
+            if(!bn->save(binary_file.c_str(), stamp))
+                fprintf(stderr, "Could not write binary network '%s'\n", binary_file.c_str());
+        }
     }
+    if(bn && !o.query.empty())
+        printf("Relevant subnetwork: %u nodes\n", bn->get_nr_variables());
 
-    f.encode(bn);
-    if(write)
+    metrics::phase phase("encode");
+    if(f.encode(bn) < 0){
+        delete bn;
+        return 1;
+    }
+    phase.end();
+    int status = 0;
+    if(o.write)
         //f.write();
-        f.write_with_location(savefile);
+        status = f.write_with_location(o.savefile.c_str());
 
-    if(stats)
+    if(o.stats)
         f.stats();
 
     // f.print();
     delete bn;
 
+    return status;
+}
+
+// one job per line, '<input.net> [option] [...] <output.cnf>', blank lines
+// and lines starting with '#' are skipped
+int read_manifest(const char *filename, std::vector<job_t> &jobs){
+    FILE *file = fopen(filename, "r");
+    if(file == NULL){
+        fprintf(stderr, "Could not read manifest '%s'\n", filename);
+        return 1;
+    }
+    char line[4096];
+    for(unsigned int n = 1; fgets(line, sizeof(line), file); n++){
+        std::vector<std::string> words;
+        for(char *word = strtok(line, " \t\r\n"); word; word = strtok(NULL, " \t\r\n"))
+            words.push_back(word);
+        if(words.empty() || words[0][0] == '#')
+            continue;
+        if(words.size() < 2){
+            fprintf(stderr, "%s:%u: an input and an output are required\n", filename, n);
+            fclose(file);
+            return 1;
+        }
+
+        // parsed as the command line of a single network
+        std::string program = std::string(filename) + ":" + std::to_string(n);
+        std::vector<std::string> args = {program, "-i", words.front()};
+        args.insert(args.end(), words.begin()+1, words.end()-1);
+        args.push_back("-w");
+        args.push_back(words.back());
+        std::vector<char*> argv;
+        for(auto it = args.begin(); it != args.end(); it++)
+            argv.push_back(&(*it)[0]);
+        argv.push_back(NULL);
+
+        job_t job;
+        job.line = n;
+        job.status = -1;
+        job.seconds = 0;
+        job.variables = job.literals = job.weights = job.clauses = 0;
+        const options_t &options = job.options;
+        if(parse_options(argv.size()-1, argv.data(), job.options) != 0 || !options.batch.empty() ||
+           !options.metrics.empty() || !options.trace.empty()){
+            fprintf(stderr, "%s:%u: invalid options\n", filename, n);
+            fclose(file);
+            return 1;
+        }
+        struct stat st;
+        job.size = stat(job.options.infile.c_str(), &st) == 0 ? st.st_size : 0;
+        jobs.push_back(job);
+    }
+    fclose(file);
     return 0;
 }
+
+int write_report(const char *filename, const std::vector<job_t> &jobs, double seconds){
+    FILE *file = fopen(filename, "w");
+    if(file == NULL)
+        return 1;
+    unsigned int failed = 0;
+    fprintf(file, "{\n  \"jobs\": [\n");
+    for(size_t i = 0; i < jobs.size(); i++){
+        const job_t &job = jobs[i];
+        failed += job.status != 0;
+        fprintf(file, "    {\"line\": %u, \"input\": ", job.line);
+        write_json_string(file, job.options.infile);
+        fprintf(file, ", \"output\": ");
+        write_json_string(file, job.options.savefile);
+        fprintf(file, ", \"status\": %d, \"seconds\": %.3f, \"variables\": %u, \"literals\": %u, \"weights\": %u, \"clauses\": %u}%s\n",
+            job.status, job.seconds, job.variables, job.literals, job.weights, job.clauses, i+1 < jobs.size() ? "," : "");
+    }
+    fprintf(file, "  ],\n  \"failed\": %u,\n  \"seconds\": %.3f\n}\n", failed, seconds);
+    fclose(file);
+    return 0;
+}
+
+// Runs the jobs of a manifest on a pool of workers. Jobs start largest input
+// first, a job starts when a worker is free and its estimate fits the memory
+// budget next to the running jobs, or when no job runs at all. Every worker
+// keeps its cnf and parser across jobs.
+int batch(const options_t &o){
+    std::vector<job_t> jobs;
+    if(read_manifest(o.batch.c_str(), jobs) != 0)
+        return 1;
+
+    unsigned int workers = o.threads ? o.threads : std::thread::hardware_concurrency();
+    if(workers == 0)
+        workers = 1;
+    uint64_t budget = (uint64_t) o.memory << 20;
+
+    std::vector<job_t*> pending;
+    for(auto it = jobs.begin(); it != jobs.end(); it++)
+        pending.push_back(&*it);
+    std::stable_sort(pending.begin(), pending.end(), [](const job_t *a, const job_t *b){
+        return a->size > b->size;
+    });
+
+    pthread_mutex_t mutex;
+    pthread_cond_t done;
+    pthread_mutex_init(&mutex, NULL);
+    pthread_cond_init(&done, NULL);
+    unsigned int running = 0;
+    uint64_t reserved = 0;
+
+    // the dispatching thread does not run jobs, it only waits for them
+    uint64_t start = threadpool::now();
+    threadpool pool(workers+1);
+    threadpool::batch b;
+    pthread_mutex_lock(&mutex);
+    while(!pending.empty()){
+        auto it = pending.end();
+        if(running < workers){
+            it = pending.begin();
+            while(it != pending.end() && budget && reserved + (*it)->size*BATCH_MEMORY_FACTOR > budget)
+                it++;
+            if(it == pending.end() && running == 0)
+                it = pending.begin();
+        }
+        if(it == pending.end()){
+            pthread_cond_wait(&done, &mutex);
+            continue;
+        }
+
+        job_t *job = *it;
+        pending.erase(it);
+        uint64_t estimate = job->size*BATCH_MEMORY_FACTOR;
+        running++;
+        reserved += estimate;
+        pool.submit(b, [job, estimate, &mutex, &done, &running, &reserved](){
+            static thread_local cnf f;
+            static thread_local parser<hugin> net;
+
+            // QM and the writer of a job are single threaded unless it asks for more
+            options_t options = job->options;
+            if(options.threads == 0)
+                options.threads = 1;
+
+            uint64_t begin = threadpool::now();
+            try {
+                job->status = encode(f, net, options);
+            } catch(std::exception &e){
+                fprintf(stderr, "%s: %s\n", job->options.infile.c_str(), e.what());
+                job->status = 1;
+            }
+            job->seconds = (threadpool::now() - begin)/1e9;
+            metrics::sample_rss(job->options.savefile.c_str());
+            if(job->status == 0){
+                job->variables = f.get_nr_variables();
+                job->literals = f.get_nr_literals();
+                job->weights = f.get_nr_weights();
+                job->clauses = f.get_expression()->get_nr_clauses();
+            }
+
+            pthread_mutex_lock(&mutex);
+            running--;
+            reserved -= estimate;
+            pthread_cond_signal(&done);
+            pthread_mutex_unlock(&mutex);
+        });
+    }
+    pthread_mutex_unlock(&mutex);
+    pool.wait(b);
+    double seconds = (threadpool::now() - start)/1e9;
+
+    pthread_cond_destroy(&done);
+    pthread_mutex_destroy(&mutex);
+
+    std::string report = o.report;
+    if(report.empty()){
+        report = o.batch;
+        remove_ext(&report[0]);
+        report.resize(strlen(report.c_str()));
+        report += ".json";
+    }
+    if(write_report(report.c_str(), jobs, seconds) != 0){
+        fprintf(stderr, "Could not write report '%s'\n", report.c_str());
+        return 1;
+    }
+
+    unsigned int failed = 0;
+    for(auto it = jobs.begin(); it != jobs.end(); it++)
+        failed += it->status != 0;
+    printf("Batch of %lu networks in %.3f seconds, %u failed, report written to: %s\n",
+        (unsigned long) jobs.size(), seconds, failed, report.c_str());
+    return failed ? 1 : 0;
+}
+
+int main(int argc, char **argv){
+    options_t o;
+    int status = parse_options(argc, argv, o);
+    if(status == 2)
+        help();
+    if(status != 0)
+        return 1;
+    if(!o.metrics.empty() || !o.trace.empty())
+        metrics::enable("bn-to-cnf", o.metrics, o.trace);
+
+    if(!o.batch.empty()){
+        if(!o.infile.empty() || o.write || o.stats || o.cache || o.binary || !o.query.empty() || o.verbosity ||
+           !o.optimizations.empty() || o.qm_limit != -1 || o.budget_nodes || o.budget_seconds > 0){
+            fprintf(stderr, "The options of a network go into the manifest of --batch\n");
+            return 1;
+        }
+        status = batch(o);
+        return metrics::write() != 0 ? 1 : status;
+    }
+
+    if(o.infile.empty()){
+        help();
+        fprintf(stderr, "Specify input file with -i <filename>\n");
+        return 1;
+    }
+
+    cnf f;
+    parser<hugin> net;
+    status = encode(f, net, o);
+    if(metrics::write() != 0 && status == 0)
+        status = 1;
+    return status;
+}
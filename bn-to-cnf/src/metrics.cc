@@ -0,0 +1,243 @@
+#include "metrics.h"
+#include <stdio.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/resource.h>
+#include <atomic>
+#include <map>
+#include <vector>
+
+using namespace std;
+
+namespace metrics {
+
+struct event_t {
+    const char *name;
+    uint64_t start;                 // nanoseconds since enable()
+    uint64_t duration;
+    long rss;                       // peak at the end, in KB
+    unsigned int thread;
+};
+
+struct sample_t {
+    string name;
+    uint64_t start;
+    long rss;
+    unsigned int thread;
+};
+
+struct phase_t {
+    uint64_t calls;
+    uint64_t nanoseconds;
+    long rss;
+};
+
+struct state_t {
+    state_t() : enabled(false), origin(0), threads(0) {
+        pthread_mutex_init(&mutex, NULL);
+    }
+    std::atomic<bool> enabled;
+    pthread_mutex_t mutex;
+    string tool, json, trace;
+    uint64_t origin;
+    std::atomic<unsigned int> threads;
+    vector<string> order;           // of the phases, by first start
+    map<string,phase_t> phases;
+    vector<event_t> events;         // kept for the trace only
+    map<string,int64_t> counters;
+    map<string,double> values;
+    vector<sample_t> samples;
+};
+
+static state_t& state(){
+    static state_t s;
+    return s;
+}
+
+static uint64_t now(){
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t) t.tv_sec*1000000000ull + t.tv_nsec;
+}
+
+static long peak_rss(){
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+static unsigned int thread_id(){
+    static thread_local unsigned int id = state().threads++;
+    return id;
+}
+
+void enable(const char *tool, const string &json, const string &trace){
+    state_t &s = state();
+    pthread_mutex_lock(&s.mutex);
+    s.tool = tool;
+    s.json = json;
+    s.trace = trace;
+    s.origin = now();
+    s.enabled = true;
+    pthread_mutex_unlock(&s.mutex);
+}
+
+bool enabled(){
+    return state().enabled;
+}
+
+void count(const char *name, int64_t n){
+    state_t &s = state();
+    if(!s.enabled)
+        return;
+    pthread_mutex_lock(&s.mutex);
+    s.counters[name] += n;
+    pthread_mutex_unlock(&s.mutex);
+}
+
+void set(const char *name, double value){
+    state_t &s = state();
+    if(!s.enabled)
+        return;
+    pthread_mutex_lock(&s.mutex);
+    s.values[name] = value;
+    pthread_mutex_unlock(&s.mutex);
+}
+
+void sample_rss(const char *name){
+    state_t &s = state();
+    if(!s.enabled)
+        return;
+    sample_t sample = { name, now() - s.origin, peak_rss(), thread_id() };
+    pthread_mutex_lock(&s.mutex);
+    s.samples.push_back(sample);
+    pthread_mutex_unlock(&s.mutex);
+}
+
+phase::phase(const char *name) : name(name), start(0) {
+    if(state().enabled)
+        start = now();
+}
+
+phase::~phase(){
+    end();
+}
+
+void phase::end(){
+    state_t &s = state();
+    if(start == 0 || !s.enabled)
+        return;
+    uint64_t duration = now() - start;
+    event_t e = { name, start - s.origin, duration, peak_rss(), thread_id() };
+    start = 0;
+
+    pthread_mutex_lock(&s.mutex);
+    auto it = s.phases.find(name);
+    if(it == s.phases.end()){
+        s.order.push_back(name);
+        it = s.phases.insert(make_pair(string(name), phase_t())).first;
+    }
+    it->second.calls++;
+    it->second.nanoseconds += duration;
+    if(e.rss > it->second.rss)
+        it->second.rss = e.rss;
+    if(!s.trace.empty())
+        s.events.push_back(e);
+    pthread_mutex_unlock(&s.mutex);
+}
+
+// names are identifiers of the code, only quotes and backslashes are escaped
+static void write_string(FILE *file, const string &str){
+    fputc('"', file);
+    for(size_t i = 0; i < str.size(); i++){
+        if(str[i] == '"' || str[i] == '\\')
+            fputc('\\', file);
+        fputc(str[i], file);
+    }
+    fputc('"', file);
+}
+
+static int write_json(state_t &s, uint64_t end){
+    FILE *file = fopen(s.json.c_str(), "w");
+    if(file == NULL)
+        return 1;
+    fprintf(file, "{\n  \"tool\": ");
+    write_string(file, s.tool);
+    fprintf(file, ",\n  \"seconds\": %.6f,\n  \"peak_rss_kb\": %ld,\n  \"phases\": [\n", (end - s.origin)/1e9, peak_rss());
+    for(size_t i = 0; i < s.order.size(); i++){
+        const phase_t &p = s.phases[s.order[i]];
+        fprintf(file, "    {\"name\": ");
+        write_string(file, s.order[i]);
+        fprintf(file, ", \"calls\": %lu, \"seconds\": %.6f, \"peak_rss_kb\": %ld}%s\n",
+            (unsigned long) p.calls, p.nanoseconds/1e9, p.rss, i+1 < s.order.size() ? "," : "");
+    }
+    fprintf(file, "  ],\n  \"counters\": {");
+    for(auto it = s.counters.begin(); it != s.counters.end(); it++){
+        fprintf(file, "%s\n    ", it == s.counters.begin() ? "" : ",");
+        write_string(file, it->first);
+        fprintf(file, ": %lld", (long long) it->second);
+    }
+    fprintf(file, "%s},\n  \"values\": {", s.counters.empty() ? "" : "\n  ");
+    for(auto it = s.values.begin(); it != s.values.end(); it++){
+        fprintf(file, "%s\n    ", it == s.values.begin() ? "" : ",");
+        write_string(file, it->first);
+        fprintf(file, ": %.17g", it->second);
+    }
+    fprintf(file, "%s},\n  \"rss\": [", s.values.empty() ? "" : "\n  ");
+    for(size_t i = 0; i < s.samples.size(); i++){
+        fprintf(file, "%s\n    {\"name\": ", i ? "," : "");
+        write_string(file, s.samples[i].name);
+        fprintf(file, ", \"seconds\": %.6f, \"peak_rss_kb\": %ld}", s.samples[i].start/1e9, s.samples[i].rss);
+    }
+    fprintf(file, "%s]\n}\n", s.samples.empty() ? "" : "\n  ");
+    fclose(file);
+    return 0;
+}
+
+// complete events per phase, the peak RSS as a counter track
+static int write_trace(state_t &s){
+    FILE *file = fopen(s.trace.c_str(), "w");
+    if(file == NULL)
+        return 1;
+    fprintf(file, "{\"traceEvents\": [\n");
+    fprintf(file, "  {\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": 0, \"args\": {\"name\": ");
+    write_string(file, s.tool);
+    fprintf(file, "}}");
+    for(size_t i = 0; i < s.events.size(); i++){
+        const event_t &e = s.events[i];
+        fprintf(file, ",\n  {\"name\": ");
+        write_string(file, e.name);
+        fprintf(file, ", \"ph\": \"X\", \"pid\": 1, \"tid\": %u, \"ts\": %.3f, \"dur\": %.3f}", e.thread, e.start/1e3, e.duration/1e3);
+        fprintf(file, ",\n  {\"name\": \"peak RSS (KB)\", \"ph\": \"C\", \"pid\": 1, \"ts\": %.3f, \"args\": {\"rss\": %ld}}", (e.start+e.duration)/1e3, e.rss);
+    }
+    for(size_t i = 0; i < s.samples.size(); i++){
+        const sample_t &e = s.samples[i];
+        fprintf(file, ",\n  {\"name\": ");
+        write_string(file, e.name);
+        fprintf(file, ", \"ph\": \"i\", \"s\": \"p\", \"pid\": 1, \"tid\": %u, \"ts\": %.3f}", e.thread, e.start/1e3);
+    }
+    fprintf(file, "\n]}\n");
+    fclose(file);
+    return 0;
+}
+
+int write(){
+    state_t &s = state();
+    if(!s.enabled)
+        return 0;
+    uint64_t end = now();
+    pthread_mutex_lock(&s.mutex);
+    int status = 0;
+    if(!s.json.empty() && write_json(s, end) != 0){
+        fprintf(stderr, "Could not write metrics to: %s\n", s.json.c_str());
+        status = 1;
+    }
+    if(!s.trace.empty() && write_trace(s) != 0){
+        fprintf(stderr, "Could not write trace to: %s\n", s.trace.c_str());
+        status = 1;
+    }
+    pthread_mutex_unlock(&s.mutex);
+    return status;
+}
+
+}
@@ -20,3 +20,15 @@ void remove_ext(const char *filename){
         s[0] = '\0';
 }
 
+
+void write_json_string(FILE *file, const std::string &s){
+    fputc('"', file);
+    for(auto it = s.begin(); it != s.end(); it++){
+        if(*it == '"' || *it == '\\')
+            fprintf(file, "\\%c", *it);
+        else if((unsigned char) *it < 0x20)
+            fprintf(file, "\\u%04x", (unsigned char) *it);
+        else fputc(*it, file);
+    }
+    fputc('"', file);
+}
@@ -2,6 +2,7 @@
 #include <algorithm>
 #include <alloca.h>
 #include <array>
+#include <atomic>
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
@@ -13,7 +14,6 @@
 #include <iterator>
 #include "cover.h"
 #include <set>
-#include "jobqueue.h"
 #include <unistd.h>
 using namespace std;
 
@@ -108,7 +108,13 @@ static inline uint32_t roundup2(uint32_t x){
 
 template <typename M>
 qm<M>::qm(){
-
+    pool = NULL;
+    merge = MERGE_HASH;
+    max_nodes = 0;
+    max_seconds = 0;
+    deadline = 0;
+    expired = false;
+    interrupted = false;
 }
 
 template <typename M>
@@ -122,9 +128,50 @@ void qm<M>::clear(){
     models.clear();
 }
 
+template <typename M>
+void qm<M>::set_pool(threadpool *pool){
+    this->pool = pool;
+}
+
+template <typename M>
+void qm<M>::set_merge(merge_t merge){
+    this->merge = merge;
+}
+
+// The time budget starts here and covers adding the models, the merge and
+// the cover search: solve() gives up without primes when it runs out before
+// the primes are found, the cover search returns the best cover found so far.
+// The node budget only limits the cover search.
+template <typename M>
+void qm<M>::set_budget(uint64_t nodes, double seconds){
+    max_nodes = nodes;
+    max_seconds = seconds;
+    deadline = (seconds > 0 ? threadpool::now() + (uint64_t) (seconds*1e9) : 0);
+    expired = false;
+}
+
+template <typename M>
+bool qm<M>::interrupted_search() const {
+    return interrupted;
+}
+
+template <typename M>
+bool qm<M>::out_of_time() const {
+    return expired;
+}
+
+template <typename M>
+const std::vector<float>& qm<M>::get_utilization() const {
+    return utilization;
+}
+
 template <typename M>
 int qm<M>::solve(){
     primes.resize(0);
+    utilization.clear();
+    interrupted = false;
+    if(past_deadline())
+        return -1;
     if(models.size() == 0)
         return 0;
     //else if(models.size() == pow2(variables.size()))
@@ -132,7 +179,7 @@ int qm<M>::solve(){
     else if(models.size() == 1){
         primes.resize(1);
         primes[0][0] = *(models.begin());
-        primes[0][1] = 0;
+        primes[0][1].clear_all();
         return 2;
     } else if(canonical_primes())
         return 2;
@@ -168,39 +215,55 @@ void qm<M>::cpy_primes(std::vector< cube<P> > &primes){
 }
 
 template <typename M>
-int qm<M>::canonical_primes(){
+int qm<M>::canonical_primes(bool minimal){
     int PRIMES;
 
     unsigned int VARIABLES = variables.size();
     if(VARIABLES <= 8){
         cube_size = 8;
         vector< cube<uint8_t> > primes;
-        PRIMES = compute_primes<uint8_t>(primes);
+        PRIMES = compute_primes<uint8_t>(primes, minimal);
         cpy_primes(primes);
     } else if(VARIABLES <= 16){
         cube_size = 16;
         vector< cube<uint16_t> > primes;
-        PRIMES = compute_primes<uint16_t>(primes);
+        PRIMES = compute_primes<uint16_t>(primes, minimal);
         cpy_primes(primes);
     } else if(VARIABLES <= 32){
         cube_size = 32;
         vector< cube<uint32_t> > primes;
-        PRIMES = compute_primes<uint32_t>(primes);
+        PRIMES = compute_primes<uint32_t>(primes, minimal);
         cpy_primes(primes);
     } else if(VARIABLES <= 64){
         cube_size = 64;
         vector< cube<uint64_t> > primes;
-        PRIMES = compute_primes<uint64_t>(primes);
+        PRIMES = compute_primes<uint64_t>(primes, minimal);
         cpy_primes(primes);
     }
     #if __LP64__
     else if(VARIABLES <= 128){
         cube_size = 128;
         vector< cube<uint128_t> > primes;
-        PRIMES = compute_primes<uint128_t>(primes);
+        PRIMES = compute_primes<uint128_t>(primes, minimal);
         cpy_primes(primes);
     }
     #endif
+    else if(VARIABLES <= 256){
+        // only qm on wide models is instantiated for wide cubes
+        if constexpr (sizeof(M) >= sizeof(uint256_t)){
+            cube_size = 256;
+            vector< cube<uint256_t> > primes;
+            PRIMES = compute_primes<uint256_t>(primes, minimal);
+            cpy_primes(primes);
+        } else return -1;
+    } else if(VARIABLES <= 512){
+        if constexpr (sizeof(M) >= sizeof(uint512_t)){
+            cube_size = 512;
+            vector< cube<uint512_t> > primes;
+            PRIMES = compute_primes<uint512_t>(primes, minimal);
+            cpy_primes(primes);
+        } else return -1;
+    }
     else return -1;
 
     return PRIMES;
@@ -208,9 +271,13 @@ int qm<M>::canonical_primes(){
 
 template <typename M>
 template <typename T>
-int qm<M>::compute_primes(std::vector< cube<T> >& primes){
+int qm<M>::compute_primes(std::vector< cube<T> >& primes, bool minimal){
     unsigned int PRIMES = quine_mccluskey<T>(primes);
-    if(PRIMES > 0){
+    if(past_deadline()){
+        primes.clear();
+        return 0;
+    }
+    if(PRIMES > 0 && minimal){
         unsigned int MODELS = models.size();
         if(MODELS <= 8){
             return reduce<T,uint8_t>(primes);
@@ -279,107 +346,543 @@ void qm<M>::print(bool characters){
 }
 
 template <typename T>
-struct thread_data_t {
-    vector< set< cube<T> > > cset;
+struct merge_data_t {
+    vector< vector< cube<T> > > cset;
     vector< set< cube<T> > > nset;
     vector< vector<uint8_t> > check;
-    jobqueue<int> q;
-    thread_data_t(unsigned int N){
+    merge_data_t(unsigned int N){
         cset.resize(N);
         nset.resize(N);
         check.resize(N);
     };
 };
 
+// result of merging cset[group][begin,end) with all of cset[group+1]
 template <typename T>
-void* thread_function(void *d){
-
-    thread_data_t<T> *data = (thread_data_t<T>*) d;
-    int group = data->q.get();
-    while(group >= 0){
-        //printf("    group %u\n",group);
-        unsigned int i = 0;
-        for(auto cit = data->cset[group].begin(); cit != data->cset[group].end(); cit++, i++){
-            unsigned int j = 0;
-            for(auto nit = data->cset[group+1].begin(); nit != data->cset[group+1].end(); nit++, j++){
-                cube<T> cc = *cit;
-                cube<T> nc = *nit;
-
-                T p = cc[0].value ^ nc[0].value;
-                if(cc[1] == nc[1] && is_power_of_two_or_zero(p)){
-                    // merge
-                    cube<T> c;
-                    c[0].value = cc[0].value & nc[0].value;
-                    c[1] = cc[1].value | p;
-
-                    data->check[group][i] = 1;
-                    data->check[group+1][j] = 1;
-
-                    data->nset[group].insert(c);
-                }
+struct merge_task_t {
+    unsigned int group;
+    unsigned int begin;
+    unsigned int end;
+    vector< cube<T> > merged;
+    vector<unsigned int> upper;    // indices into cset[group+1] that were merged
+};
+
+template <typename T>
+static void merge_range(merge_data_t<T> &data, merge_task_t<T> &task, uint64_t deadline){
+    vector< cube<T> > &lower = data.cset[task.group];
+    vector< cube<T> > &upper = data.cset[task.group+1];
+    vector<uint8_t> &check = data.check[task.group];
+    for(unsigned int i = task.begin; i < task.end; i++){
+        if(deadline && (i-task.begin) % 256 == 0 && threadpool::now() >= deadline)
+            return;
+        cube<T> &cc = lower[i];
+        for(unsigned int j = 0; j < upper.size(); j++){
+            cube<T> &nc = upper[j];
+
+            T p = cc[0].value ^ nc[0].value;
+            if(cc[1] == nc[1] && is_power_of_two_or_zero(p)){
+                // merge
+                cube<T> c;
+                c[0].value = cc[0].value & nc[0].value;
+                c[1] = cc[1].value | p;
+
+                check[i] = 1;
+                task.upper.push_back(j);
+                task.merged.push_back(c);
             }
         }
-        group = data->q.get();
     }
+}
+
+template <typename T>
+static inline uint64_t hash_value(T x){
+    uint64_t h = (uint64_t) x;
+    if constexpr (sizeof(T) > sizeof(uint64_t))
+        h ^= (uint64_t) (x >> 64) * 0x9E3779B97F4A7C15ull;
+    return h;
+}
+
+template <unsigned int BITS>
+static inline uint64_t hash_value(const wide<BITS> &x){
+    uint64_t h = 0;
+    for(unsigned int i = 0; i < wide<BITS>::WORDS; i++)
+        h = (h ^ x.w[i]) * 0x9E3779B97F4A7C15ull;
+    return h;
+}
+
+// Open addressing table of cubes without duplicates. Slots hold an index
+// into the flat array of entries, which keeps the insertion order.
+template <typename T>
+class cube_table {
+    public:
+        void reset(size_t n){
+            size_t size = 16;
+            while(size < 2*n)
+                size <<= 1;
+            slots.assign(size, 0);
+            MASK = size-1;
+            entries.clear();
+            entries.reserve(n);
+        };
+
+        // index of the cube in the entries, or -1 if absent
+        long find(cube<T> &c){
+            for(size_t s = slot(c); slots[s]; s = (s+1) & MASK){
+                cube<T> &e = entries[slots[s]-1];
+                if(e[0] == c[0] && e[1] == c[1])
+                    return slots[s]-1;
+            }
+            return -1;
+        };
+
+        bool insert(cube<T> &c){
+            if(2*(entries.size()+1) > slots.size())
+                grow();
+            size_t s = slot(c);
+            for(; slots[s]; s = (s+1) & MASK){
+                cube<T> &e = entries[slots[s]-1];
+                if(e[0] == c[0] && e[1] == c[1])
+                    return false;
+            }
+            entries.push_back(c);
+            slots[s] = entries.size();
+            return true;
+        };
+
+        std::vector< cube<T> > entries;
+    private:
+        size_t slot(cube<T> &c){
+            uint64_t h = hash_value(c[0].value) ^ (hash_value(c[1].value) * 0xC2B2AE3D27D4EB4Full);
+            h ^= h >> 29;
+            h *= 0xBF58476D1CE4E5B9ull;
+            h ^= h >> 32;
+            return h & MASK;
+        };
+
+        void grow(){
+            std::vector< cube<T> > old;
+            old.swap(entries);
+            reset(2*old.size()+1);
+            for(unsigned int i = 0; i < old.size(); i++)
+                insert(old[i]);
+        };
+
+        std::vector<uint32_t> slots;           // entry index + 1, zero when empty
+        size_t MASK;
+};
+
+template <typename T>
+static inline bool mask_order(cube<T> &a, cube<T> &b){
+    if(a[1] != b[1])
+        return a[1] < b[1];
+    return a[0] < b[0];
+}
+
+// primes of a round are listed by bitcount group, as the pairwise merge does
+template <typename T>
+static inline bool group_order(cube<T> &a, cube<T> &b){
+    unsigned int ga = bitcount(a[0].value), gb = bitcount(b[0].value);
+    if(ga != gb)
+        return ga < gb;
+    return a < b;
+}
 
-    return NULL;
+// Looks up the partners of cubes [begin,end). All cubes of a round have the
+// same number of don't cares, so a partner has the same mask and differs in
+// exactly one of the remaining bits. A cube merges with the partner above it,
+// the partner below it only marks it as merged.
+template <typename T>
+static void merge_lookup(cube_table<T> &table, vector<uint8_t> &check, const T FULL, unsigned int begin, unsigned int end, vector< cube<T> > &merged, uint64_t deadline){
+    vector< cube<T> > &cubes = table.entries;
+    for(unsigned int i = begin; i < end; i++){
+        if(deadline && (i-begin) % 4096 == 0 && threadpool::now() >= deadline)
+            return;
+        cube<T> c = cubes[i];
+        T free = FULL & ~c[1].value;
+        while(free){
+            T bit = free & (~free + 1);
+            free ^= bit;
+
+            cube<T> partner = c;
+            partner[0].value = c[0].value ^ bit;
+            if(table.find(partner) < 0)
+                continue;
+
+            check[i] = 1;
+            if(!(c[0].value & bit)){
+                cube<T> m;
+                m[0] = c[0].value;
+                m[1] = c[1].value | bit;
+                merged.push_back(m);
+            }
+        }
+    }
 }
 
 template <typename M>
 template <typename T>
 int qm<M>::quine_mccluskey(std::vector< cube<T> > &primes){
+    if(merge == MERGE_PAIRS)
+        return quine_mccluskey_pairs<T>(primes);
+    return quine_mccluskey_hash<T>(primes);
+}
+
+template <typename M>
+template <typename T>
+int qm<M>::quine_mccluskey_pairs(std::vector< cube<T> > &primes){
     const unsigned int VARIABLES = variables.size();
     const unsigned int GROUPS = VARIABLES+1;
 
-    thread_data_t<T> data(GROUPS);
+    // below this many cube comparisons a group pair is not split any further
+    const unsigned long MIN_WORK = 1 << 14;
+    const unsigned int CONCURRENCY = (pool?pool->get_concurrency():1);
+
+    merge_data_t<T> data(GROUPS);
 
-    // prepare cubes
+    // prepare cubes, models are ordered so every group is sorted
     for(auto it = models.begin(); it != models.end(); it++){
         cube<T> c;
-        c[0] = *it;
+        c[0] = (T) *it;
         c[1].clear_all();
-        data.cset[bitcount(*it)].insert(c);
+        data.cset[bitcount(*it)].push_back(c);
     }
 
     // quine-mccluskey
     unsigned int groups = GROUPS;
-    unsigned int MAX_THREADS = std::thread::hardware_concurrency();
-    if(MAX_THREADS == 0)
-       MAX_THREADS = 4;
-
-    vector <pthread_t> thread(MAX_THREADS);
-    while(groups > 0){
-        //printf("groups: %u\n", groups);
-        for(int group = 0; group < (int) groups; group++){
+    vector< merge_task_t<T> > tasks;
+    vector< vector<unsigned int> > group_tasks(GROUPS);
+    // a round cut short by the deadline leaves the primes incomplete
+    while(groups > 0 && !past_deadline()){
+        threadpool::round r;
+        threadpool::batch compare(true), collect(true);
+        if(pool)
+            pool->begin_round(r);
+
+        // split group pairs into ranges of the lower group
+        tasks.clear();
+        for(unsigned int group = 0; group < groups; group++){
             data.check[group].assign(data.cset[group].size(),0);
-            if(group < (int) groups-1)
-                data.q.add(group);
+            if(group < groups-1 && !data.cset[group].empty() && !data.cset[group+1].empty()){
+                unsigned long size = data.cset[group].size();
+                unsigned long work = size * data.cset[group+1].size();
+                unsigned long parts = std::min(std::min(size, 1 + work / MIN_WORK), (unsigned long) 4*CONCURRENCY);
+                for(unsigned long k = 0; k < parts; k++){
+                    merge_task_t<T> task;
+                    task.group = group;
+                    task.begin = size * k / parts;
+                    task.end = size * (k+1) / parts;
+                    tasks.push_back(task);
+                }
+            }
         }
 
-        // start threads
-        for(unsigned int i = 0; i < MAX_THREADS; i++)
-            if(pthread_create(&(thread[i]), NULL, &thread_function<T>, (void*) &data) != 0)
-                fprintf(stderr, "Couldn't start thread %d...", i);
+        for(unsigned int t = 0; t < tasks.size(); t++){
+            merge_task_t<T> *task = &tasks[t];
+            if(pool)
+                pool->submit(compare, [&data, task, this](){ merge_range(data, *task, deadline); });
+            else merge_range(data, *task, deadline);
+        }
+        if(pool)
+            pool->wait(compare);
+
+        // combine the results of each group pair
+        for(unsigned int group = 0; group < groups; group++)
+            group_tasks[group].clear();
+        for(unsigned int t = 0; t < tasks.size(); t++)
+            group_tasks[tasks[t].group].push_back(t);
+
+        for(unsigned int group = 0; group+1 < groups; group++){
+            if(group_tasks[group].empty())
+                continue;
+
+            auto combine = [&data, &tasks, &group_tasks, group](){
+                for(unsigned int t : group_tasks[group]){
+                    merge_task_t<T> &task = tasks[t];
+                    data.nset[group].insert(task.merged.begin(), task.merged.end());
+                }
+            };
+            if(pool)
+                pool->submit(collect, combine);
+            else combine();
+        }
+
+        // checks of the upper group are set sequentially, they are shared by two pairs
+        for(unsigned int t = 0; t < tasks.size(); t++)
+            for(unsigned int j : tasks[t].upper)
+                data.check[tasks[t].group+1][j] = 1;
 
-        // wait until finished
-        for(unsigned int i = 0; i < MAX_THREADS; i++)
-            pthread_join(thread[i], NULL);
+        if(pool){
+            pool->wait(collect);
+            utilization.push_back(pool->end_round(r));
+        }
 
         // get primes
         for(unsigned int group = 0; group < groups; group++){
-            unsigned int i = 0;
-            for(auto it = data.cset[group].begin(); it != data.cset[group].end(); it++, i++)
+            for(unsigned int i = 0; i < data.cset[group].size(); i++)
                 if(!data.check[group][i])
-                    primes.push_back(*it);
-            data.cset[group].clear();
+                    primes.push_back(data.cset[group][i]);
+            data.cset[group].assign(data.nset[group].begin(), data.nset[group].end());
+            data.nset[group].clear();
         }
 
-        swap(data.cset, data.nset);
         groups--;
     }
     return primes.size();
 }
 
+template <typename M>
+template <typename T>
+int qm<M>::quine_mccluskey_hash(std::vector< cube<T> > &primes){
+    const unsigned int VARIABLES = variables.size();
+    const T FULL = (VARIABLES >= sizeof(T)*8 ? (T) ~(T)0 : (T) (((T)1 << VARIABLES) - 1));
+
+    // below this many lookups a round is not split any further
+    const unsigned long MIN_WORK = 1 << 14;
+    const unsigned int CONCURRENCY = (pool?pool->get_concurrency():1);
+
+    cube_table<T> table, next;
+    table.reset(models.size());
+    for(auto it = models.begin(); it != models.end(); it++){
+        cube<T> c;
+        c[0] = (T) *it;
+        c[1].clear_all();
+        table.entries.push_back(c);
+    }
+
+    vector<uint8_t> check;
+    vector< vector< cube<T> > > merged;
+    vector< cube<T> > round_primes;
+    for(unsigned int round = 0; !table.entries.empty() && !past_deadline(); round++){
+        threadpool::round r;
+        threadpool::batch lookup(true);
+        if(pool)
+            pool->begin_round(r);
+
+        // cubes of equal mask form consecutive buckets
+        vector< cube<T> > &cubes = table.entries;
+        std::sort(cubes.begin(), cubes.end(), mask_order<T>);
+        vector< cube<T> > sorted;
+        sorted.swap(cubes);
+        table.reset(sorted.size());
+        for(unsigned int i = 0; i < sorted.size(); i++)
+            table.insert(sorted[i]);
+        check.assign(cubes.size(), 0);
+
+        unsigned long size = cubes.size();
+        unsigned long work = size * (VARIABLES - round);
+        unsigned long parts = std::min(std::min(size, 1 + work / MIN_WORK), (unsigned long) 4*CONCURRENCY);
+        merged.resize(parts);
+        for(unsigned long k = 0; k < parts; k++){
+            unsigned int begin = size * k / parts;
+            unsigned int end = size * (k+1) / parts;
+            vector< cube<T> > *out = &merged[k];
+            out->clear();
+            if(pool)
+                pool->submit(lookup, [&table, &check, FULL, begin, end, out, this](){ merge_lookup(table, check, FULL, begin, end, *out, deadline); });
+            else merge_lookup(table, check, FULL, begin, end, *out, deadline);
+        }
+        if(pool){
+            pool->wait(lookup);
+            utilization.push_back(pool->end_round(r));
+        }
+
+        // get primes
+        round_primes.clear();
+        for(unsigned int i = 0; i < cubes.size(); i++)
+            if(!check[i])
+                round_primes.push_back(cubes[i]);
+        std::sort(round_primes.begin(), round_primes.end(), group_order<T>);
+        primes.insert(primes.end(), round_primes.begin(), round_primes.end());
+
+        // a cube merged by several pairs is kept once
+        unsigned long total = 0;
+        for(unsigned long k = 0; k < parts; k++)
+            total += merged[k].size();
+        next.reset(total);
+        for(unsigned long k = 0; k < parts; k++)
+            for(unsigned int i = 0; i < merged[k].size(); i++)
+                next.insert(merged[k][i]);
+        std::swap(table, next);
+    }
+    return primes.size();
+}
+
+// covers are aligned for the vectorized cover operations
+static void* cover_alloc(size_t bytes){
+    void *p = NULL;
+    if(posix_memalign(&p, COVER_ALIGN, bytes) != 0)
+        return NULL;
+    return p;
+}
+
+// The cover search orders covers by weight first and by the position of the
+// subproblem they were found in second, so that parallel subproblems settle
+// on the cover the sequential search finds first.
+static inline uint64_t cover_key(unsigned int weight, uint32_t index){
+    return ((uint64_t) weight << 32) | index;
+}
+
+// state shared by the subproblems of one cover search
+template <typename T>
+struct cover_search {
+    unsigned int MODELS;
+    unsigned int N;
+    unsigned int MAX_DEPTH;
+    unsigned int essential_size;
+    cover<T,0> *uncovered;              // models not covered by the essentials
+    cover_list<T> *prime_cover;         // complement of the models covered per prime
+    const uint16_t *prime_weight;
+    const uint16_t *chart_size;
+    const uint32_t *chart_offset;
+    const T *chart;
+
+    std::atomic<uint64_t> incumbent;    // key of the best cover so far
+    std::atomic<uint64_t> nodes;
+    std::atomic<bool> stop;
+    uint64_t max_nodes;                 // 0 is unlimited
+    uint64_t deadline;                  // 0 is unlimited
+};
+
+// subproblem: the primes chosen above it, and the best cover found below
+struct cover_task {
+    std::vector<unsigned int> prefix;
+    unsigned int weight;
+    uint64_t key;
+    std::vector<unsigned int> best;
+};
+
+// first model of the cover that is not covered yet
+template <typename T>
+static inline unsigned int first_uncovered(cover<T,0> &c, unsigned int i = 0){
+    while(!c.test(i))
+        i++;
+    return i;
+}
+
+// offer a cover, returns true when it became the incumbent
+template <typename T>
+static inline bool offer_cover(cover_search<T> &s, uint64_t key){
+    uint64_t current = s.incumbent.load(std::memory_order_relaxed);
+    while(key < current)
+        if(s.incumbent.compare_exchange_weak(current, key, std::memory_order_relaxed))
+            return true;
+    return false;
+}
+
+// count nodes and stop the search when the budget is used up
+template <typename T>
+static inline bool out_of_budget(cover_search<T> &s, uint64_t &nodes){
+    if(++nodes % 1024 != 0)
+        return false;
+    if(s.stop.load(std::memory_order_relaxed))
+        return true;
+    uint64_t total = s.nodes.fetch_add(1024, std::memory_order_relaxed) + 1024;
+    if((s.max_nodes && total >= s.max_nodes) || (s.deadline && threadpool::now() >= s.deadline)){
+        s.stop.store(true, std::memory_order_relaxed);
+        return true;
+    }
+    return false;
+}
+
+// depth first branch and bound below a subproblem: the first uncovered model
+// is covered by each of its primes in turn
+template <typename T>
+static void search_cover(cover_search<T> &s, cover_task &task, uint32_t index){
+    const unsigned int N = s.N;
+    const unsigned int PREFIX = task.prefix.size();
+    task.key = ~(uint64_t) 0;
+
+    if(cover_key(task.weight, index) >= s.incumbent.load(std::memory_order_relaxed))
+        return;
+
+    cover_list<T> *covers_ptr = (cover_list<T>*) cover_alloc(cover_list<T>::bytes(s.MODELS, s.MAX_DEPTH));
+    if(!covers_ptr){
+        fprintf(stderr, "failed to allocate covers\n");
+        s.stop.store(true);
+        return;
+    }
+    cover_list<T> &covers = *covers_ptr;
+    covers.set_cover_size(N);
+    covers.set_size(s.MAX_DEPTH);
+    covers[0].assign(*s.uncovered,N);
+    for(unsigned int d = 0; d < PREFIX; d++)
+        covers[0].and_assign((*s.prime_cover)[task.prefix[d]],N);
+
+    // the subproblem itself is a cover
+    if(covers[0].none(N)){
+        unsigned int weight = task.weight;
+        if(PREFIX+s.essential_size==1)
+            weight--;
+        if(offer_cover(s, cover_key(weight, index))){
+            task.key = cover_key(weight, index);
+            task.best = task.prefix;
+        }
+        free(covers_ptr);
+        return;
+    }
+
+    std::vector< array<unsigned int,2> > stack(s.MAX_DEPTH);   // cube(prime index (< PRIMES), i (< max depth))
+    std::vector<unsigned int> weights(s.MAX_DEPTH+1);
+    weights[0] = task.weight;
+
+    uint64_t nodes = 0;
+    int depth = 0;
+    unsigned int i = first_uncovered(covers[0]);
+    stack[depth][0] = 0;
+    while(depth >= 0){
+        if(covers[depth].test(i)){
+            while(true){
+                if(stack[depth][0] < s.chart_size[i]){
+                    unsigned int p = s.chart[s.chart_offset[i]+stack[depth][0]];
+
+                    // compute weight
+                    weights[depth+1] = weights[depth] + s.prime_weight[p] + 1;
+
+                    // prune
+                    if(cover_key(weights[depth+1], index) >= s.incumbent.load(std::memory_order_relaxed))
+                        stack[depth][0]++;
+                    else {
+                        stack[depth][1] = i;
+                        if(out_of_budget(s, nodes)){
+                            depth = -1;
+                            break;
+                        }
+
+                        // update cover and determine covering
+                        if(covers[depth+1].assign_and(covers[depth],(*s.prime_cover)[p],N)){
+                            unsigned int weight = weights[depth+1];
+                            if(PREFIX+depth+1+s.essential_size==1)
+                                weight--;
+
+                            if(offer_cover(s, cover_key(weight, index))){
+                                task.key = cover_key(weight, index);
+                                task.best = task.prefix;
+                                for(int d = 0; d <= depth; d++)
+                                    task.best.push_back(s.chart[s.chart_offset[stack[d][1]]+stack[d][0]]);
+                            }
+
+                            // go through more primes on current depth
+                            stack[depth][0]++;
+                        } else { // acquire more primes
+                            depth++;
+                            stack[depth][0] = 0;
+                            break;
+                        }
+                    }
+                } else {
+                    depth--;
+                    if(depth >= 0){
+                        stack[depth][0]++;
+                        i = stack[depth][1];
+                    } else break;
+                }
+            }
+        }
+        i++;
+    }
+    free(covers_ptr);
+}
+
 template <typename M>
 template <typename T>
 inline unsigned int qm<M>::get_weight(cube<T> &c, const T &MASK) const {
@@ -398,7 +901,7 @@ int qm<M>::reduce(std::vector< cube<P> >&primes){
 
     uint16_t *prime_weight = (uint16_t*) alloca(sizeof(uint16_t*)*PRIMES);                   // int prime_weight[PRIMES]
     unsigned int N = cover<T,0>::cover_size(MODELS);
-    cover_list<T> *prime_cover_ptr = (cover_list<T>*) malloc(sizeof(unsigned int)*2+sizeof(T)*N*PRIMES);
+    cover_list<T> *prime_cover_ptr = (cover_list<T>*) cover_alloc(cover_list<T>::bytes(MODELS, PRIMES));
     cover_list<T> &prime_cover = *prime_cover_ptr;//cover_list<T>::cast((malloc(sizeof(T)*N*MODELS)));  // cover prime_cover[PRIMES]
     prime_cover.set_size(PRIMES);
     prime_cover.set_cover_size(N);
@@ -428,7 +931,7 @@ int qm<M>::reduce(std::vector< cube<P> >&primes){
     }
 
     // identify essential implicates and remove the models they cover
-    cover<T,0> &cvr = cover<T,0>::cast(alloca((cover<T,0>::bytes(N))));
+    cover<T,0> &cvr = cover<T,0>::cast(cover_align(alloca((cover<T,0>::bytes(N)+COVER_ALIGN))));
     cvr.init(0,N);
     cvr.set_lsb(MODELS);
     //unsigned int *essentials = (unsigned int*) alloca(sizeof(unsigned int)*PRIMES);
@@ -455,95 +958,111 @@ int qm<M>::reduce(std::vector< cube<P> >&primes){
             }
         }
     }
-    // find minimal prime implicate representation
-    unsigned int non_essential_size = 0;
-    unsigned int min_weight = ~0u;
-    const unsigned int MAX_DEPTH = cvr.count(N)+1;
-    if(cvr.any(N)){
-        unsigned int *non_essentials = essentials+essential_size;
-        size_t covers_size_t = cover_list<T>::bytes(MODELS, N);
-        cover_list<T> *covers_ptr = (cover_list<T>*) malloc(covers_size_t*MAX_DEPTH);
-        if(!covers_ptr){
-            fprintf(stderr, "failed to allocate covers\n");
-            return -1;
+    // greedy cover: the first uncovered model is covered by the prime that
+    // leaves the fewest models, it bounds the search and is the fallback
+    // when the budget runs out
+    cover<T,0> &rest = cover<T,0>::cast(cover_align(alloca((cover<T,0>::bytes(N)+COVER_ALIGN))));
+    cover<T,0> &tmp = cover<T,0>::cast(cover_align(alloca((cover<T,0>::bytes(N)+COVER_ALIGN))));
+    vector<unsigned int> greedy;
+    unsigned int greedy_weight = weight;
+    rest.assign(cvr,N);
+    while(rest.any(N)){
+        unsigned int i = first_uncovered(rest);
+        unsigned int best = chart[chart_offset[i]], best_left = ~0u;
+        for(unsigned int k = 0; k < chart_size[i]; k++){
+            unsigned int p = chart[chart_offset[i]+k];
+            tmp.assign_and(rest,prime_cover[p],N);
+            unsigned int left = tmp.count(N);
+            if(left < best_left || (left == best_left && prime_weight[p] < prime_weight[best])){
+                best = p;
+                best_left = left;
+            }
         }
-        cover_list<T> &covers = *covers_ptr;
-
-        covers.set_cover_size(N);
-        covers.set_size(PRIMES);
-        covers[0].assign(cvr,N);
-
-        array<unsigned int,2> stack[PRIMES];//; = (array<unsigned int,2>*) alloca(sizeof(array<unsigned int,2>)*PRIMES); // cube(prime index (< PRIMES), i (< max depth))
-        uint16_t weights[MAX_DEPTH];
-        weights[0] = weight;
-
-        int depth = 0;
-        i = 0;
-        stack[depth][0] = 0;
-        while(depth >= 0){
-            if(covers[depth].test(i)){
-                while(true){
-                    if(stack[depth][0] < chart_size[i]){
-                        unsigned int p = chart[chart_offset[i]+stack[depth][0]];
-
-                        // compute weight
-                        weights[depth+1] = weights[depth] + prime_weight[p] + 1;
-
-                        // prune
-                        if(weights[depth+1] >= min_weight)
-                            stack[depth][0]++;
-                        else {
-                            stack[depth][1] = i;
-
-                            // update cover
-                            covers[depth+1].assign(covers[depth],N);
-                            covers[depth+1].and_assign(prime_cover[p],N);
-
-                            // determine covering
-                            if(covers[depth+1].none(N)){
-                                // go through more primes on current depth
-                                //unsigned int weight = depth+essentials+1;
-                                //set_min_value(min_weight, weights[depth+1] + (weight==1?-1:0));a
-
-                                non_essential_size = depth+1;
-                                //max_depth = (max_depth<non_essential_size?non_essential_size:max_depth);
-                                unsigned int tmp_weight = weights[depth+1];
-                                if(non_essential_size+essential_size==1)
-                                    tmp_weight--;
-
-                                if(tmp_weight < min_weight) {
-                                    for(int d = 0; d <= depth; d++){
-                                        unsigned int p = chart[chart_offset[stack[d][1]]+stack[d][0]];
-                                        non_essentials[d] = p;
-                                    }
-                                    min_weight = tmp_weight;
-                                }
-
-                                stack[depth][0]++;
-                            } else { // acquire more primes
-                                stack[depth][1] = i;
-                                depth++;
-                                stack[depth][0] = 0;
-                                break;
-                            }
-                        }
-                    } else {
-                        depth--;
-                        if(depth >= 0){
-                            stack[depth][0]++;
-                            i = stack[depth][1];
-                        } else break;
+        rest.and_assign(prime_cover[best],N);
+        greedy.push_back(best);
+        greedy_weight += prime_weight[best] + 1;
+    }
+    if(greedy.size()+essential_size==1)
+        greedy_weight--;
+
+    // find minimal prime implicate representation
+    vector<unsigned int> non_essentials = greedy;
+    interrupted = false;
+    if(!greedy.empty()){
+        cover_search<T> search;
+        search.MODELS = MODELS;
+        search.N = N;
+        search.MAX_DEPTH = std::min(cvr.count(N), PRIMES-essential_size)+1;
+        search.essential_size = essential_size;
+        search.uncovered = &cvr;
+        search.prime_cover = &prime_cover;
+        search.prime_weight = prime_weight;
+        search.chart_size = chart_size;
+        search.chart_offset = chart_offset;
+        search.chart = chart.data();
+        search.incumbent = cover_key(greedy_weight, UINT32_MAX);
+        search.nodes = 0;
+        search.stop = false;
+        search.max_nodes = max_nodes;
+        search.deadline = deadline;
+
+        // split the search tree into subproblems for the pool, level by
+        // level so that the subproblems stay in search order
+        vector<cover_task> tasks(1);
+        tasks[0].weight = weight;
+        if(pool && pool->get_concurrency() > 1){
+            const unsigned int SPLIT = 4*pool->get_concurrency();
+            for(unsigned int level = 0; level < 4 && tasks.size() < SPLIT; level++){
+                vector<cover_task> next;
+                bool split = false;
+                for(unsigned int t = 0; t < tasks.size(); t++){
+                    tmp.assign(cvr,N);
+                    for(unsigned int d = 0; d < tasks[t].prefix.size(); d++)
+                        tmp.and_assign(prime_cover[tasks[t].prefix[d]],N);
+                    if(tmp.none(N)){
+                        next.push_back(std::move(tasks[t]));
+                        continue;
                     }
+
+                    unsigned int i = first_uncovered(tmp);
+                    for(unsigned int k = 0; k < chart_size[i]; k++){
+                        unsigned int p = chart[chart_offset[i]+k];
+                        unsigned int w = tasks[t].weight + prime_weight[p] + 1;
+                        if(w > greedy_weight)
+                            continue;
+                        next.resize(next.size()+1);
+                        next.back().prefix = tasks[t].prefix;
+                        next.back().prefix.push_back(p);
+                        next.back().weight = w;
+                    }
+                    split = true;
                 }
+                tasks.swap(next);
+                if(!split)
+                    break;
             }
-            i++;
         }
-        free(covers_ptr);
-    }
-    if(min_weight == (unsigned int) ~0){
-        min_weight = (essential_size+non_essential_size==1?weight-1:weight);
+
+        if(tasks.size() > 1){
+            threadpool::batch b;
+            for(unsigned int t = 0; t < tasks.size(); t++)
+                pool->submit(b, [&search, &tasks, t](){ search_cover(search, tasks[t], t); });
+            pool->wait(b);
+        } else if(tasks.size() == 1)
+            search_cover(search, tasks[0], 0);
+
+        uint64_t key = cover_key(greedy_weight, UINT32_MAX);
+        for(unsigned int t = 0; t < tasks.size(); t++){
+            if(tasks[t].key < key){
+                key = tasks[t].key;
+                non_essentials = tasks[t].best;
+            }
+        }
+        interrupted = search.stop;
     }
 
+    const unsigned int non_essential_size = non_essentials.size();
+    std::copy(non_essentials.begin(), non_essentials.end(), essentials+essential_size);
     std::sort(essentials, essentials+essential_size+non_essential_size);
     for(unsigned int i = 0; i < essential_size+non_essential_size; i++)
         primes[i] = primes[essentials[i]];
@@ -608,3 +1127,8 @@ template class qm<uint128_t>;
 template class cover_element<uint128_t>;
 #endif
 
+template class qm<uint256_t>;
+template class qm<uint512_t>;
+template class cover_element<uint256_t>;
+template class cover_element<uint512_t>;
+
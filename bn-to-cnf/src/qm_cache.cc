@@ -0,0 +1,269 @@
+#include "qm_cache.h"
+#include <algorithm>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+static const uint64_t QM_CACHE_MAGIC = 0x3145484341434d51ull;  // "QMCACHE1"
+static const uint32_t QM_CACHE_VERSION = 1;
+
+qm_cache::qm_cache() : hits(0), misses(0) {
+    mapped = mapping_t();
+    pending_size = 0;
+    pthread_mutex_init(&mutex, NULL);
+}
+
+qm_cache::~qm_cache(){
+    close();
+    pthread_mutex_destroy(&mutex);
+}
+
+// a missing file maps as an empty cache, false is returned for an invalid one
+bool qm_cache::map(const string &filename, mapping_t &m){
+    m = mapping_t();
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if(fd < 0)
+        return true;
+
+    struct stat st;
+    if(fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0){
+        ::close(fd);
+        return false;
+    }
+
+    void *data = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if(data == MAP_FAILED)
+        return false;
+    m.data = (const char*) data;
+    m.size = st.st_size;
+
+    // verify the layout before any entry is trusted, sizes are compared to
+    // what is left of the payload so that they cannot overflow
+    const header_t *header = (const header_t*) m.data;
+    bool valid = m.size >= sizeof(header_t) && header->magic == QM_CACHE_MAGIC && header->version == QM_CACHE_VERSION
+        && (m.size-sizeof(header_t))/sizeof(entry_t) >= header->entries;
+    if(valid){
+        m.ENTRIES = header->entries;
+        m.entries = (const entry_t*) (m.data + sizeof(header_t));
+        m.payload = (const int32_t*) (m.entries + m.ENTRIES);
+        uint64_t words = (m.size - sizeof(header_t) - sizeof(entry_t)*m.ENTRIES)/sizeof(int32_t);
+        for(uint32_t e = 0; e < m.ENTRIES && valid; e++){
+            const entry_t &entry = m.entries[e];
+            valid = entry.offset <= words && entry.key_size <= words - entry.offset
+                && entry.value_size <= words - entry.offset - entry.key_size
+                && (e == 0 || m.entries[e-1].hash <= entry.hash);
+        }
+    }
+    if(!valid){
+        unmap(m);
+        return false;
+    }
+    return true;
+}
+
+void qm_cache::unmap(mapping_t &m){
+    if(m.data)
+        munmap((void*) m.data, m.size);
+    m = mapping_t();
+}
+
+// an invalid file is ignored and replaced on save()
+bool qm_cache::open(string f){
+    close();
+    filename = f;
+    if(!map(filename, mapped)){
+        fprintf(stderr, "Ignoring invalid QM cache %s\n", filename.c_str());
+        return false;
+    }
+    return true;
+}
+
+void qm_cache::close(){
+    unmap(mapped);
+    pending.clear();
+    pending_size = 0;
+}
+
+// FNV-1a
+uint64_t qm_cache::hash(const int32_t *key, size_t size){
+    uint64_t h = 0xcbf29ce484222325ull;
+    const unsigned char *p = (const unsigned char*) key;
+    for(size_t i = 0; i < size*sizeof(int32_t); i++){
+        h ^= p[i];
+        h *= 0x100000001b3ull;
+    }
+    return h;
+}
+
+// number of clauses, then the size and literals of every clause
+void qm_cache::encode(const value_t &value, vector<int32_t> &words){
+    words.push_back(value.size());
+    for(unsigned int c = 0; c < value.size(); c++){
+        words.push_back(value[c].size());
+        words.insert(words.end(), value[c].begin(), value[c].end());
+    }
+}
+
+bool qm_cache::decode(const int32_t *words, size_t size, value_t &value){
+    if(size == 0 || words[0] < 0)
+        return false;
+    value.resize(words[0]);
+    size_t i = 1;
+    for(unsigned int c = 0; c < value.size(); c++){
+        if(i >= size || words[i] < 0 || i+1+words[i] > size)
+            return false;
+        value[c].assign(words+i+1, words+i+1+words[i]);
+        i += 1+words[i];
+    }
+    return i == size;
+}
+
+bool qm_cache::lookup(const key_t &key, value_t &value){
+    uint64_t h = hash(key.data(), key.size());
+
+    // entries are sorted on their hash
+    const entry_t *end = mapped.entries+mapped.ENTRIES;
+    const entry_t *e = lower_bound(mapped.entries, end, h, [](const entry_t &e, uint64_t h){ return e.hash < h; });
+    for(; e != end && e->hash == h; e++){
+        if(e->key_size == key.size() && memcmp(mapped.payload+e->offset, key.data(), key.size()*sizeof(int32_t)) == 0
+                && decode(mapped.payload+e->offset+e->key_size, e->value_size, value)){
+            hits++;
+            return true;
+        }
+    }
+
+    pthread_mutex_lock(&mutex);
+    auto it = pending.find(h);
+    if(it != pending.end()){
+        for(unsigned int i = 0; i < it->second.size(); i++){
+            if(it->second[i].first == key){
+                decode(it->second[i].second.data(), it->second[i].second.size(), value);
+                pthread_mutex_unlock(&mutex);
+                hits++;
+                return true;
+            }
+        }
+    }
+    pthread_mutex_unlock(&mutex);
+    misses++;
+    return false;
+}
+
+void qm_cache::insert(const key_t &key, const value_t &value){
+    vector<int32_t> words;
+    encode(value, words);
+    uint64_t h = hash(key.data(), key.size());
+
+    pthread_mutex_lock(&mutex);
+    auto &bucket = pending[h];
+    bool found = false;
+    for(unsigned int i = 0; i < bucket.size() && !found; i++)
+        found = (bucket[i].first == key);
+    if(!found){
+        bucket.push_back(make_pair(key, words));
+        pending_size++;
+    }
+    pthread_mutex_unlock(&mutex);
+}
+
+// The entries on disk, the mapped and the new entries are merged into a
+// temporary file that replaces the cache, readers of the old file keep their
+// mapping. The cache file itself is replaced, so writers lock a file next to
+// it and merge what was saved while this run had the cache open.
+bool qm_cache::save(){
+    if(filename.empty() || pending_size == 0)
+        return true;
+
+    string lock = filename + ".lock";
+    int lock_fd = ::open(lock.c_str(), O_RDWR | O_CREAT, 0666);
+    if(lock_fd < 0 || flock(lock_fd, LOCK_EX) != 0){
+        fprintf(stderr, "Could not lock QM cache %s\n", lock.c_str());
+        if(lock_fd >= 0)
+            ::close(lock_fd);
+        return false;
+    }
+
+    mapping_t current;
+    if(!map(filename, current))
+        fprintf(stderr, "Ignoring invalid QM cache %s\n", filename.c_str());
+
+    struct item_t {
+        uint64_t hash;
+        const int32_t *key;
+        uint32_t key_size;
+        const int32_t *value;
+        uint32_t value_size;
+    };
+    vector<item_t> items;
+    items.reserve(current.ENTRIES + mapped.ENTRIES + pending_size);
+    for(const mapping_t *m : { &current, &mapped }){
+        for(uint32_t e = 0; e < m->ENTRIES; e++){
+            const entry_t &entry = m->entries[e];
+            items.push_back({entry.hash, m->payload+entry.offset, entry.key_size, m->payload+entry.offset+entry.key_size, entry.value_size});
+        }
+    }
+    for(auto it = pending.begin(); it != pending.end(); it++)
+        for(unsigned int i = 0; i < it->second.size(); i++)
+            items.push_back({it->first, it->second[i].first.data(), (uint32_t) it->second[i].first.size(),
+                it->second[i].second.data(), (uint32_t) it->second[i].second.size()});
+    stable_sort(items.begin(), items.end(), [](const item_t &a, const item_t &b){ return a.hash < b.hash; });
+
+    // an entry can be on disk, mapped and new at once, the first one is kept
+    size_t unique = 0;
+    for(size_t i = 0; i < items.size(); i++){
+        bool duplicate = false;
+        for(size_t j = unique; j > 0 && items[j-1].hash == items[i].hash && !duplicate; j--)
+            duplicate = items[j-1].key_size == items[i].key_size
+                && memcmp(items[j-1].key, items[i].key, items[i].key_size*sizeof(int32_t)) == 0;
+        if(!duplicate)
+            items[unique++] = items[i];
+    }
+    items.resize(unique);
+
+    string tmp = filename + ".tmp." + to_string(getpid());
+    FILE *file = fopen(tmp.c_str(), "wb");
+    bool ok = (file != NULL);
+    if(ok){
+        header_t header = {QM_CACHE_MAGIC, QM_CACHE_VERSION, (uint32_t) items.size()};
+        ok = fwrite(&header, sizeof(header), 1, file) == 1;
+        uint64_t offset = 0;
+        for(unsigned int i = 0; i < items.size() && ok; i++){
+            entry_t entry = {items[i].hash, offset, items[i].key_size, items[i].value_size};
+            ok = fwrite(&entry, sizeof(entry), 1, file) == 1;
+            offset += items[i].key_size + items[i].value_size;
+        }
+        for(unsigned int i = 0; i < items.size() && ok; i++){
+            ok = fwrite(items[i].key, sizeof(int32_t), items[i].key_size, file) == items[i].key_size
+                && fwrite(items[i].value, sizeof(int32_t), items[i].value_size, file) == items[i].value_size;
+        }
+        ok = (fclose(file) == 0) && ok;
+        ok = ok && rename(tmp.c_str(), filename.c_str()) == 0;
+    }
+    if(!ok){
+        fprintf(stderr, "Could not write QM cache %s\n", filename.c_str());
+        unlink(tmp.c_str());
+    }
+
+    unmap(current);
+    ::close(lock_fd);
+    return ok;
+}
+
+uint64_t qm_cache::get_hits() const {
+    return hits;
+}
+
+uint64_t qm_cache::get_misses() const {
+    return misses;
+}
+
+size_t qm_cache::size() const {
+    return mapped.ENTRIES + pending_size;
+}
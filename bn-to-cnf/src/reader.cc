@@ -6,16 +6,19 @@ using namespace std;
 
 vector<string> reader::string_to_words(string text){
     vector<string> words;
-    FILE * file;
-    file = tmpfile();
-    fputs (text.c_str(), file);
-    rewind(file);
-
-    reader input;
-    input.add_delimiters(ignore_delimiter, 3, ' ', '\t', '\n', '\r');
-    input.set_fd(file);
-    while(input.get_word_peek() != input.last_word())
-        words.push_back(input.get_word());
+    size_t i = 0;
+    while(i < text.size()){
+        while(i < text.size() && (text[i] == ' ' || text[i] == '\t' || text[i] == '\n' || text[i] == '\r'))
+            i++;
+
+        size_t j = i;
+        while(j < text.size() && !(text[j] == ' ' || text[j] == '\t' || text[j] == '\n' || text[j] == '\r'))
+            j += (text[j] == '\\' && j+1 < text.size()) ? 2 : 1;
+
+        if(j > i)
+            words.push_back(text.substr(i, j-i));
+        i = j;
+    }
 
     return words;
 }
@@ -0,0 +1,204 @@
+#include "threadpool.h"
+#include <algorithm>
+#include <sched.h>
+#include <stdio.h>
+#include <time.h>
+#include <thread>
+
+using namespace std;
+
+struct worker_arg_t {
+    threadpool *pool;
+    unsigned int index;
+};
+
+static thread_local const threadpool *current_pool = NULL;
+static thread_local unsigned int current_index = 0;
+
+uint64_t threadpool::now(){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+threadpool::threadpool(unsigned int concurrency) : queued(0), next(0), rounds(0), busy_time(0), capacity_time(0) {
+    if(concurrency == 0)
+        concurrency = std::thread::hardware_concurrency();
+    if(concurrency == 0)
+        concurrency = 4;
+
+    // the thread waiting on a batch works as well
+    WORKERS = concurrency-1;
+    stop = false;
+    active_rounds = 0;
+    active_start = 0;
+    pthread_mutex_init(&round_mutex, NULL);
+    pthread_mutex_init(&sleep_mutex, NULL);
+    pthread_cond_init(&wake, NULL);
+
+    queues = vector<queue_t>(WORKERS+1);
+    for(unsigned int i = 0; i <= WORKERS; i++)
+        pthread_mutex_init(&queues[i].mutex, NULL);
+
+    threads.resize(WORKERS);
+    for(unsigned int i = 0; i < WORKERS; i++){
+        worker_arg_t *arg = new worker_arg_t;
+        arg->pool = this;
+        arg->index = i;
+        if(pthread_create(&(threads[i]), NULL, &threadpool::worker, (void*) arg) != 0){
+            fprintf(stderr, "Couldn't start thread %d...", i);
+            delete arg;
+            threads.resize(i);
+            break;
+        }
+    }
+}
+
+threadpool::~threadpool(){
+    pthread_mutex_lock(&sleep_mutex);
+    stop = true;
+    pthread_cond_broadcast(&wake);
+    pthread_mutex_unlock(&sleep_mutex);
+
+    for(unsigned int i = 0; i < threads.size(); i++)
+        pthread_join(threads[i], NULL);
+
+    for(unsigned int i = 0; i < queues.size(); i++)
+        pthread_mutex_destroy(&queues[i].mutex);
+    pthread_cond_destroy(&wake);
+    pthread_mutex_destroy(&sleep_mutex);
+    pthread_mutex_destroy(&round_mutex);
+}
+
+unsigned int threadpool::get_concurrency() const {
+    return threads.size()+1;
+}
+
+unsigned int threadpool::self() const {
+    if(current_pool == this)
+        return current_index;
+    return WORKERS;
+}
+
+void* threadpool::worker(void *a){
+    worker_arg_t *arg = (worker_arg_t*) a;
+    threadpool *pool = arg->pool;
+    current_pool = pool;
+    current_index = arg->index;
+    delete arg;
+
+    while(true){
+        if(pool->run_one(current_index))
+            continue;
+
+        pthread_mutex_lock(&pool->sleep_mutex);
+        while(pool->queued == 0 && !pool->stop)
+            pthread_cond_wait(&pool->wake, &pool->sleep_mutex);
+        bool done = pool->stop;
+        pthread_mutex_unlock(&pool->sleep_mutex);
+        if(done)
+            break;
+    }
+    return NULL;
+}
+
+void threadpool::submit(batch &b, function<void()> f){
+    b.pending++;
+    b.tasks++;
+
+    // workers keep what they spawn, outside threads spread their tasks
+    unsigned int q = self();
+    if(q == WORKERS)
+        q = next++ % (WORKERS+1);
+
+    task_t t;
+    t.f = std::move(f);
+    t.b = &b;
+    pthread_mutex_lock(&queues[q].mutex);
+    queues[q].tasks.push_back(std::move(t));
+    pthread_mutex_unlock(&queues[q].mutex);
+
+    pthread_mutex_lock(&sleep_mutex);
+    queued++;
+    pthread_cond_signal(&wake);
+    pthread_mutex_unlock(&sleep_mutex);
+}
+
+bool threadpool::run_one(unsigned int q){
+    if(queued == 0)
+        return false;
+
+    task_t t;
+    bool found = false;
+    for(unsigned int k = 0; k <= WORKERS && !found; k++){
+        queue_t &queue = queues[(q+k) % (WORKERS+1)];
+        pthread_mutex_lock(&queue.mutex);
+        if(!queue.tasks.empty()){
+            if(k == 0){
+                t = std::move(queue.tasks.back());
+                queue.tasks.pop_back();
+            } else {
+                t = std::move(queue.tasks.front());
+                queue.tasks.pop_front();
+            }
+            found = true;
+        }
+        pthread_mutex_unlock(&queue.mutex);
+    }
+    if(!found)
+        return false;
+    queued--;
+
+    uint64_t start = now();
+    t.f();
+    uint64_t busy = now() - start;
+    t.b->busy += busy;
+    if(t.b->measured)
+        busy_time += busy;
+    t.b->pending--;
+    return true;
+}
+
+void threadpool::wait(batch &b){
+    unsigned int q = self();
+    while(b.pending > 0){
+        if(!run_one(q))
+            sched_yield();
+    }
+}
+
+void threadpool::begin_round(round &r){
+    pthread_mutex_lock(&round_mutex);
+    r.start = now();
+    r.busy = busy_time;
+    if(active_rounds++ == 0)
+        active_start = r.start;
+    pthread_mutex_unlock(&round_mutex);
+}
+
+// the busy fraction of the whole pool while the round ran, which includes
+// the measured work of rounds running next to it
+float threadpool::end_round(const round &r){
+    pthread_mutex_lock(&round_mutex);
+    uint64_t end = now();
+    uint64_t busy = busy_time - r.busy;
+    rounds++;
+    if(--active_rounds == 0)
+        capacity_time += (end - active_start) * get_concurrency();
+    pthread_mutex_unlock(&round_mutex);
+
+    uint64_t wall = end - r.start;
+    if(wall == 0)
+        return 0;
+    return std::min(1.0f, (float) busy / (wall * get_concurrency()));
+}
+
+uint64_t threadpool::get_rounds() const {
+    return rounds;
+}
+
+double threadpool::get_utilization() const {
+    if(capacity_time == 0)
+        return 0;
+    return (double) busy_time / capacity_time;
+}
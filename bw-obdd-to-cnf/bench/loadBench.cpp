@@ -0,0 +1,155 @@
+// Throughput of loadOdd on large layered decision diagrams: a diagram of the
+// requested size is generated (or an existing .odd is given with -i) and
+// loaded a number of times, the best time is reported in MB/s and nodes/s.
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <algorithm>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "parser.h"
+#include "logicNode.h"
+
+void help(){
+    std::cerr << "\nUsage:\n   ./odd-load-bench [option] [...]\n\n";
+    std::cerr << "   Options:\n";
+    std::cerr << "      -i <filename>: Load this .odd file instead of a generated one\n";
+    std::cerr << "      -o <filename>: File the generated diagram is written to (default odd-load-bench.odd)\n";
+    std::cerr << "      -n <nodes>: Nodes of the generated diagram (default 2000000)\n";
+    std::cerr << "      -w <width>: Nodes per level of the generated diagram (default 1000)\n";
+    std::cerr << "      -k <values>: Values per variable, the children of a node (default 2)\n";
+    std::cerr << "      -r <repeats>: Loads of the diagram, the best one counts (default 3)\n";
+    std::cerr << "      -s <seed>: Random seed (default 1)\n";
+    std::cerr << "      -h: Help\n";
+}
+
+// A layered diagram as network-gen writes it: level j tests variable j and
+// points to nodes of level j+1, the last level to the sinks. The root (id 0)
+// is alone on level 0, every node is reachable and written after its children.
+bool generate(const std::string& outfile, long long nodes, long long width, int values, unsigned int seed) {
+    std::ofstream fout(outfile);
+    if (!fout) {
+        return false;
+    }
+    std::mt19937 rng(seed);
+    const long long levels = 1 + (std::max(nodes - 1, 0LL) + width - 1) / width;
+
+    fout << "[";
+    for (long long j = 0; j < levels; j++) {
+        fout << (j ? ", X" : "X") << j;
+    }
+    fout << "]\n";
+
+    std::vector<long long> first(levels + 1), size(levels);
+    for (long long j = 0, id = 0; j < levels; j++) {
+        first[j] = id;
+        size[j] = j == 0 ? 1 : std::min(width, nodes - id);
+        id += size[j];
+    }
+
+    std::string line;
+    for (long long j = levels; j-- > 0;) {
+        const bool last = j + 1 == levels;
+        const long long below = last ? 2 : size[j + 1];
+        std::uniform_int_distribution<long long> child(0, below - 1);
+        for (long long n = 0; n < size[j]; n++) {
+            line = std::to_string(first[j] + n) + " " + std::to_string(j);
+            for (int v = 0; v < values; v++) {
+                // the first edges of a level reach every node below
+                long long e = n * values + v;
+                long long target = e < below ? e : child(rng);
+                line += last ? " S" + std::to_string(target) : " " + std::to_string(first[j + 1] + target);
+            }
+            line += '\n';
+            fout << line;
+        }
+    }
+    return static_cast<bool>(fout);
+}
+
+bool count(const char *s, long long& n) {
+    char *end;
+    n = strtoll(s, &end, 10);
+    return *s != '\0' && *end == '\0' && n > 0;
+}
+
+int main(int argc, char **argv) {
+    std::string infile, outfile = "odd-load-bench.odd";
+    long long nodes = 2000000, width = 1000, values = 2, repeats = 3, seed = 1;
+
+    int c;
+    while ((c = getopt(argc, argv, "i:o:n:w:k:r:s:h")) != -1) {
+        bool valid = true;
+        switch (c) {
+            case 'i':
+                infile = optarg;
+                break;
+            case 'o':
+                outfile = optarg;
+                break;
+            case 'n':
+                valid = count(optarg, nodes);
+                break;
+            case 'w':
+                valid = count(optarg, width);
+                break;
+            case 'k':
+                valid = count(optarg, values) && values >= 2;
+                break;
+            case 'r':
+                valid = count(optarg, repeats);
+                break;
+            case 's':
+                valid = count(optarg, seed);
+                break;
+            default:
+                help();
+                return 1;
+        }
+        if (!valid) {
+            std::cerr << "Invalid argument to option -" << static_cast<char>(c) << " (" << optarg << ")\n";
+            return 1;
+        }
+    }
+
+    if (infile.empty()) {
+        std::cout << "Generating " << nodes << " nodes (" << width << " per level, " << values << " values)" << std::endl;
+        if (!generate(outfile, nodes, width, values, seed)) {
+            std::cerr << "Could not write to: " << outfile << std::endl;
+            return 1;
+        }
+        infile = outfile;
+    }
+
+    struct stat st;
+    if (stat(infile.c_str(), &st) != 0) {
+        std::cerr << "Could not read: " << infile << std::endl;
+        return 1;
+    }
+    const double megabytes = st.st_size / 1e6;
+
+    double best = 0;
+    long long size = 0;
+    for (long long r = 0; r < repeats; r++) {
+        auto start = std::chrono::steady_clock::now();
+        try {
+            Odd diagram = loadOdd(infile, 2);
+            size = diagram.getSize();
+        }
+        catch (const std::runtime_error& e) {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (r == 0 || seconds < best) {
+            best = seconds;
+        }
+    }
+
+    std::cout << infile << ": " << megabytes << " MB, " << size << " nodes" << std::endl;
+    std::cout << "load: " << best << " s, " << megabytes / best << " MB/s, " << size / best / 1e6 << " M nodes/s" << std::endl;
+    return 0;
+}
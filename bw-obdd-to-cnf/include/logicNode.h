@@ -3,51 +3,68 @@
 
 #include <stdexcept>
 #include <map>
+#include <unordered_map>
 #include <vector>
 #include <string>
+#include <cstdlib>
 #include <iostream>
 #include <sstream>
 #include <fstream>
 #include "graphModel.h"
+#include "amo.h"
 
 class OddNode {
 
     public:
         enum NodeType { NORMAL, SINK };
-        OddNode(long long id, std::string srcVarName, std::vector<long long> children, NodeType type, int sink_num = 0);;
+        OddNode(long long id, int srcVarIndex, std::vector<long long> children, NodeType type, int sink_num = 0);
 
         void setId(long long id);
 
-        long long getId();
+        long long getId() const;
 
         void setSinkNum(int sink_num);
 
-        int getSinkNum();
+        int getSinkNum() const;
 
 
-        void setChild(int val,long long childId);
+        void setChild(int val, long long childIndex);
 
-        long long getChild(int index);
+        // Position of the child in Odd::getNodes()
+        long long getChild(int index) const;
 
-        int getCardinality();
+        int getCardinality() const;
 
-        NodeType getType();
+        NodeType getType() const;
 
-        std::string getSrcVarName();
+        int getSrcVarIndex() const;
 
     private:
-        std::vector<long long> children; // ids
-        std::string srcVarName;
+        std::vector<long long> children; // indices
+        int srcVarIndex;
         NodeType type;
         long long id;
         int sink_num;
 
 };
 
+// Nodes removed by Odd::reduce
+struct OddReductionStats {
+    long long duplicates = 0;   // the same variable and children as a node before
+    long long redundant = 0;    // every child the same
+    long long unreachable = 0;  // not below the root (any more)
+    long long children = 0;     // of the nodes removed
+};
+
 class Odd {
     private:
         std::vector<OddNode> nodes; // reverse topological order
-        std::map<long long, long long> idToIndex;
+
+        // id -> index: dense for the ids up to a few times the number of nodes (-1 when absent), sinks by -id - 1,
+        // a hash for the ids beyond
+        std::vector<long long> idToIndex;
+        std::vector<long long> sinkIdToIndex;
+        std::unordered_map<long long, long long> sparseIdToIndex;
 
         std::map<std::string, int> srcVarNameToSrcVarIndex;
         std::vector<std::pair<std::string, int> > srcVarNameNumValues; // pairs (srcVarName, numValues) - binary, etc.
@@ -56,44 +73,61 @@ class Odd {
     public:
         Odd(std::vector<std::pair<std::string, int> > srcVarNamesNumValues);
 
-        OddNode addNode(long long id, std::string srcVarName, std::vector<long long> childrenId, OddNode::NodeType type, int sink_num = 0);
+        // The children are given by id, an id that was not added yet is a logic_error
+        const OddNode& addNode(long long id, int srcVarIndex, std::vector<long long> childrenId, OddNode::NodeType type, int sink_num = 0);
+
+        long long getSize() const;
 
-        long long getSize();;
+        // Position of the node in getNodes(), -1 if there is none with this id
+        long long getIndex(long long id) const;
 
-        OddNode getRoot();
+        const OddNode& getRoot() const;
 
-        std::vector<std::pair<std::string, int> > getSrcVariableDetails();
+        const std::vector<std::pair<std::string, int> >& getSrcVariableDetails() const;
+
+        const std::string& getSrcVarName(int srcVarIndex) const;
+
+        // Number of values of a variable, for loaders that only know it once its nodes are read
+        void setNumValues(int srcVarIndex, int numValues);
 
         void dump();
 
         // Reverse topological order
-        std::vector<OddNode> getNodes() const;
+        const std::vector<OddNode>& getNodes() const;
+
+        // The equivalent reduced ODD, by a unique table over (variable, children) bottom-up: duplicates are merged and
+        // a node with one child for every value is skipped. The root (the last node) and the sinks are kept.
+        // Skipping a test assumes exactly one indicator of each variable holds, as the network CNF requires.
+        Odd reduce(OddReductionStats& stats) const;
 };
 
 // TODO: Combine this with Odd class? Since they share many similarities.
 class NnfNode {
 public:
     enum NodeType { CONJ, DISJ, LEAF };
-    NnfNode(long long idx, std::vector<int> childrenIdxs, NodeType type, std::string srcVarName = "", int srcVarVal = 0);
+    NnfNode(long long idx, std::vector<int> childrenIdxs, NodeType type, int srcVarIndex = -1, int srcVarVal = 0);
 
     void setChild(int val, int childIdx);
 
-    int getChild(int chIndex);;
+    int getChild(int chIndex) const;
 
-    long long getIndex();
+    const std::vector<int>& getChildren() const;
 
-    int getCardinality();
+    long long getIndex() const;
 
-    NodeType getType();
+    int getCardinality() const;
 
-    std::string getSrcVarName();
+    NodeType getType() const;
 
-    int getSrcVarVal();
+    // -1 for conjunctions and disjunctions
+    int getSrcVarIndex() const;
+
+    int getSrcVarVal() const;
 
 private:
     long long idx; // this identifies the Nnfnode's position in say Nnf class.
     std::vector<int> children;
-    std::string srcVarName;
+    int srcVarIndex;
     int srcVarVal;
     NodeType type;
 };
@@ -101,41 +135,43 @@ private:
 
 class Nnf {
 public:
-    Nnf(std::vector<std::pair<std::string, int> > srcVarNamesNumValues);
+    Nnf(const std::vector<std::pair<std::string, int> >& srcVarNamesNumValues);
 
-    NnfNode addNode(std::vector<long long> childrenId, NnfNode::NodeType type, std::string srcVarName = "", int srcVarVal = 0);;
+    const NnfNode& addNode(std::vector<int> childrenIdxs, NnfNode::NodeType type, int srcVarIndex = -1, int srcVarVal = 0);
 
-    long long getSize();
+    long long getSize() const;
 
-    // Assumes NNF is empty to start
-    void loadFromOdd(const Odd& diagram);;
+    // Assumes NNF is empty to start, the variables are those the ODD was made with
+    void loadFromOdd(const Odd& diagram);
 
     void dump();
 
-    NnfNode getRoot() const;
+    const NnfNode& getRoot() const;
+
+    const std::vector<NnfNode>& getNodes() const;
 
-    std::vector<NnfNode> getNodes() const;
+    // Empty for -1
+    const std::string& getSrcVarName(int srcVarIndex) const;
 
-    std::map<std::string, std::vector<long long> > getSrcVariableMapping() const;
+    const std::map<std::string, std::vector<long long> >& getSrcVariableMapping() const;
 
 
 private:
     std::vector<NnfNode> nodes; // reverse topological order
+    std::vector<std::string> srcVarNames;
     std::map<std::string, std::vector<long long> > srcVarNameValToIndicatorNodeIndex;
 };
 
 
+// Literals are kept as in DIMACS, 1-indexed and negative when negated
 class cnfClause {
 public:
-    cnfClause() = default;
-    cnfClause(const cnfClause& a) {
-        this->literals = a.getLiterals();
-    }
     void addLiteral(long long idx, bool positive);
-    void remapLiterals(std::vector<long long> idxMap) {
+    void remapLiterals(const std::vector<long long>& idxMap) {
         try {
             for (auto& literal: literals) {
-                literal.first = idxMap.at(literal.first);
+                long long idx = idxMap.at(std::llabs(literal) - 1) + 1;
+                literal = literal > 0 ? idx : -idx;
             }
         }
         catch (const std::out_of_range& oor) {
@@ -147,15 +183,22 @@ public:
             //std::cerr << std::endl;
         }
     };
-    std::string asString();
+    std::string asString() const;
+    void write(std::ostream& out) const;
     std::vector<std::pair<long long, bool> > getLiterals() const;
 
 private:
-    std::vector<std::pair<long long, bool> > literals;
+    std::vector<long long> literals;
 };
 
 class Cnf {
 public:
+    // TSEITIN defines every gate by both implications. PLAISTED_GREENBAUM only keeps the one of the polarity the gate
+    // occurs in: the NNF of an ODD is monotone apart from its leaves, so every gate implies its definition and the
+    // converse is dropped. The sink the indicators select is still forced, but gates off the path are no longer
+    // determined, so models (and counts over all variables) differ.
+    enum Encoding { TSEITIN, PLAISTED_GREENBAUM };
+
     Cnf();
 
     void write(std::string outfile);;
@@ -164,12 +207,13 @@ public:
 
     void addClause(cnfClause cl);
 
-    void encodeNNF(Nnf nnfDiagram);;
+    // At most one sink holds by amo (pairwise by default), auxiliary variables are numbered after the NNF nodes
+    void encodeNNF(const Nnf& nnfDiagram, Encoding encoding = TSEITIN, amo::encoding_t amoEncoding = amo::PAIRWISE);
 
-    void encodeNNF2(Nnf nnfDiagram);
+    void encodeNNF2(const Nnf& nnfDiagram);
 
     // Next two are temporary getters, ideally we should want to perform the cnf merging inside the class.
-    std::vector<cnfClause> getClauses() const {
+    const std::vector<cnfClause>& getClauses() const {
         return clauses;
     };
 
@@ -181,6 +225,11 @@ public:
         this->srcVarNameValToIndicatorNodeIndex = det;
     }
 
+    // The auxiliary variables of the at-most-one constraints, by the src variable they belong to
+    const std::map<std::string, std::vector<long long> >& getAuxiliaryDetails() const {
+        return srcVarNameToAuxiliaryIndex;
+    }
+
     long long getNumCnfVars() {
         return numCnfVars;
     }
@@ -203,13 +252,17 @@ private:
     // Can only be used once encoded from NNF as this map is just copied over.
     std::map<std::string, std::vector<long long> > srcVarNameValToIndicatorNodeIndex;
 
-    void addHeadlessDisjunction(std::vector<long long> indices);
+    std::map<std::string, std::vector<long long> > srcVarNameToAuxiliaryIndex;
+
+    void addHeadlessDisjunction(const std::vector<long long>& indices);
 
-    void addHeadlessXOR(std::vector<long long> indices);
+    void addHeadlessXOR(const std::vector<long long>& indices, amo::encoding_t amoEncoding = amo::PAIRWISE,
+                        const std::string& owner = "");
 
-    void addDisjunction(long long parentIndex, std::vector<long long> chIndices);
+    // The parent implies its children (forward), and with both the converse (backward)
+    void addDisjunction(long long parentIndex, const std::vector<long long>& chIndices, bool both = true);
 
-    void addConjunction(long long parentIndex, std::vector<long long> chIndices);
+    void addConjunction(long long parentIndex, const std::vector<long long>& chIndices, bool both = true);
 
     std::vector<cnfClause> disjoinCnf(std::vector<cnfClause> cnf1, std::vector<cnfClause> cnf2);
 
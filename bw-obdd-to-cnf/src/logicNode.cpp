@@ -1,10 +1,11 @@
 #include <logicNode.h>
 #include <fstream>
+#include <unordered_set>
 
-OddNode::OddNode(long long id, std::string srcVarName, std::vector <long long> children, OddNode::NodeType type, int sink_num) {
+OddNode::OddNode(long long id, int srcVarIndex, std::vector <long long> children, OddNode::NodeType type, int sink_num) {
     this->id = id;
-    this->srcVarName = srcVarName;
-    this->children = children;
+    this->srcVarIndex = srcVarIndex;
+    this->children = std::move(children);
     this->type = type;
     this->sink_num = sink_num;
 }
@@ -13,7 +14,7 @@ void OddNode::setId(long long id) {
     this->id = id;
 }
 
-long long OddNode::getId() {
+long long OddNode::getId() const {
     return this->id;
 }
 
@@ -21,57 +22,80 @@ void OddNode::setSinkNum(int sink_num) {
     this->sink_num = sink_num;
 }
 
-int OddNode::getSinkNum() {
+int OddNode::getSinkNum() const {
     return this->sink_num;
 }
 
-void OddNode::setChild(int val, long long childId) {
-    this->children[val] = childId;
+void OddNode::setChild(int val, long long childIndex) {
+    this->children[val] = childIndex;
 }
 
-long long OddNode::getChild(int index) {
+long long OddNode::getChild(int index) const {
     return this->children[index];
 }
 
-int OddNode::getCardinality() {
+int OddNode::getCardinality() const {
     return this->children.size();
 }
 
-OddNode::NodeType OddNode::getType() {
+OddNode::NodeType OddNode::getType() const {
     return this->type;
 }
 
-std::string OddNode::getSrcVarName() {
-    return srcVarName;
+int OddNode::getSrcVarIndex() const {
+    return srcVarIndex;
 }
 
-OddNode Odd::addNode(long long int id, std::string srcVarName, std::vector<long long> childrenId, OddNode::NodeType type, int sink_num) {
-    std::vector<long long> children;
-    for (auto childId: childrenId) {
-        if (idToIndex.count(childId) > 0) {
-            children.push_back(childId);
-        }
-        else {
+const OddNode& Odd::addNode(long long int id, int srcVarIndex, std::vector<long long> childrenId, OddNode::NodeType type, int sink_num) {
+    // The ids become indices in place
+    for (auto& child: childrenId) {
+        child = getIndex(child);
+        if (child < 0) {
             throw std::logic_error("Some child node does not exist in the ODD yet");
         }
     }
     //if (childrenId.size() > 0) {
     //    std::cout << (*children[0]).getSrcVarName() << std::endl;
     //}
-    OddNode newNode(id, srcVarName, children, type, sink_num);
-    idToIndex[id] = nodes.size();
+    const long long index = nodes.size();
+    if (id < 0) {
+        if (-id > (long long) sinkIdToIndex.size()) {
+            sinkIdToIndex.resize(-id, -1);
+        }
+        sinkIdToIndex[-id - 1] = index;
+    }
+    else if (id < 4 * index + 1024) {
+        if (id >= (long long) idToIndex.size()) {
+            idToIndex.resize(id + 1, -1);
+        }
+        idToIndex[id] = index;
+    }
+    else {
+        sparseIdToIndex[id] = index;
+    }
     if (id == 0) {
-        root = nodes.size();
+        root = index;
     }
-    nodes.push_back(newNode);
-    return newNode;
+    nodes.emplace_back(id, srcVarIndex, std::move(childrenId), type, sink_num);
+    return nodes.back();
 }
 
-long long Odd::getSize() {
+long long Odd::getSize() const {
     return nodes.size();
 }
 
-OddNode Odd::getRoot() {
+long long Odd::getIndex(long long id) const {
+    if (id < 0) {
+        return -id <= (long long) sinkIdToIndex.size() ? sinkIdToIndex[-id - 1] : -1;
+    }
+    if (id < (long long) idToIndex.size() && idToIndex[id] >= 0) {
+        return idToIndex[id];
+    }
+    auto it = sparseIdToIndex.find(id);
+    return it == sparseIdToIndex.end() ? -1 : it->second;
+}
+
+const OddNode& Odd::getRoot() const {
     if (root == -1) {
         throw std::logic_error("Root node of ODD has not been added yet");
     }
@@ -79,36 +103,135 @@ OddNode Odd::getRoot() {
 }
 
 void Odd::dump() {
-    for (auto node: nodes) {
-        std::cout << node.getSrcVarName() << " ";
+    for (const auto& node: nodes) {
+        std::cout << getSrcVarName(node.getSrcVarIndex()) << " ";
         for (int i = 0; i < node.getCardinality(); i++) {
-            std::cout << nodes[idToIndex[node.getChild(i)]].getSrcVarName() << " ";
+            std::cout << getSrcVarName(nodes[node.getChild(i)].getSrcVarIndex()) << " ";
         }
         std::cout << std::endl;
     }
 }
 
-std::vector<OddNode> Odd::getNodes() const {
+const std::vector<OddNode>& Odd::getNodes() const {
     return nodes;
 }
 
 Odd::Odd(std::vector<std::pair<std::string, int>> srcVarNamesNumValues) {
-    this->srcVarNameNumValues = srcVarNamesNumValues;
-    for (int srcVarIndex = 0; srcVarIndex < srcVarNamesNumValues.size(); srcVarIndex++) {
-        this->srcVarNameToSrcVarIndex[srcVarNamesNumValues[srcVarIndex].first] = srcVarIndex;
+    this->srcVarNameNumValues = std::move(srcVarNamesNumValues);
+    for (int srcVarIndex = 0; srcVarIndex < this->srcVarNameNumValues.size(); srcVarIndex++) {
+        this->srcVarNameToSrcVarIndex[this->srcVarNameNumValues[srcVarIndex].first] = srcVarIndex;
     }
     root = -1;
 }
 
-std::vector<std::pair<std::string, int> > Odd::getSrcVariableDetails() {
+const std::vector<std::pair<std::string, int> >& Odd::getSrcVariableDetails() const {
     return this->srcVarNameNumValues;
 }
 
-NnfNode::NnfNode(long long idx, std::vector<int> children, NnfNode::NodeType type, std::string srcVarName, int srcVarVal) {
+const std::string& Odd::getSrcVarName(int srcVarIndex) const {
+    return this->srcVarNameNumValues[srcVarIndex].first;
+}
+
+void Odd::setNumValues(int srcVarIndex, int numValues) {
+    this->srcVarNameNumValues[srcVarIndex].second = numValues;
+}
+
+Odd Odd::reduce(OddReductionStats& stats) const {
+    const long long size = nodes.size();
+    const long long rootIndex = size - 1;
+
+    // The node each one is replaced by, children before parents so those of a node are final when it is reached
+    std::vector<long long> representative(size);
+
+    // Unique table of the nodes kept, equal when they test the same variable and have the same representatives
+    auto hash = [&](long long index) {
+        const OddNode& node = nodes[index];
+        size_t h = std::hash<int>()(node.getSrcVarIndex());
+        for (int i = 0; i < node.getCardinality(); i++) {
+            h = h * 1000003 ^ std::hash<long long>()(representative[node.getChild(i)]);
+        }
+        return h;
+    };
+    auto equal = [&](long long a, long long b) {
+        const OddNode& nodeA = nodes[a];
+        const OddNode& nodeB = nodes[b];
+        if (nodeA.getSrcVarIndex() != nodeB.getSrcVarIndex() || nodeA.getCardinality() != nodeB.getCardinality()) {
+            return false;
+        }
+        for (int i = 0; i < nodeA.getCardinality(); i++) {
+            if (representative[nodeA.getChild(i)] != representative[nodeB.getChild(i)]) {
+                return false;
+            }
+        }
+        return true;
+    };
+    std::unordered_set<long long, decltype(hash), decltype(equal)> unique(size, hash, equal);
+
+    for (long long index = 0; index < size; index++) {
+        const OddNode& node = nodes[index];
+        representative[index] = index;
+        if (node.getType() == OddNode::SINK || index == rootIndex) {
+            continue;
+        }
+
+        bool redundant = node.getCardinality() > 0;
+        for (int i = 1; i < node.getCardinality() && redundant; i++) {
+            redundant = representative[node.getChild(i)] == representative[node.getChild(0)];
+        }
+        if (redundant) {
+            representative[index] = representative[node.getChild(0)];
+            stats.redundant++;
+            continue;
+        }
+
+        auto inserted = unique.insert(index);
+        if (!inserted.second) {
+            representative[index] = *inserted.first;
+            stats.duplicates++;
+        }
+    }
+
+    // Top-down from the root, over the representatives only
+    std::vector<bool> reachable(size);
+    if (size > 0) {
+        reachable[rootIndex] = true;
+    }
+    for (long long index = rootIndex; index >= 0; index--) {
+        if (reachable[index] && representative[index] == index) {
+            const OddNode& node = nodes[index];
+            for (int i = 0; i < node.getCardinality(); i++) {
+                reachable[representative[node.getChild(i)]] = true;
+            }
+        }
+    }
+
+    Odd reduced(srcVarNameNumValues);
+    std::vector<long long> childrenId;
+    for (long long index = 0; index < size; index++) {
+        const OddNode& node = nodes[index];
+        const bool kept = representative[index] == index && (reachable[index] || node.getType() == OddNode::SINK);
+        if (!kept) {
+            if (representative[index] == index) {
+                stats.unreachable++;
+            }
+            stats.children += node.getCardinality();
+            continue;
+        }
+
+        childrenId.clear();
+        for (int i = 0; i < node.getCardinality(); i++) {
+            childrenId.push_back(nodes[representative[node.getChild(i)]].getId());
+        }
+        reduced.addNode(node.getId(), node.getSrcVarIndex(), childrenId, node.getType(), node.getSinkNum());
+    }
+    return reduced;
+}
+
+NnfNode::NnfNode(long long idx, std::vector<int> children, NnfNode::NodeType type, int srcVarIndex, int srcVarVal) {
     this->idx = idx;
-    this->children = children;
+    this->children = std::move(children);
     this->type = type;
-    this->srcVarName = srcVarName;
+    this->srcVarIndex = srcVarIndex;
     this->srcVarVal = srcVarVal;
 }
 
@@ -116,55 +239,50 @@ void NnfNode::setChild(int val, int childIdx) {
     this->children[val] = childIdx;
 }
 
-int NnfNode::getCardinality() {
+int NnfNode::getCardinality() const {
     return this->children.size();
 }
 
-NnfNode::NodeType NnfNode::getType() {
+NnfNode::NodeType NnfNode::getType() const {
     return type;
 }
 
-std::string NnfNode::getSrcVarName() {
-    return this->srcVarName;
+int NnfNode::getSrcVarIndex() const {
+    return this->srcVarIndex;
 }
 
-int NnfNode::getChild(int index) {
+int NnfNode::getChild(int index) const {
     return this->children[index];
 }
 
-long long NnfNode::getIndex() {
+const std::vector<int>& NnfNode::getChildren() const {
+    return this->children;
+}
+
+long long NnfNode::getIndex() const {
     return idx;
 }
 
-int NnfNode::getSrcVarVal() {
+int NnfNode::getSrcVarVal() const {
     return srcVarVal;
 }
 
-NnfNode
-Nnf::addNode(std::vector<long long int> childrenIdxs, NnfNode::NodeType type, std::string srcVarName, int srcVarVal) {
-    std::vector<int> children;
+const NnfNode& Nnf::addNode(std::vector<int> childrenIdxs, NnfNode::NodeType type, int srcVarIndex, int srcVarVal) {
     for (auto childIdx: childrenIdxs) {
-        if (childIdx < this->getSize()) {
-            //children.push_back(this->nodes[childId]);
-            children.push_back(childIdx);
-        }
-        else {
+        if (childIdx >= this->getSize()) {
             throw std::logic_error("Some child node does not exist in the NNF yet");
         }
     }
 
-    NnfNode newNode(this->getSize(), children, type, srcVarName, srcVarVal);
-
-    if (!srcVarName.empty()) { // i.e. is a indicator leaf node
-        this->srcVarNameValToIndicatorNodeIndex[srcVarName][srcVarVal] = this->getSize();
+    if (srcVarIndex >= 0) { // i.e. is a indicator leaf node
+        this->srcVarNameValToIndicatorNodeIndex[srcVarNames[srcVarIndex]][srcVarVal] = this->getSize();
     }
-    this->nodes.push_back(newNode);
-
+    this->nodes.emplace_back(this->getSize(), std::move(childrenIdxs), type, srcVarIndex, srcVarVal);
 
-    return newNode;
+    return this->nodes.back();
 }
 
-long long Nnf::getSize() {
+long long Nnf::getSize() const {
     return this->nodes.size();
 }
 
@@ -173,74 +291,94 @@ void Nnf::loadFromOdd(const Odd &diagram) {
         throw std::logic_error("NNF must be empty when loading from ODD");
     }
 
-    std::vector<OddNode> oddNodes = diagram.getNodes();
+    const std::vector<OddNode>& oddNodes = diagram.getNodes();
 
-    std::map<long long, long long> oddIdToOrNodeIndex;
+    // By ODD index, the ODD children are indices before their parents
+    std::vector<int> oddIndexToOrNodeIndex(oddNodes.size());
 
-    std::map<std::string, bool> srcVarSeen; // true if we have already encountered an ODD node for that srcVar
+    // By variable index: the indicators of the variable, and true if we have already encountered an ODD node for it
+    std::vector<std::vector<long long>*> srcVarIndicators;
+    for (const auto& srcVarName: srcVarNames) {
+        srcVarIndicators.push_back(&this->srcVarNameValToIndicatorNodeIndex[srcVarName]);
+    }
+    std::vector<bool> srcVarSeen(srcVarNames.size());
+
+    // An OR node (or leaf) per ODD node and an AND node per child, and an indicator per value of a variable (a bound)
+    std::vector<bool> srcVarTested(srcVarNames.size());
+    long long numNnfNodes = 0;
+    for (const auto& oddNode: oddNodes) {
+        numNnfNodes += 1 + oddNode.getCardinality();
+        srcVarTested[oddNode.getSrcVarIndex()] = true;
+    }
+    for (const auto indicators: srcVarIndicators) {
+        numNnfNodes += indicators->size();
+    }
+    nodes.reserve(numNnfNodes);
+
+    // A variable whose tests were all reduced away keeps its indicators, ahead of the nodes
+    for (int srcVarIndex = 0; srcVarIndex < (int) srcVarNames.size(); srcVarIndex++) {
+        if (!srcVarTested[srcVarIndex]) {
+            for (int val = 0; val < (int) srcVarIndicators[srcVarIndex]->size(); val++) {
+                this->addNode({}, NnfNode::LEAF, srcVarIndex, val);
+            }
+        }
+    }
 
-    //std::map<std::string, std::vector<long long> > srcVarNameValToIndicatorNodeIndex;
-    //std::cout << oddNodes.size() << std::endl;
-    for (auto oddNode: oddNodes) {
-        //std::cout << "FAIL" << std::endl;
+    for (long long oddIndex = 0; oddIndex < (long long) oddNodes.size(); oddIndex++) {
+        const OddNode& oddNode = oddNodes[oddIndex];
+        const int srcVarIndex = oddNode.getSrcVarIndex();
         if (oddNode.getType() == OddNode::SINK) {
-            //std::cout << oddNode.getId() << std::endl;
-            oddIdToOrNodeIndex[oddNode.getId()] = this->getSize();
-            this->addNode({}, NnfNode::LEAF, oddNode.getSrcVarName(), oddNode.getSinkNum());
+            oddIndexToOrNodeIndex[oddIndex] = this->getSize();
+            this->addNode({}, NnfNode::LEAF, srcVarIndex, oddNode.getSinkNum());
         }
         else {
 
-            //long long firstNewNodeIndex = this->nodes.size(); // all new nodes appear after the current end
             // Add conjunctions (and indicators):
-            std::vector<long long> conjIndices;
-            bool thisVarSeen = srcVarSeen[oddNode.getSrcVarName()]; // do we have the indicators for this variable
-            //std::cout << oddNode.getCardinality() << std::endl;
+            std::vector<int> conjIndices;
+            conjIndices.reserve(oddNode.getCardinality());
+            bool thisVarSeen = srcVarSeen[srcVarIndex]; // do we have the indicators for this variable
             for (int chIndex = 0; chIndex < oddNode.getCardinality(); chIndex++) {
 
-                long long chNodeId = oddNode.getChild(chIndex);
-
-                //std::cout << chNodeId << " ";
-                if (oddIdToOrNodeIndex.count(chNodeId) == 0) {
+                long long chNodeIndex = oddNode.getChild(chIndex);
 
+                if (chNodeIndex >= oddIndex) {
                     throw std::logic_error("Could not create NNF from ODD (ODD nodes are not in reverse topological order)");
                 }
 
                 // indicator node
-                long long indNodeIndex;
+                int indNodeIndex;
                 if (thisVarSeen) {
-                    indNodeIndex = this->srcVarNameValToIndicatorNodeIndex[oddNode.getSrcVarName()][chIndex];
+                    indNodeIndex = (*srcVarIndicators[srcVarIndex])[chIndex];
                 }
                 else {
                     indNodeIndex = this->getSize();
-                    srcVarSeen[oddNode.getSrcVarName()] = true;
-                    this->addNode({}, NnfNode::LEAF, oddNode.getSrcVarName(), chIndex);
-                    //srcVarNameValToIndicatorNodeIndex[oddNode.getSrcVarName()].push_back(indNodeIndex);
+                    srcVarSeen[srcVarIndex] = true;
+                    this->addNode({}, NnfNode::LEAF, srcVarIndex, chIndex);
                 }
 
 
                 // conjunction
                 conjIndices.push_back(this->getSize());
-                this->addNode({indNodeIndex, oddIdToOrNodeIndex[chNodeId]}, NnfNode::CONJ);
+                this->addNode({indNodeIndex, oddIndexToOrNodeIndex[chNodeIndex]}, NnfNode::CONJ);
 
             }
-            //std::cout << std::endl;
 
             // disjunction
-            oddIdToOrNodeIndex[oddNode.getId()] = this->getSize();
-            this->addNode(conjIndices, NnfNode::DISJ);
+            oddIndexToOrNodeIndex[oddIndex] = this->getSize();
+            this->addNode(std::move(conjIndices), NnfNode::DISJ);
         }
     }
 }
 
-std::vector<NnfNode> Nnf::getNodes() const {
+const std::vector<NnfNode>& Nnf::getNodes() const {
     return nodes;
 }
 
 void Nnf::dump() {
     std::ofstream fin("delete.txt");
     fin << "Nnf Size: " << this->getSize() << std::endl;
-    for (auto node: nodes) {
-        std::cout << node.getIndex() << " " << node.getType() << " " << node.getSrcVarName() << " " << node.getSrcVarVal() << " ";
+    for (const auto& node: nodes) {
+        std::cout << node.getIndex() << " " << node.getType() << " " << getSrcVarName(node.getSrcVarIndex()) << " " << node.getSrcVarVal() << " ";
         for (int chIndex = 0; chIndex < node.getCardinality(); chIndex++) {
             std::cout << node.getChild(chIndex) << " ";
         }
@@ -249,38 +387,53 @@ void Nnf::dump() {
 
 }
 
-NnfNode Nnf::getRoot() const {
+const NnfNode& Nnf::getRoot() const {
     return nodes[nodes.size() - 1];
 }
 
-std::map<std::string, std::vector<long long> > Nnf::getSrcVariableMapping() const {
+const std::string& Nnf::getSrcVarName(int srcVarIndex) const {
+    static const std::string none;
+    return srcVarIndex < 0 ? none : srcVarNames[srcVarIndex];
+}
+
+const std::map<std::string, std::vector<long long> >& Nnf::getSrcVariableMapping() const {
     return srcVarNameValToIndicatorNodeIndex;
 }
 
-Nnf::Nnf(std::vector<std::pair<std::string, int>> srcVarNamesNumValues) {
-    for (auto nameNumValues: srcVarNamesNumValues) {
-        std::string srcVarName = nameNumValues.first;
+Nnf::Nnf(const std::vector<std::pair<std::string, int>>& srcVarNamesNumValues) {
+    for (const auto& nameNumValues: srcVarNamesNumValues) {
+        const std::string& srcVarName = nameNumValues.first;
         int srcVarNumValues = nameNumValues.second;
+        this->srcVarNames.push_back(srcVarName);
         this->srcVarNameValToIndicatorNodeIndex[srcVarName] = std::vector<long long> (srcVarNumValues);
     }
 }
 
 void cnfClause::addLiteral(long long int idx, bool positive) {
-    this->literals.push_back({idx, positive});
+    // change to 1-indexing
+    this->literals.push_back(positive ? idx + 1 : -idx - 1);
 }
 
-std::string cnfClause::asString() {
-    std::ostringstream oss;
-    for (auto literal: literals) {
-        // change to 1-indexing
-        oss << (literal.second ? literal.first + 1 : -literal.first - 1) << " ";
+void cnfClause::write(std::ostream& out) const {
+    for (long long literal: literals) {
+        out << literal << ' ';
     }
-    oss << "0";
+    out << '0';
+}
+
+std::string cnfClause::asString() const {
+    std::ostringstream oss;
+    write(oss);
     return oss.str();
 }
 
 std::vector<std::pair<long long, bool> > cnfClause::getLiterals() const {
-    return literals;
+    std::vector<std::pair<long long, bool> > pairs;
+    pairs.reserve(literals.size());
+    for (long long literal: literals) {
+        pairs.push_back({std::llabs(literal) - 1, literal > 0});
+    }
+    return pairs;
 }
 
 Cnf::Cnf() {
@@ -288,21 +441,29 @@ Cnf::Cnf() {
 
 void Cnf::write(std::string outfile) {
     std::ofstream fout(outfile);
-    fout << "p cnf " << numCnfVars << " " << clauses.size() << std::endl;
-    for (auto clause: clauses) {
-        fout << clause.asString() << std::endl;
+    fout << "p cnf " << numCnfVars << " " << clauses.size() << '\n';
+    for (const auto& clause: clauses) {
+        clause.write(fout);
+        fout << '\n';
     }
 
     // If src variable mapping has been set, print this information
     if (!this->srcVarNameValToIndicatorNodeIndex.empty()) {
-        fout << "c ==============================================================================" << std::endl;
+        fout << "c ==============================================================================" << '\n';
         for (const auto& nameIndices: this->srcVarNameValToIndicatorNodeIndex) {
             fout << "c        ";
             fout << nameIndices.first;
             for (auto index: nameIndices.second) {
                 fout << " " << index + 1; //1-indexing in printed file
             }
-            fout << std::endl;
+            fout << '\n';
+        }
+        for (const auto& nameIndices: this->srcVarNameToAuxiliaryIndex) {
+            fout << "c        $aux " << nameIndices.first;
+            for (auto index: nameIndices.second) {
+                fout << " " << index + 1;
+            }
+            fout << '\n';
         }
     }
 }
@@ -342,6 +503,7 @@ void Cnf::read(std::string infile) {
     }
 
     this->srcVarNameValToIndicatorNodeIndex.clear(); // Clear the map if it already contains something
+    this->srcVarNameToAuxiliaryIndex.clear();
     std::string commentString;
     std::getline(fin, commentString); // c ====================
     while (std::getline(fin, commentString)) {
@@ -353,6 +515,16 @@ void Cnf::read(std::string infile) {
         std::string varName, indicatorIdxStr; long long indicatorIdxInt;
         ss_m >> varName;
 
+        // "$aux <src variable> <index> ...", the auxiliary variables of its at-most-one constraint
+        if (varName == "$aux") {
+            ss_m >> varName;
+            std::vector<long long>& auxiliary = this->srcVarNameToAuxiliaryIndex[varName];
+            while (ss_m >> indicatorIdxStr) {
+                auxiliary.push_back(std::stoll(indicatorIdxStr) - 1);
+            }
+            continue;
+        }
+
         this->srcVarNameValToIndicatorNodeIndex.insert({varName, std::vector<long long>()});
 
         while (ss_m >> indicatorIdxStr) {
@@ -363,106 +535,149 @@ void Cnf::read(std::string infile) {
 }
 
 void Cnf::addClause(cnfClause cl) {
-    clauses.push_back(cl);
+    clauses.push_back(std::move(cl));
 }
 
-void Cnf::encodeNNF(Nnf nnfDiagram) {
+void Cnf::encodeNNF(const Nnf& nnfDiagram, Cnf::Encoding encoding, amo::encoding_t amoEncoding) {
     this->numCnfVars = nnfDiagram.getSize();
+    this->srcVarNameToAuxiliaryIndex.clear();
 
     std::vector<long long> sinkIndices; // where the sinks/prediction nodes are
-    std::vector<NnfNode> nodes = nnfDiagram.getNodes();
-
-    for (int idx = 0; idx < nodes.size(); idx++) {
-        NnfNode node = nodes[idx];
-        std::vector<long long> chIndices;
-        for (int chI = 0; chI < node.getCardinality(); chI++) {
-            chIndices.push_back(node.getChild(chI));
+    const std::vector<NnfNode>& nodes = nnfDiagram.getNodes();
+    const long long rootIndex = nnfDiagram.getRoot().getIndex();
+    const bool both = encoding == TSEITIN;
+
+    // A clause per gate and child (but one for a disjunction alone forward, and for the root), then those of the sinks
+    long long numClauses = 0;
+    for (const auto& node: nodes) {
+        if (node.getType() == NnfNode::LEAF) {
+            if (nnfDiagram.getSrcVarName(node.getSrcVarIndex()) == "Sink") {
+                sinkIndices.push_back(node.getIndex());
+            }
         }
+        else {
+            if (node.getIndex() == rootIndex || (!both && node.getType() == NnfNode::DISJ)) {
+                numClauses += 1;
+            }
+            else {
+                numClauses += (both ? 1 : 0) + node.getCardinality();
+            }
+        }
+    }
+    size_t amoClauses = 0, amoLiterals = 0, amoAuxiliary = 0;
+    amo::count(amoEncoding, sinkIndices.size(), amoClauses, amoLiterals, amoAuxiliary);
+    clauses.reserve(clauses.size() + numClauses + 1 + amoClauses);
+
+    std::vector<long long> chIndices;
+    for (long long idx = 0; idx < (long long) nodes.size(); idx++) {
+        const NnfNode& node = nodes[idx];
+        chIndices.assign(node.getChildren().begin(), node.getChildren().end());
         switch (node.getType()) {
             case NnfNode::LEAF:
-                if (node.getSrcVarName() == "Sink") {
-                    sinkIndices.push_back(idx);
-                }
-                else {
-                    // perhaps record some information about the src variable, val, etc. for printing?
-                }
+                // perhaps record some information about the src variable, val, etc. for printing?
                 break;
             case NnfNode::DISJ:
-                if (node.getIndex() == nnfDiagram.getRoot().getIndex()) {
+                if (node.getIndex() == rootIndex) {
                     addHeadlessDisjunction(chIndices);
                 }
                 else {
-                    addDisjunction(idx, chIndices);
+                    addDisjunction(idx, chIndices, both);
                 }
                 break;
             case NnfNode::CONJ:
-                if (node.getIndex() == nnfDiagram.getRoot().getIndex()) {
+                if (node.getIndex() == rootIndex) {
                     //std::cout << node.getIndex() << std::endl;
                     throw std::logic_error("Root node of NNF is conjunction, this is not allowed");
                     // should not happen
                 }
                 else {
-                    addConjunction(idx, chIndices);
+                    addConjunction(idx, chIndices, both);
                 }
                 break;
 
         }
-        //std::cout << "HI" << idx << std::endl;
     }
-    addHeadlessXOR(sinkIndices);
+    addHeadlessXOR(sinkIndices, amoEncoding, "Sink");
 
     this->srcVarNameValToIndicatorNodeIndex = nnfDiagram.getSrcVariableMapping();
 }
 
-void Cnf::addHeadlessDisjunction(std::vector<long long int> indices) {
+void Cnf::addHeadlessDisjunction(const std::vector<long long int>& indices) {
     cnfClause clause;
     for (long long index: indices) {
         clause.addLiteral(index, true);
     }
-    this->addClause(clause);
+    this->addClause(std::move(clause));
 }
 
-void Cnf::addHeadlessXOR(std::vector<long long int> indices) {
+void Cnf::addHeadlessXOR(const std::vector<long long int>& indices, amo::encoding_t amoEncoding,
+                         const std::string& owner) {
     addHeadlessDisjunction(indices);
+    if (amoEncoding != amo::PAIRWISE) {
+        // literals are signed 1-indexed during the encoding
+        std::vector<long long> literals;
+        literals.reserve(indices.size());
+        for (long long index: indices) {
+            literals.push_back(index + 1);
+        }
+        auto newVariable = [this, &owner]() {
+            srcVarNameToAuxiliaryIndex[owner].push_back(numCnfVars);
+            return ++numCnfVars;
+        };
+        auto addClause = [this](const long long *literals, size_t size) {
+            cnfClause clause;
+            for (size_t i = 0; i < size; i++) {
+                clause.addLiteral(std::llabs(literals[i]) - 1, literals[i] > 0);
+            }
+            this->addClause(std::move(clause));
+        };
+        amo::encode(amoEncoding, literals, newVariable, addClause);
+        return;
+    }
     for (int i = 0; i < indices.size(); i++) {
         for (int j = i + 1; j < indices.size(); j++) {
             cnfClause clause;
             clause.addLiteral(indices[i], false);
             clause.addLiteral(indices[j], false);
-            this->addClause(clause);
+            this->addClause(std::move(clause));
         }
     }
 }
 
-void Cnf::addDisjunction(long long int parentIndex, std::vector<long long int> chIndices) {
+void Cnf::addDisjunction(long long int parentIndex, const std::vector<long long int>& chIndices, bool both) {
     cnfClause forwardCl;
     forwardCl.addLiteral(parentIndex, false);
     for (long long chIndex: chIndices) {
         forwardCl.addLiteral(chIndex, true);
     }
-    this->addClause(forwardCl);
+    this->addClause(std::move(forwardCl));
 
+    if (!both) {
+        return;
+    }
     for (long long chIndex : chIndices) {
         cnfClause backwardCl;
         backwardCl.addLiteral(parentIndex, true);
         backwardCl.addLiteral(chIndex, false);
-        this->addClause(backwardCl);
+        this->addClause(std::move(backwardCl));
     }
 }
 
-void Cnf::addConjunction(long long int parentIndex, std::vector<long long int> chIndices) {
-    cnfClause backwardCl;
-    backwardCl.addLiteral(parentIndex, true);
-    for (long long chIndex: chIndices) {
-        backwardCl.addLiteral(chIndex, false);
+void Cnf::addConjunction(long long int parentIndex, const std::vector<long long int>& chIndices, bool both) {
+    if (both) {
+        cnfClause backwardCl;
+        backwardCl.addLiteral(parentIndex, true);
+        for (long long chIndex: chIndices) {
+            backwardCl.addLiteral(chIndex, false);
+        }
+        this->addClause(std::move(backwardCl));
     }
-    this->addClause(backwardCl);
 
     for (long long chIndex : chIndices) {
         cnfClause forwardCl;
         forwardCl.addLiteral(parentIndex, false);
         forwardCl.addLiteral(chIndex, true);
-        this->addClause(forwardCl);
+        this->addClause(std::move(forwardCl));
     }
 }
 
@@ -525,23 +740,20 @@ std::vector<cnfClause> Cnf::conjoinCnf(std::vector<cnfClause> cnf1, std::vector<
     return newCnf;
 }
 
-void Cnf::encodeNNF2(Nnf nnfDiagram) {
+void Cnf::encodeNNF2(const Nnf& nnfDiagram) {
     std::vector<long long> sinkIndices; // where the sinks/prediction nodes are
-    std::vector<NnfNode> nodes = nnfDiagram.getNodes();
+    const std::vector<NnfNode>& nodes = nnfDiagram.getNodes();
 
     std::vector<std::vector<cnfClause> > nnfNodeIdxToClauses(nodes.size());
 
     for (int idx = 0; idx < nodes.size(); idx++) {
-        NnfNode node = nodes[idx];
-        std::vector<long long> chIndices;
-        for (int chI = 0; chI < node.getCardinality(); chI++) {
-            chIndices.push_back(node.getChild(chI));
-        }
+        const NnfNode& node = nodes[idx];
+        const std::vector<int>& chIndices = node.getChildren();
         switch (node.getType()) {
             case NnfNode::LEAF:
                 nnfNodeIdxToClauses[idx] = {cnfClause()};
                 nnfNodeIdxToClauses[idx][0].addLiteral(idx, true);
-                if (node.getSrcVarName() == "Sink") {
+                if (nnfDiagram.getSrcVarName(node.getSrcVarIndex()) == "Sink") {
                     sinkIndices.push_back(idx);
                 }
                 else {
@@ -583,7 +795,7 @@ void Cnf::encodeNNF2(Nnf nnfDiagram) {
     std::vector<long long> idxMap(nodes.size());
 
     int newIdx = 0;
-    for (auto varIdxs: nnfDiagram.getSrcVariableMapping()) {
+    for (const auto& varIdxs: nnfDiagram.getSrcVariableMapping()) {
         for (auto oldIdx: varIdxs.second) {
             squashedSrcVarNameValToIndicatorNodeIndex[varIdxs.first].push_back(newIdx);
             idxMap[oldIdx] = newIdx;
@@ -2,9 +2,11 @@
 #include <fstream>
 #include <string>
 #include <unistd.h>
+#include <getopt.h>
 #include "utils.h"
 #include "parser.h"
 #include "logicNode.h"
+#include "metrics.h"
 #include <boost/archive/text_oarchive.hpp>
 #include <boost/archive/text_iarchive.hpp>
 
@@ -14,6 +16,14 @@ void help(){
     std::cerr << "      -i <filename>: Input (.odd file)\n";
     std::cerr << "      -o <filename>: Output filename for CNF representation (.cnf file)\n";
     std::cerr << "      -s <sinks>: Number of sinks (i.e. number of classifier outcomes), default 2\n";
+    std::cerr << "      -e <encoding>: Definition of the gates, 'tseitin' (both directions, the default) or 'pg'\n";
+    std::cerr << "                     (Plaisted-Greenbaum, the direction of their polarity only: about half the clauses,\n";
+    std::cerr << "                     but gates off the path of the classifier are not determined, so model counts differ)\n";
+    std::cerr << "      -r: Reduce the ODD before encoding (merge duplicate nodes, skip redundant tests)\n";
+    std::cerr << "      --amo <encoding>: At most one sink, 'pairwise' (default), 'sequential', 'commander' or 'product'\n";
+    std::cerr << "                        (auxiliary variables, for more than 6 sinks)\n";
+    std::cerr << "      --metrics <filename>: Time and peak memory per phase and counters (.json file)\n";
+    std::cerr << "      --trace <filename>: Phases as a Chrome trace (.json file)\n";
     std::cerr << "      -h: Help\n";
 }
 
@@ -24,9 +34,21 @@ int main(int argc, char **argv){
     std::string ordFile;
     std::string outfile;
     std::string constraintFile;
+    std::string metricsFile;
+    std::string traceFile;
     int sinks = 2; // default 2 sinks
+    bool reduce = false;
+    Cnf::Encoding encoding = Cnf::TSEITIN;
+    amo::encoding_t amoEncoding = amo::PAIRWISE;
 
-    while ((c = getopt(argc, argv, "i:m:c:o:")) != -1){
+    static const struct option longOptions[] = {
+        {"metrics", required_argument, NULL, 'M'},
+        {"trace", required_argument, NULL, 'T'},
+        {"amo", required_argument, NULL, 'A'},
+        {NULL, 0, NULL, 0}
+    };
+
+    while ((c = getopt_long(argc, argv, "i:m:c:o:s:e:r", longOptions, NULL)) != -1){
         switch (c){
             case 'i': // provide input
             {
@@ -49,7 +71,47 @@ int main(int argc, char **argv){
             }
                 break;
             case 's':
-                sinks = std::stoi(optarg);
+                try {
+                    sinks = std::stoi(optarg);
+                }
+                catch (const std::logic_error& e) {
+                    sinks = 0;
+                }
+                if (sinks < 1) {
+                    std::cerr << "Argument to option -s (" << optarg << ") is not a positive integer\n";
+                    return 1;
+                }
+                break;
+            case 'e':
+            {
+                std::string name = optarg;
+                if (name == "tseitin") {
+                    encoding = Cnf::TSEITIN;
+                }
+                else if (name == "pg") {
+                    encoding = Cnf::PLAISTED_GREENBAUM;
+                }
+                else {
+                    std::cerr << "Unknown encoding '" << name << "', 'tseitin' or 'pg' is required\n";
+                    return 1;
+                }
+            }
+                break;
+            case 'r':
+                reduce = true;
+                break;
+            case 'A':
+                if (!amo::parse(optarg, amoEncoding)) {
+                    std::cerr << "Unknown at-most-one encoding '" << optarg
+                              << "', 'pairwise', 'sequential', 'commander' or 'product' is required\n";
+                    return 1;
+                }
+                break;
+            case 'M':
+                metricsFile = optarg;
+                break;
+            case 'T':
+                traceFile = optarg;
                 break;
             default:
                 help();
@@ -64,15 +126,62 @@ int main(int argc, char **argv){
         help();
         return 1;
     }
+    if (!metricsFile.empty() || !traceFile.empty()) {
+        metrics::enable("bw_obdd_to_cnf", metricsFile, traceFile);
+    }
+
     // Load Odd
+    metrics::phase load("load");
+    Odd diagram({});
+    try {
+        diagram = loadOdd(infile, sinks);
+    }
+    catch (const std::runtime_error& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    load.end();
+    metrics::count("odd.nodes", diagram.getSize());
 
-    Odd diagram = loadOdd(infile, sinks);
-    auto srcVarNamesNumValues = diagram.getSrcVariableDetails();
+    if (reduce) {
+        metrics::phase reduction("reduce");
+        OddReductionStats stats;
+        const long long size = diagram.getSize();
+        diagram = diagram.reduce(stats);
+        reduction.end();
+
+        // A node with k children is encoded as a disjunction of k conjunctions of two, 1 + 4k clauses (1 + 2k with pg)
+        const long long removed = stats.duplicates + stats.redundant + stats.unreachable;
+        const long long clausesRemoved = removed + (encoding == Cnf::TSEITIN ? 4 : 2) * stats.children;
+        std::cout << "Reduced ODD: " << size << " -> " << diagram.getSize() << " nodes (" << stats.duplicates
+                  << " duplicate, " << stats.redundant << " redundant, " << stats.unreachable << " unreachable), "
+                  << clausesRemoved << " clauses removed" << std::endl;
+        metrics::count("reduce.duplicates", stats.duplicates);
+        metrics::count("reduce.redundant", stats.redundant);
+        metrics::count("reduce.unreachable", stats.unreachable);
+        metrics::count("reduce.clauses", clausesRemoved);
+        metrics::count("odd.reduced.nodes", diagram.getSize());
+    }
+
+    // Each of the ODD and the NNF is released once the next form is built
+    metrics::phase nnf("nnf");
     Nnf nnfdiag(diagram.getSrcVariableDetails());
     nnfdiag.loadFromOdd(diagram);
+    diagram = Odd({});
+    nnf.end();
+    metrics::count("nnf.nodes", nnfdiag.getSize());
+
+    metrics::phase encode("cnf");
     Cnf form;
-    form.encodeNNF(nnfdiag);
+    form.encodeNNF(nnfdiag, encoding, amoEncoding);
+    nnfdiag = Nnf({});
+    encode.end();
+    metrics::count("cnf.variables", form.getNumCnfVars());
+    metrics::count("cnf.clauses", form.clauses.size());
+
+    metrics::phase write("write");
     form.write(outfile);
+    write.end();
 
-    return 0;
+    return metrics::write();
 }
@@ -1,93 +1,169 @@
 #include "logicNode.h"
 #include <string>
-#include <regex>
-#include <iostream>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 // parser.cpp: Contains functions for loading various structures from file
 
-// Loads Odd, in the format given by BNC_ODD (Shih/Darwiche)
-Odd loadOdd(std::string infile, int numSinks) {
+namespace {
 
-    std::vector<std::pair<std::string, int> > srcVarNamesNumValues;
+// Read-only mapping of a whole file, an empty file maps to an empty range
+class MappedFile {
+public:
+    MappedFile(const std::string& filename) : data(nullptr), size(0) {
+        int fd = open(filename.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error("Could not open '" + filename + "'");
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            close(fd);
+            throw std::runtime_error("Could not read '" + filename + "'");
+        }
+        size = st.st_size;
+        if (size > 0) {
+            void *mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapping == MAP_FAILED) {
+                close(fd);
+                throw std::runtime_error("Could not map '" + filename + "'");
+            }
+            madvise(mapping, size, MADV_SEQUENTIAL);
+            data = static_cast<const char*>(mapping);
+        }
+        close(fd);
+    }
 
-    std::ifstream fin(infile);
+    ~MappedFile() {
+        if (data) {
+            munmap(const_cast<char*>(data), size);
+        }
+    }
 
-    std::string line;
-    std::getline(fin, line); // Header specifying names of variables in order
-    std::istringstream iss(std::regex_replace(line, std::regex{R"(\{|\[|\]|\}|,)"}, " "));
-    std::string srcVarName;
-    while (iss >> srcVarName) {
-        srcVarNamesNumValues.push_back({srcVarName, 0});
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char *begin() const { return data; }
+    const char *end() const { return data + size; }
+
+private:
+    const char *data;
+    size_t size;
+};
+
+inline bool isBlank(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+inline void skipBlanks(const char *&p, const char *end) {
+    while (p < end && isBlank(*p)) {
+        p++;
     }
-    // first pass through main file, to figure out how many different values each variable takes
-    while (std::getline(fin, line)) {
-
-        std::istringstream iss(line);
-        long long id;
-        std::string chString;
-        int srcVarIndex;
-        int numChildren = 0;
-
-        iss >> id;
-        iss >> srcVarIndex;
-        while (iss >> chString) {
-            numChildren++;
-        }
+}
 
-        srcVarNamesNumValues[srcVarIndex].second = numChildren;
+// Parses a (signed) decimal integer that ends at a blank or the end of the line
+inline bool parseInteger(const char *&p, const char *end, long long& value) {
+    bool negative = false;
+    if (p < end && *p == '-') {
+        negative = true;
+        p++;
+    }
+    const char *digits = p;
+    unsigned long long magnitude = 0;
+    while (p < end && *p >= '0' && *p <= '9') {
+        magnitude = magnitude * 10 + (*p - '0');
+        p++;
+    }
+    if (p == digits || (p < end && !isBlank(*p) && *p != '\n')) {
+        return false;
     }
+    value = negative ? -static_cast<long long>(magnitude) : static_cast<long long>(magnitude);
+    return true;
+}
 
-    srcVarNamesNumValues.push_back({"Sink", numSinks});
+}
 
-    // Reset for rereading, ignore first line
-    fin.clear();
-    fin.seekg(0);
-    std::getline(fin, line);
+// Loads Odd, in the format given by BNC_ODD (Shih/Darwiche)
+// The file is mapped and scanned once: a header line with the names of the variables in order, separated by any of
+// "{}[], ", then a line "<id> <variable index> <child> ..." per node, children before their parents. A child is the id
+// of a node or a sink S<k>. The number of values of a variable is the number of children of (the last of) its nodes.
+Odd loadOdd(std::string infile, int numSinks) {
 
-    // Now construct the diagram
-    Odd diagram(srcVarNamesNumValues);
+    MappedFile file(infile);
+    const char *p = file.begin(), *end = file.end();
+
+    std::vector<std::pair<std::string, int> > srcVarNamesNumValues;
+    while (p < end && *p != '\n') {
+        if (isBlank(*p) || *p == '{' || *p == '}' || *p == '[' || *p == ']' || *p == ',') {
+            p++;
+            continue;
+        }
+        const char *name = p;
+        while (p < end && *p != '\n' && !isBlank(*p) && *p != '{' && *p != '}' && *p != '[' && *p != ']' && *p != ',') {
+            p++;
+        }
+        srcVarNamesNumValues.push_back({std::string(name, p), 0});
+    }
+    const long long numSrcVars = srcVarNamesNumValues.size();
+    srcVarNamesNumValues.push_back({"Sink", numSinks});
+
+    Odd diagram(std::move(srcVarNamesNumValues));
 
     // Add sinks
     for (int sink = 0; sink < numSinks; sink++) {
-        diagram.addNode(-sink - 1, "Sink", {}, OddNode::SINK, sink);
+        diagram.addNode(-sink - 1, numSrcVars, {}, OddNode::SINK, sink);
     }
 
     // Each line specifies a ODD node
-    while (std::getline(fin, line)) {
-        std::istringstream iss(line);
-        long long id, chId;
-        std::string chString;
-        int srcVarIndex;
-        std::vector<long long> childrenId;
-        OddNode::NodeType type;
-
-        //std::cout << iss.str() << std::endl;
-        iss >> id;
-        iss >> srcVarIndex;
-        while (iss >> chString) {
-            if (chString[0] == 'S') {
-                type = OddNode::NodeType::SINK;
-                chString.erase(0, 1);
-
-                int sinkNum = std::stoi(chString);
+    std::vector<long long> childrenId;
+    long long lineNumber = 1;
+    while (p < end) {
+        p++; // end of the previous line
+        lineNumber++;
+        skipBlanks(p, end);
+        if (p >= end || *p == '\n') {
+            continue;
+        }
+
+        long long id, srcVarIndex;
+        bool valid = parseInteger(p, end, id);
+        skipBlanks(p, end);
+        valid = valid && parseInteger(p, end, srcVarIndex);
+        if (!valid || srcVarIndex < 0 || srcVarIndex >= numSrcVars) {
+            throw std::runtime_error(infile + ":" + std::to_string(lineNumber) + ": expected a node id and a variable index");
+        }
+
+        childrenId.clear();
+        skipBlanks(p, end);
+        while (p < end && *p != '\n') {
+            long long chId;
+            if (*p == 'S') {
+                p++;
+                long long sinkNum;
+                valid = parseInteger(p, end, sinkNum) && sinkNum >= 0;
                 chId = -sinkNum - 1;
             }
             else {
-                chId = std::stoi(chString);
+                valid = parseInteger(p, end, chId);
+            }
+            if (!valid) {
+                throw std::runtime_error(infile + ":" + std::to_string(lineNumber) + ": expected a node id or sink S<k> as child");
             }
             childrenId.push_back(chId);
+            skipBlanks(p, end);
         }
 
+        diagram.setNumValues(srcVarIndex, childrenId.size());
         try {
-            diagram.addNode(id, srcVarNamesNumValues[srcVarIndex].first, childrenId, OddNode::NORMAL);
+            diagram.addNode(id, srcVarIndex, std::move(childrenId), OddNode::NORMAL);
         }
         catch (const std::logic_error& e) {
             std::cerr << e.what() << std::endl;
         }
     }
 
-
     return diagram;
 
 }
-
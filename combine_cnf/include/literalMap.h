@@ -36,11 +36,14 @@ class Lmap {
 public:
     enum AcType {ALWAYS_SUM, ALWAYS_MAX, SOMETIMES_SUM_SOMETIMES_MAX};
     enum Space {NORMAL, LOG_E};
-    enum AcVarType {INDICATOR, PARAMETER, CLASSIFIER};
+    // AUXILIARY: variables of an at-most-one constraint (--amo), determined by the indicators of their src variable
+    enum AcVarType {INDICATOR, PARAMETER, CLASSIFIER, AUXILIARY};
 
     Lmap(AcType type, Space mathSpace);
 
-    void loadFromCnf (Cnf cnf, std::vector<std::string> srcVarOrdering, std::vector<AcVarType> acVarToType, std::vector<double> acVarToWeight);
+    // acVarToOwner gives the src variable of every AUXILIARY acVar
+    void loadFromCnf (Cnf cnf, std::vector<std::string> srcVarOrdering, std::vector<AcVarType> acVarToType, std::vector<double> acVarToWeight,
+                      std::vector<std::string> acVarToOwner = {});
 
     void write(std::string outfile);
 
@@ -52,6 +55,7 @@ private:
     std::map<std::string, std::vector<long long> > srcVarValToIndicator;
     std::map<std::string, std::vector<long long> > srcPotPosToIndicator;
     std::vector<AcVarType> acVarToType;
+    std::vector<std::string> acVarToOwner;
 
     std::vector<IndicatorInfo> acVarToIndicatorInfo; // undefined for acVars which are not indicators
     std::vector<ParameterInfo> acVarToParameterInfo; //undefined for acVars which are not parameters
@@ -8,7 +8,7 @@ Lmap::Lmap(Lmap::AcType type, Lmap::Space mathSpace) {
 }
 
 void Lmap::loadFromCnf(Cnf cnf, std::vector <std::string> srcVarOrdering, std::vector <Lmap::AcVarType> acVarToType,
-                       std::vector<double> acVarToWeight) {
+                       std::vector<double> acVarToWeight, std::vector<std::string> acVarToOwner) {
     this->srcVarValToIndicator = cnf.getSrcVarDetails();
     // Note: ordering doesn't really matter, except for providing a unique way of specifying parameter positions
     // Any consistent order here will do (i.e. doesn't matter that there isn't an explicit "order" when we do the
@@ -18,7 +18,9 @@ void Lmap::loadFromCnf(Cnf cnf, std::vector <std::string> srcVarOrdering, std::v
     }
 
     this->acVarToType = acVarToType;
+    this->acVarToOwner = acVarToOwner;
     long long numAcVars = cnf.getNumCnfVars();
+    this->acVarToOwner.resize(numAcVars);
     acVarToIndicatorInfo = std::vector<IndicatorInfo> (numAcVars);
     acVarToParameterInfo = std::vector<ParameterInfo> (numAcVars);
 
@@ -178,6 +180,13 @@ void Lmap::write(std::string outfile) {
                 fout << "cc$C$" << acVar + 1 << "$" << 1.0 << "$+$" << std::endl;
             }
                 break;
+            case AUXILIARY:
+            {
+                // tagged with A and the src variable, after the fields readers of C lines expect
+                fout << "cc$C$" << -(acVar + 1) << "$" << 1.0 << "$+$A$" << acVarToOwner[acVar] << std::endl;
+                fout << "cc$C$" << acVar + 1 << "$" << 1.0 << "$+$A$" << acVarToOwner[acVar] << std::endl;
+            }
+                break;
         }
     }
 
@@ -2,10 +2,12 @@
 #include <fstream>
 #include <string>
 #include <unistd.h>
+#include <getopt.h>
 #include "utils.h"
 #include "parser.h"
 #include "logicNode.h"
 #include "buildCnf.h"
+#include "metrics.h"
 
 void help(){
     std::cerr << "\nUsage:\n   ./"
@@ -15,6 +17,8 @@ void help(){
     std::cerr << "      -d <filename>: CNF for Decision Function (.cnf file) - optional\n";
     std::cerr << "      -m <sinks>: Ordering Constraints (.txt file)\n";
     std::cerr << "      -o <sinks>: Output filename for combined cnf + lmap file\n";
+    std::cerr << "      --metrics <filename>: Time and peak memory per phase and counters (.json file)\n";
+    std::cerr << "      --trace <filename>: Phases as a Chrome trace (.json file)\n";
     std::cerr << "      -h: Help\n";
 }
 
@@ -25,9 +29,17 @@ int main(int argc, char **argv){
     std::string dfCnfFile;
     std::string constraintFile;
     std::string outFile;
+    std::string metricsFile;
+    std::string traceFile;
     int sinks = 2; // default 2 sinks
 
-    while ((c = getopt(argc, argv, "c:d:m:o:")) != -1){
+    static const struct option longOptions[] = {
+        {"metrics", required_argument, NULL, 'M'},
+        {"trace", required_argument, NULL, 'T'},
+        {NULL, 0, NULL, 0}
+    };
+
+    while ((c = getopt_long(argc, argv, "c:d:m:o:", longOptions, NULL)) != -1){
         switch (c){
             case 'c': // provide input
             {
@@ -64,6 +76,12 @@ int main(int argc, char **argv){
                 outFile = optarg;
             }
                 break;
+            case 'M':
+                metricsFile = optarg;
+                break;
+            case 'T':
+                traceFile = optarg;
+                break;
             default:
                 help();
                 return 1;
@@ -88,12 +106,18 @@ int main(int argc, char **argv){
 
 
 
+    if (!metricsFile.empty() || !traceFile.empty()) {
+        metrics::enable("combine_cnf", metricsFile, traceFile);
+    }
+
     std::pair<Cnf, Lmap> outputs = buildCombinedCnf(bnCnfFile, dfCnfFile, constraintFile, outFile);
     //std::pair<Cnf, Lmap> outputs = loadCnfSpecial(bnCnfFile,dfCnf, constraintFile, outFile);
 
+    metrics::phase write("write");
     outputs.first.write(outFile + ".cnf");
+    write.end();
     //outputs.second.write(outFile + ".lmap"); // For some reason, printing here instead of inside loadCnfSpecial
                                                // stops the printing halfway
 
-    return 0;
+    return metrics::write();
 }
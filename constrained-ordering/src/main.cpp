@@ -2,11 +2,13 @@
 #include <fstream>
 #include <string>
 #include <unistd.h>
+#include <getopt.h>
 #include <map>
 #include <vector>
 #include "utils.h"
 #include "graphModel.h"
 #include "reader.h"
+#include "metrics.h"
 #include <algorithm>
 
 void help(){
@@ -16,6 +18,8 @@ void help(){
     std::cerr << "      -c <filename>: Constraint file (.txt) - optional\n";
     std::cerr << "      -o <filename>: Output filename for ordering (.txt)\n";
     std::cerr << "      -m <filename>: Output filename for modified constraints (.txt)\n";
+    std::cerr << "      --metrics <filename>: Time and peak memory per phase and counters (.json file)\n";
+    std::cerr << "      --trace <filename>: Phases as a Chrome trace (.json file)\n";
     std::cerr << "      -h: Help\n";
 }
 
@@ -27,8 +31,16 @@ int main(int argc, char **argv) {
     std::string constraintFile;
     std::string outFile;
     std::string outConstraintFile;
+    std::string metricsFile;
+    std::string traceFile;
 
-    while ((c = getopt(argc, argv, "i:c:o:m:")) != -1) {
+    static const struct option longOptions[] = {
+        {"metrics", required_argument, NULL, 'M'},
+        {"trace", required_argument, NULL, 'T'},
+        {NULL, 0, NULL, 0}
+    };
+
+    while ((c = getopt_long(argc, argv, "i:c:o:m:", longOptions, NULL)) != -1) {
         switch (c) {
             case 'i': // provide input
             {
@@ -70,6 +82,12 @@ int main(int argc, char **argv) {
                 }
             }
                 break;
+            case 'M':
+                metricsFile = optarg;
+                break;
+            case 'T':
+                traceFile = optarg;
+                break;
             default:
                 help();
                 return 1;
@@ -85,6 +103,11 @@ int main(int argc, char **argv) {
     }
 
 
+    if (!metricsFile.empty() || !traceFile.empty()) {
+        metrics::enable("constrained_ordering", metricsFile, traceFile);
+    }
+
+    metrics::phase read("read");
     std::map<std::string, std::vector<std::string> > constraints;
     if (!constraintFile.empty()) {
         constraints = readConstraints(constraintFile);
@@ -92,16 +115,27 @@ int main(int argc, char **argv) {
 
     GraphModel bn;
     bn.readNET(netFile);
+    read.end();
 
     // Add all topological constraints (i.e. involving node and its parents in the Bayesian network). While this is
     // not strictly necessary, it is usually a good idea to enforce, unless the compilation is too slow.
+    metrics::phase topological("constraints");
     constraints = bn.addTopologicalConstraints(constraints);
 
     writeConstraints(outConstraintFile, constraints);
+    topological.end();
+    metrics::count("constraints", constraints.size());
 
+    metrics::phase moralize("moralize");
     bn = bn.moralize();
+    moralize.end();
 
+    metrics::phase minFill("min-fill");
     std::vector<std::string> ordering = bn.getOrdering(GraphModel::Heuristic::MIN_FILL, GraphModel::Constraint::PARTIAL_ORDER, constraints);
+    minFill.end();
+    metrics::count("variables", ordering.size());
+
+    metrics::phase write("write");
 
     std::ofstream fout(outFile);
 
@@ -115,4 +149,8 @@ int main(int argc, char **argv) {
     for (auto str: ordering) {
         fout << str << std::endl;
     }
+    fout.close();
+    write.end();
+
+    return metrics::write();
 }
\ No newline at end of file